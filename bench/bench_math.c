@@ -0,0 +1,472 @@
+/**
+ * File: bench_math.c
+ * Description: Standalone microbenchmarks for c_math.h and c_fastmath.h.
+ * Built and run with `make bench-math`; needs neither SDL nor Vulkan.
+ *
+ * Every benchmark runs over BENCH_COUNT randomized inputs per repetition.
+ * Functions that dispatch on the SIMD level are run once per level the CPU
+ * supports. Results are printed one JSON object per line:
+ *
+ *   {"name":"M_MultiplyMat4","simd":"avx","ops":65536,"reps":20,
+ *    "ns_per_op":1.91,"ns_per_op_min":1.88,"ns_per_op_stddev":0.02,
+ *    "mops_per_s":523.5}
+ *
+ * "simd" is "n/a" for functions that do not dispatch. ns_per_op is the mean
+ * over the repetitions and mops_per_s is derived from it.
+ *
+ * Usage: bench_math [--reps N] [--filter SUBSTRING]
+ */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "c_math.h"
+#include "c_fastmath.h"
+
+#define BENCH_COUNT (1u << 16)
+#define BENCH_DEFAULT_REPS 20
+#define BENCH_WARMUP_REPS 2
+
+typedef struct bench_t {
+    const char* name;
+    void (*run)(size_t n);
+
+    /* 1 if the function dispatches on the SIMD level. */
+    int simd;
+} bench_t;
+
+/*
+ * Outputs have external linkage so the compiler cannot prove they are never
+ * read and drop the work that produces them.
+ */
+static vec_t g_vec_a[BENCH_COUNT];
+static vec_t g_vec_b[BENCH_COUNT];
+vec_t g_vec_out[BENCH_COUNT];
+
+static vec4_t g_vec4_a[BENCH_COUNT];
+static vec4_t g_vec4_b[BENCH_COUNT];
+vec4_t g_vec4_out[BENCH_COUNT];
+
+static mat4_t g_mat_a[BENCH_COUNT];
+static mat4_t g_mat_b[BENCH_COUNT];
+mat4_t g_mat_out[BENCH_COUNT];
+
+static mat3_t g_mat3_a[BENCH_COUNT];
+static mat3_t g_mat3_b[BENCH_COUNT];
+mat3_t g_mat3_out[BENCH_COUNT];
+
+static aabb_t g_aabb_a[BENCH_COUNT];
+static aabb_t g_aabb_b[BENCH_COUNT];
+aabb_t g_aabb_out[BENCH_COUNT];
+static sphere_t g_sphere[BENCH_COUNT];
+
+static float g_float_a[BENCH_COUNT];
+static float g_float_x[BENCH_COUNT];
+static float g_float_y[BENCH_COUNT];
+static float g_float_z[BENCH_COUNT];
+float g_float_out[BENCH_COUNT];
+float g_float_out2[BENCH_COUNT];
+float g_float_out3[BENCH_COUNT];
+float g_float_out4[BENCH_COUNT];
+int g_int_out[BENCH_COUNT];
+
+/* Always 1, but not a constant the compiler can fold into Vec4_Scale. */
+float g_unit_scale = 1.0f;
+
+static float
+Bench_Random(float lo, float hi) {
+    return lo + (hi - lo) * ((float) rand() / (float) RAND_MAX);
+}
+
+static vec_t
+Bench_RandomVec(void) {
+    vec_t v = {
+        Bench_Random(-100.0f, 100.0f),
+        Bench_Random(-100.0f, 100.0f),
+        Bench_Random(-100.0f, 100.0f)
+    };
+    return v;
+}
+
+static vec_t
+Bench_RandomAxis(void) {
+    vec_t v = Bench_RandomVec();
+    M_NormalizeVec(&v);
+    return v;
+}
+
+/* Random rigid transforms with a little scale, so every inverse succeeds. */
+static mat4_t
+Bench_RandomMat4(void) {
+    mat4_t rot = Mat4_RotationMatrix(Bench_RandomAxis(),
+        Bench_Random(-M_PI, M_PI));
+    const vec_t t = Bench_RandomVec();
+    const mat4_t trans = Mat4_TranslationMatrix(t.x, t.y, t.z);
+    mat4_t res = M_MultiplyMat4Scalar(&trans, &rot);
+    const float s = Bench_Random(0.5f, 2.0f);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            res.m[i][j] *= s;
+        }
+    }
+    return res;
+}
+
+static void
+Bench_Setup(void) {
+    srand(1234);
+    for (size_t i = 0; i < BENCH_COUNT; i++) {
+        g_vec_a[i] = Bench_RandomVec();
+        g_vec_b[i] = Bench_RandomVec();
+
+        const vec_t a = Bench_RandomVec();
+        const vec_t b = Bench_RandomVec();
+        g_vec4_a[i] = (vec4_t) { a.x, a.y, a.z, 1.0f };
+        g_vec4_b[i] = (vec4_t) { b.x, b.y, b.z, Bench_Random(-1.0f, 1.0f) };
+
+        g_mat_a[i] = Bench_RandomMat4();
+        g_mat_b[i] = Bench_RandomMat4();
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                g_mat3_a[i].m[r][c] = g_mat_a[i].m[r][c];
+                g_mat3_b[i].m[r][c] = g_mat_b[i].m[r][c];
+            }
+        }
+
+        const vec_t c = Bench_RandomVec();
+        const float e = Bench_Random(0.1f, 10.0f);
+        g_aabb_a[i].min = (vec_t) { c.x - e, c.y - e, c.z - e };
+        g_aabb_a[i].max = (vec_t) { c.x + e, c.y + e, c.z + e };
+        g_aabb_b[i].min = M_SubtractVec(&c, &(vec_t) { e, 2.0f * e, e });
+        g_aabb_b[i].max = M_AddVec(&c, &(vec_t) { 2.0f * e, e, e });
+        g_sphere[i].center = Bench_RandomVec();
+        g_sphere[i].radius = Bench_Random(0.1f, 20.0f);
+
+        g_float_a[i] = Bench_Random(-100.0f, 100.0f);
+        g_float_x[i] = a.x;
+        g_float_y[i] = a.y;
+        g_float_z[i] = a.z;
+    }
+}
+
+/* Give in-place benchmarks the same starting data each time. */
+static void
+Bench_ResetOutputs(void) {
+    memcpy(g_vec_out, g_vec_a, sizeof(g_vec_out));
+    memcpy(g_vec4_out, g_vec4_a, sizeof(g_vec4_out));
+    memcpy(g_mat_out, g_mat_a, sizeof(g_mat_out));
+    memcpy(g_aabb_out, g_aabb_a, sizeof(g_aabb_out));
+    memcpy(g_float_out, g_float_x, sizeof(g_float_out));
+    memcpy(g_float_out2, g_float_y, sizeof(g_float_out2));
+    memcpy(g_float_out3, g_float_z, sizeof(g_float_out3));
+}
+
+/* One call per element; results go to the global outputs so they are kept. */
+#define BENCH(NAME, BODY)                       \
+    static void                                 \
+    Bench_##NAME(size_t n) {                    \
+        for (size_t i = 0; i < n; i++) {        \
+            BODY;                               \
+        }                                       \
+    }
+
+/* One call over the whole input. */
+#define BENCH_BATCH(NAME, CALL)                 \
+    static void                                 \
+    Bench_##NAME(size_t n) {                    \
+        CALL;                                   \
+    }
+
+BENCH(M_AddVec, g_vec_out[i] = M_AddVec(&g_vec_a[i], &g_vec_b[i]))
+BENCH(M_AddVec4, g_vec4_out[i] = M_AddVec4(&g_vec4_a[i], &g_vec4_b[i]))
+BENCH(M_SubtractVec, g_vec_out[i] = M_SubtractVec(&g_vec_a[i], &g_vec_b[i]))
+BENCH(M_SubtractVec4,
+    g_vec4_out[i] = M_SubtractVec4(&g_vec4_a[i], &g_vec4_b[i]))
+BENCH(M_MultiplyVec, g_vec_out[i] = M_MultiplyVec(&g_vec_a[i], &g_vec_b[i]))
+BENCH(M_MultiplyVec4,
+    g_vec4_out[i] = M_MultiplyVec4(&g_vec4_a[i], &g_vec4_b[i]))
+BENCH(M_MultiplyVecByScalar,
+    g_vec_out[i] = M_MultiplyVecByScalar(&g_vec_a[i], g_float_a[i]))
+BENCH(M_DivideVec, g_vec_out[i] = M_DivideVec(&g_vec_a[i], 3.0f))
+BENCH(M_Distance, g_float_out[i] = M_Distance(&g_vec_a[i]))
+BENCH(M_NormalizeVec, M_NormalizeVec(&g_vec_out[i]))
+BENCH(M_Dot, g_float_out[i] = M_Dot(&g_vec_a[i], &g_vec_b[i]))
+BENCH(M_Cross, g_vec_out[i] = M_Cross(&g_vec_a[i], &g_vec_b[i]))
+BENCH(M_SumOfSquares, g_float_out[i] = M_SumOfSquares(&g_vec_a[i]))
+
+BENCH(M_MultiplyMat4, g_mat_out[i] = M_MultiplyMat4(&g_mat_a[i], &g_mat_b[i]))
+BENCH(M_MultiplyMat4Scalar,
+    g_mat_out[i] = M_MultiplyMat4Scalar(&g_mat_a[i], &g_mat_b[i]))
+BENCH(M_MultiplyMat4Vec4,
+    g_vec4_out[i] = M_MultiplyMat4Vec4(&g_mat_a[i], &g_vec4_a[i]))
+BENCH(M_MultiplyMat4Vec4Scalar,
+    g_vec4_out[i] = M_MultiplyMat4Vec4Scalar(&g_mat_a[i], &g_vec4_a[i]))
+BENCH(M_MultiplyMat4Affine,
+    g_mat_out[i] = M_MultiplyMat4Affine(&g_mat_a[i], &g_mat_b[i]))
+BENCH(M_MultiplyMat3,
+    g_mat3_out[i] = M_MultiplyMat3(&g_mat3_a[i], &g_mat3_b[i]))
+BENCH(M_Vec4Identity, g_vec4_out[i] = M_Vec4Identity())
+BENCH(M_Mat4Identity, g_mat_out[i] = M_Mat4Identity())
+BENCH(M_Mat3Identity, g_mat3_out[i] = M_Mat3Identity())
+
+BENCH_BATCH(M_TransformVec4Batch,
+    M_TransformVec4Batch(&g_mat_a[0], g_vec4_a, g_vec4_out, n))
+BENCH_BATCH(M_TransformPointsSoA,
+    M_TransformPointsSoA(&g_mat_a[0], g_float_x, g_float_y, g_float_z,
+        g_float_out, g_float_out2, g_float_out3, g_float_out4, n))
+BENCH_BATCH(M_NormalizeVecBatch, M_NormalizeVecBatch(g_vec_out, n))
+BENCH_BATCH(M_DotBatch, M_DotBatch(g_vec_a, g_vec_b, g_float_out, n))
+BENCH_BATCH(M_CrossBatch, M_CrossBatch(g_vec_a, g_vec_b, g_vec_out, n))
+
+BENCH(M_AABBEmpty, g_aabb_out[i] = M_AABBEmpty())
+BENCH(M_AABBUnion, g_aabb_out[i] = M_AABBUnion(&g_aabb_a[i], &g_aabb_b[i]))
+BENCH(M_AABBExpand, M_AABBExpand(&g_aabb_out[i], &g_vec_a[i]))
+BENCH(M_AABBCenter, g_vec_out[i] = M_AABBCenter(&g_aabb_a[i]))
+BENCH(M_AABBSurfaceArea, g_float_out[i] = M_AABBSurfaceArea(&g_aabb_a[i]))
+BENCH(M_AABBOverlap, g_int_out[i] = M_AABBOverlap(&g_aabb_a[i], &g_aabb_b[i]))
+BENCH(M_SphereOverlapAABB,
+    g_int_out[i] = M_SphereOverlapAABB(&g_sphere[i], &g_aabb_a[i]))
+BENCH(M_AABBFromSphere, g_aabb_out[i] = M_AABBFromSphere(&g_sphere[i]))
+
+BENCH(M_AddVec3a, {
+    const vec3a_t r = M_AddVec3a(M_Vec3aFromVec(&g_vec_a[i]),
+        M_Vec3aFromVec(&g_vec_b[i]));
+    g_vec_out[i] = M_VecFromVec3a(r);
+})
+BENCH(M_Dot3a, g_float_out[i] = M_Dot3a(M_Vec3aFromVec(&g_vec_a[i]),
+    M_Vec3aFromVec(&g_vec_b[i])))
+BENCH(M_Dot4a, g_float_out[i] = M_Dot4a(M_Vec4aFromVec4(&g_vec4_a[i]),
+    M_Vec4aFromVec4(&g_vec4_b[i])))
+BENCH(M_Cross3a, {
+    const vec3a_t r = M_Cross3a(M_Vec3aFromVec(&g_vec_a[i]),
+        M_Vec3aFromVec(&g_vec_b[i]));
+    g_vec_out[i] = M_VecFromVec3a(r);
+})
+BENCH(M_NormalizeVec3a,
+    g_vec_out[i] = M_VecFromVec3a(M_NormalizeVec3a(M_Vec3aFromVec(&g_vec_a[i]))))
+BENCH(M_MultiplyMat4aVec4a, {
+    const mat4a_t m = M_Mat4aFromMat4(&g_mat_a[i]);
+    g_vec4_out[i] = M_Vec4FromVec4a(
+        M_MultiplyMat4aVec4a(&m, M_Vec4aFromVec4(&g_vec4_a[i])));
+})
+BENCH(M_MultiplyMat4a, {
+    const mat4a_t a = M_Mat4aFromMat4(&g_mat_a[i]);
+    const mat4a_t b = M_Mat4aFromMat4(&g_mat_b[i]);
+    const mat4a_t r = M_MultiplyMat4a(&a, &b);
+    g_mat_out[i] = M_Mat4FromMat4a(&r);
+})
+
+BENCH(Mat4_TranslationMatrix, g_mat_out[i] = Mat4_TranslationMatrix(
+    g_vec_a[i].x, g_vec_a[i].y, g_vec_a[i].z))
+BENCH(Mat4_RotationMatrix,
+    g_mat_out[i] = Mat4_RotationMatrix(g_vec_a[i], g_float_a[i]))
+BENCH(Mat4_Rotate, Mat4_Rotate(&g_mat_out[i], g_vec_a[i], g_float_a[i]))
+BENCH(Mat4_PerspectiveProjection, g_mat_out[i] = Mat4_PerspectiveProjection(
+    M_PI / 3.0f, 1.0f + 1e-3f * g_float_a[i], 0.01f, 100.0f))
+BENCH(Mat4_LookAt, g_mat_out[i] = Mat4_LookAt(
+    g_vec_a[i], g_vec_b[i], (vec_t) { 0.0f, 0.0f, 1.0f }))
+BENCH(Mat4_Transpose, g_mat_out[i] = Mat4_Transpose(g_mat_a[i]))
+BENCH(Mat4_Inverse, g_int_out[i] = Mat4_Inverse(&g_mat_a[i], &g_mat_out[i]))
+BENCH(Mat4_InverseAffine,
+    g_int_out[i] = Mat4_InverseAffine(&g_mat_a[i], &g_mat_out[i]))
+BENCH(Mat4_InverseRigid, g_mat_out[i] = Mat4_InverseRigid(&g_mat_a[i]))
+BENCH(Mat4_NormalMatrix, g_mat3_out[i] = Mat4_NormalMatrix(&g_mat_a[i]))
+
+BENCH(Vec4_MultiplyMatrix, Vec4_MultiplyMatrix(&g_vec4_out[i], &g_mat_a[i]))
+BENCH(Vec4_Translate, Vec4_Translate(&g_vec4_out[i],
+    g_vec_b[i].x, g_vec_b[i].y, g_vec_b[i].z, 0.0f))
+BENCH(Vec4_Scale, Vec4_Scale(&g_vec4_out[i], g_unit_scale))
+BENCH(Vec_Translate, Vec_Translate(&g_vec_out[i],
+    g_vec_b[i].x, g_vec_b[i].y, g_vec_b[i].z))
+
+BENCH(M_FastRsqrt, g_float_out[i] = M_FastRsqrt(g_float_a[i] + 101.0f))
+BENCH(M_FastNormalizeVec, M_FastNormalizeVec(&g_vec_out[i]))
+BENCH_BATCH(M_FastNormalizeVecBatch, M_FastNormalizeVecBatch(g_vec_out, n))
+BENCH_BATCH(M_FastNormalizeSoA,
+    M_FastNormalizeSoA(g_float_out, g_float_out2, g_float_out3, n))
+BENCH(M_FastSinCos,
+    M_FastSinCos(g_float_a[i], &g_float_out[i], &g_float_out2[i]))
+BENCH_BATCH(M_FastSinCosBatch,
+    M_FastSinCosBatch(g_float_a, g_float_out, g_float_out2, n))
+
+#define ENTRY(NAME, SIMD) { #NAME, Bench_##NAME, SIMD }
+
+static const bench_t g_benches[] = {
+    ENTRY(M_AddVec, 0),
+    ENTRY(M_AddVec4, 0),
+    ENTRY(M_SubtractVec, 0),
+    ENTRY(M_SubtractVec4, 0),
+    ENTRY(M_MultiplyVec, 0),
+    ENTRY(M_MultiplyVec4, 0),
+    ENTRY(M_MultiplyVecByScalar, 0),
+    ENTRY(M_DivideVec, 0),
+    ENTRY(M_Distance, 0),
+    ENTRY(M_NormalizeVec, 0),
+    ENTRY(M_Dot, 0),
+    ENTRY(M_Cross, 0),
+    ENTRY(M_SumOfSquares, 0),
+
+    ENTRY(M_MultiplyMat4, 1),
+    ENTRY(M_MultiplyMat4Scalar, 0),
+    ENTRY(M_MultiplyMat4Vec4, 1),
+    ENTRY(M_MultiplyMat4Vec4Scalar, 0),
+    ENTRY(M_MultiplyMat4Affine, 1),
+    ENTRY(M_MultiplyMat3, 0),
+    ENTRY(M_Vec4Identity, 0),
+    ENTRY(M_Mat4Identity, 0),
+    ENTRY(M_Mat3Identity, 0),
+
+    ENTRY(M_TransformVec4Batch, 1),
+    ENTRY(M_TransformPointsSoA, 1),
+    ENTRY(M_NormalizeVecBatch, 1),
+    ENTRY(M_DotBatch, 1),
+    ENTRY(M_CrossBatch, 1),
+
+    ENTRY(M_AABBEmpty, 0),
+    ENTRY(M_AABBUnion, 0),
+    ENTRY(M_AABBExpand, 0),
+    ENTRY(M_AABBCenter, 0),
+    ENTRY(M_AABBSurfaceArea, 0),
+    ENTRY(M_AABBOverlap, 0),
+    ENTRY(M_SphereOverlapAABB, 0),
+    ENTRY(M_AABBFromSphere, 0),
+
+    ENTRY(M_AddVec3a, 0),
+    ENTRY(M_Dot3a, 0),
+    ENTRY(M_Dot4a, 0),
+    ENTRY(M_Cross3a, 0),
+    ENTRY(M_NormalizeVec3a, 0),
+    ENTRY(M_MultiplyMat4aVec4a, 0),
+    ENTRY(M_MultiplyMat4a, 0),
+
+    ENTRY(Mat4_TranslationMatrix, 0),
+    ENTRY(Mat4_RotationMatrix, 0),
+    ENTRY(Mat4_Rotate, 0),
+    ENTRY(Mat4_PerspectiveProjection, 0),
+    ENTRY(Mat4_LookAt, 0),
+    ENTRY(Mat4_Transpose, 0),
+    ENTRY(Mat4_Inverse, 0),
+    ENTRY(Mat4_InverseAffine, 0),
+    ENTRY(Mat4_InverseRigid, 0),
+    ENTRY(Mat4_NormalMatrix, 0),
+
+    ENTRY(Vec4_MultiplyMatrix, 1),
+    ENTRY(Vec4_Translate, 0),
+    ENTRY(Vec4_Scale, 0),
+    ENTRY(Vec_Translate, 0),
+
+    ENTRY(M_FastRsqrt, 0),
+    ENTRY(M_FastNormalizeVec, 0),
+    ENTRY(M_FastNormalizeVecBatch, 1),
+    ENTRY(M_FastNormalizeSoA, 1),
+    ENTRY(M_FastSinCos, 0),
+    ENTRY(M_FastSinCosBatch, 1),
+};
+
+static const char*
+Bench_SimdName(MathSimdLevel level) {
+    switch (level) {
+        case M_SIMD_SSE2:
+            return "sse2";
+        case M_SIMD_AVX:
+            return "avx";
+        case M_SIMD_FMA:
+            return "fma";
+        default:
+            return "scalar";
+    }
+}
+
+static double
+Bench_Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+Bench_Run(const bench_t* bench, const char* simd, int reps) {
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    double min = 0.0;
+
+    Bench_ResetOutputs();
+    for (int i = 0; i < BENCH_WARMUP_REPS; i++) {
+        bench->run(BENCH_COUNT);
+    }
+
+    for (int i = 0; i < reps; i++) {
+        const double start = Bench_Now();
+        bench->run(BENCH_COUNT);
+        const double ns = (Bench_Now() - start) / BENCH_COUNT;
+
+        sum += ns;
+        sum_sq += ns * ns;
+        if (i == 0 || ns < min) {
+            min = ns;
+        }
+    }
+
+    const double mean = sum / reps;
+    const double var = reps > 1
+        ? (sum_sq - sum * mean) / (reps - 1) : 0.0;
+
+    printf("{\"name\":\"%s\",\"simd\":\"%s\",\"ops\":%u,\"reps\":%d,"
+        "\"ns_per_op\":%.4f,\"ns_per_op_min\":%.4f,"
+        "\"ns_per_op_stddev\":%.4f,\"mops_per_s\":%.2f}\n",
+        bench->name, simd, BENCH_COUNT, reps, mean, min,
+        var > 0.0 ? sqrt(var) : 0.0, mean > 0.0 ? 1e3 / mean : 0.0);
+    fflush(stdout);
+}
+
+int
+main(int argc, char** argv) {
+    int reps = BENCH_DEFAULT_REPS;
+    const char* filter = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--reps N] [--filter SUBSTRING]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+
+    M_InitSimd();
+    const MathSimdLevel max_level = M_GetSimdLevel();
+    Bench_Setup();
+
+    const size_t bench_count = sizeof(g_benches) / sizeof(g_benches[0]);
+    for (size_t i = 0; i < bench_count; i++) {
+        const bench_t* bench = &g_benches[i];
+        if (filter && !strstr(bench->name, filter)) {
+            continue;
+        }
+
+        if (!bench->simd) {
+            M_SetSimdLevel(max_level);
+            Bench_Run(bench, "n/a", reps);
+            continue;
+        }
+
+        for (int level = M_SIMD_SCALAR; level <= (int) max_level; level++) {
+            if (M_SetSimdLevel((MathSimdLevel) level) != level) {
+                continue;
+            }
+            Bench_Run(bench, Bench_SimdName((MathSimdLevel) level), reps);
+        }
+    }
+
+    M_SetSimdLevel(max_level);
+    return 0;
+}
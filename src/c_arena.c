@@ -0,0 +1,381 @@
+/* mmap flags such as MAP_ANONYMOUS are extensions to strict c99 headers */
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
+#include "c_arena.h"
+#include "c_log.h"
+#include "c_memory.h"
+
+#include <stdint.h>
+#include <SDL3/SDL.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <sys/mman.h>
+  #define ARENA_VIRTUAL_MEMORY 1
+#else
+  #define ARENA_VIRTUAL_MEMORY 0
+#endif
+
+/* Offset of the usable memory behind a block header. */
+#define ARENA_HEADER_SIZE \
+  ((sizeof(arena_block_t) + CGAME_ARENA_ALIGN - 1) \
+    & ~(size_t) (CGAME_ARENA_ALIGN - 1))
+
+static arena_t main_arena;
+
+static void
+C_ArenaUseBlock(arena_t* arena, arena_block_t* block, size_t used) {
+  arena->block = block;
+  arena->data = (char*) block + ARENA_HEADER_SIZE;
+  arena->size = block->size;
+  arena->used = used;
+}
+
+static arena_block_t*
+C_ArenaNewBlock(arena_block_t* prev, size_t size) {
+  if (size > SIZE_MAX - ARENA_HEADER_SIZE) {
+    return NULL;
+  }
+
+  arena_block_t* block = C_Malloc(ARENA_HEADER_SIZE + size);
+  if (!block) {
+    return NULL;
+  }
+
+  block->prev = prev;
+  block->size = size;
+  block->committed = size;
+  block->reserved = 0;
+  return block;
+}
+
+#if ARENA_VIRTUAL_MEMORY
+
+static size_t
+C_ArenaRoundCommit(size_t size) {
+  return (size + CGAME_ARENA_COMMIT_SIZE - 1)
+    & ~(size_t) (CGAME_ARENA_COMMIT_SIZE - 1);
+}
+
+/* Reserve address space for a block and commit its first page. */
+static arena_block_t*
+C_ArenaMapBlock(size_t size, unsigned int flags) {
+  if (size > SIZE_MAX - ARENA_HEADER_SIZE - 2 * CGAME_ARENA_COMMIT_SIZE) {
+    return NULL;
+  }
+  const size_t length = C_ArenaRoundCommit(ARENA_HEADER_SIZE + size);
+  char* base = MAP_FAILED;
+  size_t committed = CGAME_ARENA_COMMIT_SIZE;
+
+#ifdef MAP_HUGETLB
+  // explicit huge pages only exist if the system set some aside; they are
+  // reserved up front, so this either fully succeeds or fails right here
+  if (flags & CGAME_ARENA_HUGE_PAGES) {
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    committed = length;
+  }
+#endif
+
+  if (base == MAP_FAILED) {
+    int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    map_flags |= MAP_NORESERVE;
+#endif
+    // over-reserve so the block can start on a huge page boundary
+    const size_t padded = length + CGAME_ARENA_COMMIT_SIZE;
+    char* raw = mmap(NULL, padded, PROT_NONE, map_flags, -1, 0);
+    if (raw == MAP_FAILED) {
+      return NULL;
+    }
+
+    base = (char*) C_ArenaRoundCommit((uintptr_t) raw);
+    const size_t head = (size_t) (base - raw);
+    if (head) {
+      munmap(raw, head);
+    }
+    if (padded - head > length) {
+      munmap(base + length, padded - head - length);
+    }
+
+#ifdef MADV_HUGEPAGE
+    // transparent huge pages, if enabled, fill in as pages are committed
+    if (flags & CGAME_ARENA_HUGE_PAGES) {
+      madvise(base, length, MADV_HUGEPAGE);
+    }
+#endif
+
+    committed = CGAME_ARENA_COMMIT_SIZE;
+    if (mprotect(base, committed, PROT_READ | PROT_WRITE) != 0) {
+      munmap(base, length);
+      return NULL;
+    }
+  }
+
+  arena_block_t* block = (arena_block_t*) base;
+  block->prev = NULL;
+  block->size = length - ARENA_HEADER_SIZE;
+  block->committed = committed - ARENA_HEADER_SIZE;
+  block->reserved = length;
+  return block;
+}
+
+/* Back the first end bytes of a reserved block with memory. */
+static int
+C_ArenaCommit(arena_block_t* block, size_t end) {
+  size_t target = C_ArenaRoundCommit(ARENA_HEADER_SIZE + end);
+  if (target > block->reserved) {
+    target = block->reserved;
+  }
+
+  const size_t current = ARENA_HEADER_SIZE + block->committed;
+  if (target <= current) {
+    return 1;
+  }
+  if (mprotect((char*) block + current, target - current,
+    PROT_READ | PROT_WRITE) != 0) {
+    return 0;
+  }
+
+  block->committed = target - ARENA_HEADER_SIZE;
+  return 1;
+}
+
+/* Return the pages of a reserved block past its first keep bytes. */
+static void
+C_ArenaDecommitBlock(arena_block_t* block, size_t keep) {
+  const size_t from = C_ArenaRoundCommit(ARENA_HEADER_SIZE + keep);
+  const size_t current = ARENA_HEADER_SIZE + block->committed;
+  if (from >= current) {
+    return;
+  }
+
+  char* start = (char*) block + from;
+#ifdef MADV_DONTNEED
+  madvise(start, current - from, MADV_DONTNEED);
+#endif
+  mprotect(start, current - from, PROT_NONE);
+  block->committed = from - ARENA_HEADER_SIZE;
+}
+
+#endif // ARENA_VIRTUAL_MEMORY
+
+static void
+C_ArenaFreeBlock(arena_block_t* block) {
+#if ARENA_VIRTUAL_MEMORY
+  if (block->reserved) {
+    munmap(block, block->reserved);
+    return;
+  }
+#endif
+  SDL_free(block);
+}
+
+int
+C_ArenaCreate(arena_t* arena, size_t size, size_t grow_size) {
+  SDL_memset(arena, 0, sizeof(*arena));
+
+  arena_block_t* block = C_ArenaNewBlock(NULL, size);
+  if (!block) {
+    G_Log("ERROR", "Failed to allocate memory for arena.");
+    return 0;
+  }
+
+  C_ArenaUseBlock(arena, block, 0);
+  arena->grow_size = grow_size;
+  return 1;
+}
+
+int
+C_ArenaReserve(
+  arena_t* arena,
+  size_t size,
+  size_t grow_size,
+  unsigned int flags) {
+#if ARENA_VIRTUAL_MEMORY
+  SDL_memset(arena, 0, sizeof(*arena));
+
+  arena_block_t* block = C_ArenaMapBlock(size, flags);
+  if (block) {
+    C_ArenaUseBlock(arena, block, 0);
+    arena->grow_size = grow_size;
+    arena->flags = flags;
+    return 1;
+  }
+  G_Log("WARNING", "Failed to reserve arena memory, using the heap.");
+#else
+  (void) flags;
+#endif
+  return C_ArenaCreate(arena, size, grow_size);
+}
+
+void
+C_ArenaDecommit(arena_t* arena) {
+#if ARENA_VIRTUAL_MEMORY
+  if (arena->block && arena->block->reserved) {
+    C_ArenaDecommitBlock(arena->block, arena->used);
+  }
+#else
+  (void) arena;
+#endif
+}
+
+void
+C_ArenaDestroy(arena_t* arena) {
+  arena_block_t* block = arena->block;
+  while (block) {
+    arena_block_t* prev = block->prev;
+    C_ArenaFreeBlock(block);
+    block = prev;
+  }
+
+  SDL_memset(arena, 0, sizeof(*arena));
+}
+
+void*
+C_ArenaAlloc(arena_t* arena, size_t size, size_t align) {
+  char msg[128];
+
+  if (align == 0) {
+    align = CGAME_ARENA_ALIGN;
+  }
+  if (align & (align - 1)) {
+    G_Log("ERROR", "Arena alignment must be a power of two.");
+    return NULL;
+  }
+  if (!arena->block) {
+    G_Log("ERROR", "Allocation from an arena that was never created.");
+    return NULL;
+  }
+
+  // offset of the next aligned address in the current block. every step is
+  // checked so huge sizes fail instead of wrapping around
+  const uintptr_t base = (uintptr_t) arena->data;
+  const uintptr_t top = base + arena->used;
+  size_t offset = arena->used + ((align - (top & (align - 1))) & (align - 1));
+
+  if (offset > arena->size || size > arena->size - offset) {
+    if (!arena->grow_size) {
+      snprintf(msg, sizeof(msg),
+        "Arena overflow: %zu bytes requested, %zu of %zu left.",
+        size, arena->size - arena->used, arena->size);
+      G_Log("ERROR", msg);
+      return NULL;
+    }
+    if (size > SIZE_MAX - align) {
+      G_Log("ERROR", "Arena allocation size overflows.");
+      return NULL;
+    }
+
+    const size_t block_size = size + align > arena->grow_size
+      ? size + align : arena->grow_size;
+    arena_block_t* block = C_ArenaNewBlock(arena->block, block_size);
+    if (!block) {
+      snprintf(msg, sizeof(msg),
+        "Failed to grow arena by %zu bytes.", block_size);
+      G_Log("ERROR", msg);
+      return NULL;
+    }
+
+    // the unused tail of the old block counts as used until rewound
+    arena->total += arena->size - arena->used;
+    C_ArenaUseBlock(arena, block, 0);
+
+    const uintptr_t new_base = (uintptr_t) arena->data;
+    offset = (align - (new_base & (align - 1))) & (align - 1);
+  }
+
+#if ARENA_VIRTUAL_MEMORY
+  if (offset + size > arena->block->committed
+    && !C_ArenaCommit(arena->block, offset + size)) {
+    snprintf(msg, sizeof(msg),
+      "Failed to commit %zu bytes of arena memory.", offset + size);
+    G_Log("ERROR", msg);
+    return NULL;
+  }
+#endif
+
+  void* ptr = (char*) arena->data + offset;
+  arena->total += offset - arena->used + size;
+  arena->used = offset + size;
+  if (arena->total > arena->peak) {
+    arena->peak = arena->total;
+  }
+
+  return ptr;
+}
+
+void*
+C_ArenaAllocArray(arena_t* arena, size_t count, size_t size) {
+  if (size && count > SIZE_MAX / size) {
+    G_Log("ERROR", "Arena array size overflows.");
+    return NULL;
+  }
+
+  void* ptr = C_ArenaAlloc(arena, count * size, 0);
+  if (ptr) {
+    SDL_memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+arena_mark_t
+C_ArenaMark(const arena_t* arena) {
+  arena_mark_t mark = {
+    .block = arena->block,
+    .used = arena->used,
+    .total = arena->total
+  };
+  return mark;
+}
+
+void
+C_ArenaRewind(arena_t* arena, arena_mark_t mark) {
+  arena_block_t* block = arena->block;
+  while (block && block != mark.block) {
+    block = block->prev;
+  }
+  if (!block) {
+    G_Log("ERROR", "Rewind to a mark from another arena.");
+    return;
+  }
+
+  // free blocks chained on after the mark
+  block = arena->block;
+  while (block != mark.block) {
+    arena_block_t* prev = block->prev;
+    C_ArenaFreeBlock(block);
+    block = prev;
+  }
+
+  C_ArenaUseBlock(arena, block, mark.used);
+  arena->total = mark.total;
+}
+
+void
+C_ArenaReset(arena_t* arena) {
+  arena_block_t* block = arena->block;
+  if (!block) {
+    return;
+  }
+
+  while (block->prev) {
+    arena_block_t* prev = block->prev;
+    C_ArenaFreeBlock(block);
+    block = prev;
+  }
+
+  C_ArenaUseBlock(arena, block, 0);
+  arena->total = 0;
+
+#if ARENA_VIRTUAL_MEMORY
+  if (block->reserved && (arena->flags & CGAME_ARENA_DECOMMIT_ON_RESET)) {
+    C_ArenaDecommitBlock(block, 0);
+  }
+#endif
+}
+
+arena_t*
+C_MainArena(void) {
+  return &main_arena;
+}
@@ -1,10 +1,171 @@
 #ifndef ARENA_H_
 #define ARENA_H_
 
+#include <stddef.h>
+
 #define CGAME_ARENA_INIT_SIZE 64000000u
 
+/* Size of blocks chained on when an arena runs out, 0 to never grow. */
+#define CGAME_ARENA_GROW_SIZE 4000000u
+
+/* Alignment used when an allocation passes 0. */
+#define CGAME_ARENA_ALIGN 16u
+
+/* Granularity reserved arenas commit memory in; one huge page. */
+#define CGAME_ARENA_COMMIT_SIZE (2u * 1024u * 1024u)
+
+/* C_ArenaReserve flags. Huge pages are tried with MAP_HUGETLB first, then
+ * requested with MADV_HUGEPAGE; without either the arena uses normal pages. */
+#define CGAME_ARENA_HUGE_PAGES 0x1u
+#define CGAME_ARENA_DECOMMIT_ON_RESET 0x2u
+
+/* Header in front of every block; blocks are chained newest first. */
+typedef struct arena_block_t {
+  struct arena_block_t* prev;
+  size_t size;
+
+  /* Bytes after the header backed by memory; size for heap blocks. */
+  size_t committed;
+
+  /* Length of the mapping for reserved blocks, 0 for heap blocks. */
+  size_t reserved;
+} arena_block_t;
+
+/**
+ * Linear (bump) allocator. Allocations are carved from the current block in
+ * order and are only ever released all at once, by rewinding to a mark or
+ * resetting. Not thread safe.
+ */
 typedef struct {
+  /* Start of the current block. */
   void* data;
+
+  /* Bytes used and available in the current block. */
+  size_t used;
+  size_t size;
+
+  /* Current block, NULL until the arena is created. */
+  arena_block_t* block;
+
+  /* Size of blocks added when the current one fills up, 0 to never grow. */
+  size_t grow_size;
+
+  /* Bytes handed out across all blocks (including alignment padding), and
+   * the most that was ever handed out at once. */
+  size_t total;
+  size_t peak;
+
+  /* CGAME_ARENA_* flags of a reserved arena. */
+  unsigned int flags;
 } arena_t;
 
-#endif
\ No newline at end of file
+/* Position in an arena to rewind to. */
+typedef struct {
+  arena_block_t* block;
+  size_t used;
+  size_t total;
+} arena_mark_t;
+
+/**
+ * Allocate the first block of an arena.
+ * @param arena The arena.
+ * @param size The size of the first block.
+ * @param grow_size The size of blocks chained on when full, 0 to fail instead.
+ * @returns Success or failure.
+ */
+int
+C_ArenaCreate(arena_t* arena, size_t size, size_t grow_size);
+
+/**
+ * Create an arena whose first block is a virtual memory reservation. Pages
+ * are committed in CGAME_ARENA_COMMIT_SIZE steps as allocations reach them,
+ * so a large reservation costs little until used. Falls back to
+ * C_ArenaCreate where virtual memory is not available.
+ * @param arena The arena.
+ * @param size The size to reserve.
+ * @param grow_size The size of heap blocks chained on when full, 0 to fail
+ * instead.
+ * @param flags CGAME_ARENA_HUGE_PAGES and CGAME_ARENA_DECOMMIT_ON_RESET.
+ * @returns Success or failure.
+ */
+int
+C_ArenaReserve(
+  arena_t* arena,
+  size_t size,
+  size_t grow_size,
+  unsigned int flags);
+
+/**
+ * Return the committed pages of the current block past its used part to the
+ * system. Does nothing for heap blocks.
+ * @param arena The arena.
+ */
+void
+C_ArenaDecommit(arena_t* arena);
+
+/**
+ * Free every block of the arena.
+ * @param arena The arena.
+ */
+void
+C_ArenaDestroy(arena_t* arena);
+
+/**
+ * Allocate uninitialized memory from the arena.
+ * @param arena The arena.
+ * @param size The number of bytes.
+ * @param align The alignment, a power of two, or 0 for CGAME_ARENA_ALIGN.
+ * @returns The memory, or NULL if the arena is full and cannot grow.
+ */
+void*
+C_ArenaAlloc(arena_t* arena, size_t size, size_t align);
+
+/**
+ * Allocate a zeroed array from the arena, checking count * size for
+ * overflow.
+ * @param arena The arena.
+ * @param count The number of elements.
+ * @param size The size of one element.
+ * @returns The memory, or NULL on overflow or if the arena is full.
+ */
+void*
+C_ArenaAllocArray(arena_t* arena, size_t count, size_t size);
+
+/* Allocate a zeroed array of count elements of type. */
+#define C_ArenaNew(arena, type, count) \
+  ((type*) C_ArenaAllocArray((arena), (count), sizeof(type)))
+
+/**
+ * Get the current position of the arena.
+ * @param arena The arena.
+ * @returns The mark.
+ */
+arena_mark_t
+C_ArenaMark(const arena_t* arena);
+
+/**
+ * Release everything allocated after the mark was taken. Blocks chained on
+ * since then are freed.
+ * @param arena The arena.
+ * @param mark A mark taken from this arena.
+ */
+void
+C_ArenaRewind(arena_t* arena, arena_mark_t mark);
+
+/**
+ * Release every allocation, keeping only the first block. With
+ * CGAME_ARENA_DECOMMIT_ON_RESET, its pages are also returned to the system.
+ * @param arena The arena.
+ */
+void
+C_ArenaReset(arena_t* arena);
+
+/**
+ * The main arena, for short-lived allocations on the main thread. Take a mark
+ * before allocating and rewind to it when done. Created in G_Init.
+ * @returns The main arena.
+ */
+arena_t*
+C_MainArena(void);
+
+#endif
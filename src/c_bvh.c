@@ -0,0 +1,796 @@
+#define VEC_IMPL_H_
+#include <SDL3/SDL.h>
+
+#include "c_bvh.h"
+#include "c_log.h"
+#include "c_memory.h"
+
+/* SAH cost of visiting an inner node, relative to one primitive test. */
+#define BVH_TRAVERSAL_COST 1.0f
+
+/* Leaves may grow to this size when no split beats the leaf cost. */
+#define BVH_MAX_SAH_LEAF_SIZE (BVH_MAX_LEAF_SIZE * 4)
+
+typedef struct bvh_bin_t {
+    aabb_t bounds;
+    uint32_t count;
+} bvh_bin_t;
+
+typedef struct bvh_builder_t {
+    bvh_t* bvh;
+    vec_t* centroids;
+    int thread_count;
+
+    SDL_AtomicInt node_count;
+
+    /* Threads that may still be started, for subtrees or node scans. */
+    SDL_AtomicInt free_threads;
+} bvh_builder_t;
+
+/* One slice of a node's primitives, scanned by one thread. */
+typedef struct bvh_scan_t {
+    const bvh_builder_t* builder;
+    uint32_t first;
+    uint32_t count;
+
+    // binning input
+    vec_t centroid_min;
+    vec_t bin_scale;
+
+    // results
+    aabb_t bounds;
+    aabb_t centroid_bounds;
+    bvh_bin_t bins[3][BVH_BIN_COUNT];
+} bvh_scan_t;
+
+typedef struct bvh_task_t {
+    bvh_builder_t* builder;
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+    int depth;
+} bvh_task_t;
+
+/* Four rays in SIMD-friendly layout. */
+typedef struct bvh_packet_t {
+    float ox[4] M_ALIGN16;
+    float oy[4] M_ALIGN16;
+    float oz[4] M_ALIGN16;
+    float ix[4] M_ALIGN16;
+    float iy[4] M_ALIGN16;
+    float iz[4] M_ALIGN16;
+
+    /* Closest hit so far, starts at t_max. Negative for lanes that are done. */
+    float t[4] M_ALIGN16;
+} bvh_packet_t;
+
+typedef int (*bvh_slab4_fn)(const bvh_packet_t* p, const aabb_t* box);
+
+static inline float
+BVH_Axis(const vec_t* v, int axis) {
+    return axis == 0 ? v->x : (axis == 1 ? v->y : v->z);
+}
+
+static inline int
+BVH_BinIndex(const bvh_scan_t* scan, const vec_t* c, int axis) {
+    const int b = (int) ((BVH_Axis(c, axis) - BVH_Axis(&scan->centroid_min,
+        axis)) * BVH_Axis(&scan->bin_scale, axis));
+    return b < 0 ? 0 : (b >= BVH_BIN_COUNT ? BVH_BIN_COUNT - 1 : b);
+}
+
+static int SDLCALL
+BVH_BoundsJob(void* data) {
+    bvh_scan_t* scan = data;
+    const bvh_t* bvh = scan->builder->bvh;
+
+    scan->bounds = M_AABBEmpty();
+    scan->centroid_bounds = M_AABBEmpty();
+    for (uint32_t i = scan->first; i < scan->first + scan->count; i++) {
+        const uint32_t prim = bvh->indices[i];
+        scan->bounds = M_AABBUnion(&scan->bounds, &bvh->prim_bounds[prim]);
+        M_AABBExpand(&scan->centroid_bounds, &scan->builder->centroids[prim]);
+    }
+
+    return 0;
+}
+
+static int SDLCALL
+BVH_BinJob(void* data) {
+    bvh_scan_t* scan = data;
+    const bvh_t* bvh = scan->builder->bvh;
+
+    for (int axis = 0; axis < 3; axis++) {
+        for (int b = 0; b < BVH_BIN_COUNT; b++) {
+            scan->bins[axis][b].bounds = M_AABBEmpty();
+            scan->bins[axis][b].count = 0;
+        }
+    }
+
+    for (uint32_t i = scan->first; i < scan->first + scan->count; i++) {
+        const uint32_t prim = bvh->indices[i];
+        const vec_t* c = &scan->builder->centroids[prim];
+        for (int axis = 0; axis < 3; axis++) {
+            bvh_bin_t* bin = &scan->bins[axis][BVH_BinIndex(scan, c, axis)];
+            bin->count++;
+            bin->bounds = M_AABBUnion(&bin->bounds, &bvh->prim_bounds[prim]);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Take up to wanted threads from the builder's budget.
+ *
+ * @return The number taken, which the caller gives back when done.
+ */
+static int
+BVH_ClaimThreads(bvh_builder_t* b, int wanted) {
+    int available = SDL_GetAtomicInt(&b->free_threads);
+    while (available > 0 && wanted > 0) {
+        const int take = available < wanted ? available : wanted;
+        if (SDL_CompareAndSwapAtomicInt(
+            &b->free_threads, available, available - take)) {
+            return take;
+        }
+        available = SDL_GetAtomicInt(&b->free_threads);
+    }
+
+    return 0;
+}
+
+/**
+ * Run a scan job over slices of the node, one slice on this thread and the
+ * rest on threads claimed from the builder's budget. Slices whose thread
+ * cannot be started run inline.
+ */
+static void
+BVH_RunScan(SDL_ThreadFunction job, bvh_scan_t* scans, int slice_count) {
+    SDL_Thread* threads[BVH_MAX_THREADS] = { 0 };
+
+    for (int i = 1; i < slice_count; i++) {
+        threads[i] = SDL_CreateThread(job, "bvh_scan", &scans[i]);
+        if (!threads[i]) {
+            job(&scans[i]);
+        }
+    }
+    job(&scans[0]);
+
+    for (int i = 1; i < slice_count; i++) {
+        if (threads[i]) {
+            SDL_WaitThread(threads[i], NULL);
+        }
+    }
+}
+
+/**
+ * Compute the node bounds and pick a split, scanning the primitives in
+ * slice_count slices. Partitions indices so the left child covers the first
+ * *out_left_count primitives.
+ *
+ * @return 1 if the node should be split, 0 if it should be a leaf.
+ */
+static int
+BVH_FindSplitSlices(
+    bvh_builder_t* b,
+    uint32_t first,
+    uint32_t count,
+    int depth,
+    int slice_count,
+    aabb_t* out_bounds,
+    uint32_t* out_left_count) {
+    bvh_scan_t scans[BVH_MAX_THREADS];
+
+    for (int i = 0; i < slice_count; i++) {
+        const uint32_t begin = (uint32_t) ((uint64_t) count * i / slice_count);
+        const uint32_t end = (uint32_t) ((uint64_t) count * (i + 1)
+            / slice_count);
+        scans[i].builder = b;
+        scans[i].first = first + begin;
+        scans[i].count = end - begin;
+    }
+
+    BVH_RunScan(BVH_BoundsJob, scans, slice_count);
+
+    aabb_t centroid_bounds = scans[0].centroid_bounds;
+    *out_bounds = scans[0].bounds;
+    for (int i = 1; i < slice_count; i++) {
+        *out_bounds = M_AABBUnion(out_bounds, &scans[i].bounds);
+        centroid_bounds = M_AABBUnion(&centroid_bounds,
+            &scans[i].centroid_bounds);
+    }
+
+    if (count <= BVH_MAX_LEAF_SIZE || depth >= BVH_MAX_DEPTH) {
+        return 0;
+    }
+
+    const vec_t extent = {
+        centroid_bounds.max.x - centroid_bounds.min.x,
+        centroid_bounds.max.y - centroid_bounds.min.y,
+        centroid_bounds.max.z - centroid_bounds.min.z
+    };
+    if (extent.x <= 0.0f && extent.y <= 0.0f && extent.z <= 0.0f) {
+        // every centroid coincides, binning cannot separate them
+        *out_left_count = count / 2;
+        return 1;
+    }
+
+    const vec_t scale = {
+        extent.x > 0.0f ? BVH_BIN_COUNT / extent.x : 0.0f,
+        extent.y > 0.0f ? BVH_BIN_COUNT / extent.y : 0.0f,
+        extent.z > 0.0f ? BVH_BIN_COUNT / extent.z : 0.0f
+    };
+    for (int i = 0; i < slice_count; i++) {
+        scans[i].centroid_min = centroid_bounds.min;
+        scans[i].bin_scale = scale;
+    }
+
+    BVH_RunScan(BVH_BinJob, scans, slice_count);
+
+    for (int i = 1; i < slice_count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (int j = 0; j < BVH_BIN_COUNT; j++) {
+                bvh_bin_t* dst = &scans[0].bins[axis][j];
+                const bvh_bin_t* src = &scans[i].bins[axis][j];
+                dst->count += src->count;
+                dst->bounds = M_AABBUnion(&dst->bounds, &src->bounds);
+            }
+        }
+    }
+
+    // sweep each axis from the right, then from the left to find the split
+    // plane with the lowest surface area cost
+    float best_cost = FLT_MAX;
+    int best_axis = -1;
+    int best_bin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (BVH_Axis(&extent, axis) <= 0.0f) {
+            continue;
+        }
+
+        const bvh_bin_t* bins = scans[0].bins[axis];
+        float right_area[BVH_BIN_COUNT];
+        uint32_t right_count[BVH_BIN_COUNT];
+        aabb_t box = M_AABBEmpty();
+        uint32_t n = 0;
+        for (int j = BVH_BIN_COUNT - 1; j > 0; j--) {
+            box = M_AABBUnion(&box, &bins[j].bounds);
+            n += bins[j].count;
+            right_area[j] = M_AABBSurfaceArea(&box);
+            right_count[j] = n;
+        }
+
+        box = M_AABBEmpty();
+        n = 0;
+        for (int j = 1; j < BVH_BIN_COUNT; j++) {
+            box = M_AABBUnion(&box, &bins[j - 1].bounds);
+            n += bins[j - 1].count;
+            if (n == 0 || right_count[j] == 0) {
+                continue;
+            }
+
+            const float cost = n * M_AABBSurfaceArea(&box)
+                + right_count[j] * right_area[j];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_bin = j;
+            }
+        }
+    }
+
+    const float area = M_AABBSurfaceArea(out_bounds);
+    const float leaf_cost = count * area;
+    if (best_axis < 0) {
+        *out_left_count = count / 2;
+        return 1;
+    }
+    if (BVH_TRAVERSAL_COST * area + best_cost >= leaf_cost
+        && count <= BVH_MAX_SAH_LEAF_SIZE) {
+        return 0;
+    }
+
+    // partition the indices around the chosen bin boundary
+    uint32_t* indices = b->bvh->indices;
+    uint32_t i = first;
+    uint32_t j = first + count;
+    while (i < j) {
+        const vec_t* c = &b->centroids[indices[i]];
+        if (BVH_BinIndex(&scans[0], c, best_axis) < best_bin) {
+            i++;
+        } else {
+            const uint32_t tmp = indices[i];
+            indices[i] = indices[--j];
+            indices[j] = tmp;
+        }
+    }
+
+    *out_left_count = i - first;
+    return 1;
+}
+
+/**
+ * Scan the node on as many threads as the budget has free, so subtree and
+ * scan threads together never exceed the thread count. Each slice gets at
+ * least BVH_PARALLEL_THRESHOLD primitives to pay for its thread.
+ */
+static int
+BVH_FindSplit(
+    bvh_builder_t* b,
+    uint32_t first,
+    uint32_t count,
+    int depth,
+    aabb_t* out_bounds,
+    uint32_t* out_left_count) {
+    int helpers = 0;
+    if (count >= 2 * BVH_PARALLEL_THRESHOLD) {
+        const uint32_t slices = count / BVH_PARALLEL_THRESHOLD;
+        helpers = BVH_ClaimThreads(b, slices < (uint32_t) b->thread_count
+            ? (int) slices - 1 : b->thread_count - 1);
+    }
+
+    const int split = BVH_FindSplitSlices(b, first, count, depth, helpers + 1,
+        out_bounds, out_left_count);
+
+    if (helpers) {
+        SDL_AddAtomicInt(&b->free_threads, helpers);
+    }
+    return split;
+}
+
+static void
+BVH_BuildNode(
+    bvh_builder_t* b,
+    uint32_t node_index,
+    uint32_t first,
+    uint32_t count,
+    int depth);
+
+static int SDLCALL
+BVH_BuildTask(void* data) {
+    bvh_task_t* task = data;
+    BVH_BuildNode(task->builder, task->node, task->first, task->count,
+        task->depth);
+    return 0;
+}
+
+static void
+BVH_BuildNode(
+    bvh_builder_t* b,
+    uint32_t node_index,
+    uint32_t first,
+    uint32_t count,
+    int depth) {
+    bvh_node_t* node = &b->bvh->nodes[node_index];
+
+    uint32_t left_count = 0;
+    if (!BVH_FindSplit(b, first, count, depth, &node->bounds, &left_count)) {
+        node->first = first;
+        node->count = count;
+        return;
+    }
+
+    // children are allocated as a pair, after their parent
+    const uint32_t child = (uint32_t) SDL_AddAtomicInt(&b->node_count, 2);
+    node->first = child;
+    node->count = 0;
+
+    bvh_task_t left = {
+        .builder = b,
+        .node = child,
+        .first = first,
+        .count = left_count,
+        .depth = depth + 1
+    };
+
+    SDL_Thread* thread = NULL;
+    if (left_count >= BVH_PARALLEL_THRESHOLD
+        && count - left_count >= BVH_PARALLEL_THRESHOLD) {
+        if (SDL_AddAtomicInt(&b->free_threads, -1) > 0) {
+            thread = SDL_CreateThread(BVH_BuildTask, "bvh_build", &left);
+        }
+        if (!thread) {
+            SDL_AddAtomicInt(&b->free_threads, 1);
+        }
+    }
+
+    if (!thread) {
+        BVH_BuildTask(&left);
+    }
+    BVH_BuildNode(b, child + 1, first + left_count, count - left_count,
+        depth + 1);
+
+    if (thread) {
+        SDL_WaitThread(thread, NULL);
+        SDL_AddAtomicInt(&b->free_threads, 1);
+    }
+}
+
+int
+BVH_Build(
+    bvh_t* bvh,
+    const aabb_t* bounds,
+    uint32_t count,
+    int thread_count) {
+    SDL_memset(bvh, 0, sizeof(*bvh));
+    if (count == 0) {
+        return 1;
+    }
+    if (count > UINT32_MAX / 2) {
+        G_Log("ERROR", "Too many primitives for a BVH.");
+        return 0;
+    }
+
+    if (thread_count <= 0) {
+        thread_count = SDL_GetNumLogicalCPUCores();
+    }
+    if (thread_count < 1) {
+        thread_count = 1;
+    } else if (thread_count > BVH_MAX_THREADS) {
+        thread_count = BVH_MAX_THREADS;
+    }
+
+    bvh->nodes = C_Malloc((2 * (size_t) count - 1) * sizeof(bvh_node_t));
+    bvh->indices = C_Malloc(count * sizeof(uint32_t));
+    bvh->prim_bounds = C_Malloc(count * sizeof(aabb_t));
+    vec_t* centroids = C_Malloc(count * sizeof(vec_t));
+    if (!bvh->nodes || !bvh->indices || !bvh->prim_bounds || !centroids) {
+        G_Log("ERROR", "Failed to allocate memory for BVH.");
+        SDL_free(centroids);
+        BVH_Destroy(bvh);
+        return 0;
+    }
+
+    bvh->prim_count = count;
+    SDL_memcpy(bvh->prim_bounds, bounds, count * sizeof(aabb_t));
+    for (uint32_t i = 0; i < count; i++) {
+        bvh->indices[i] = i;
+        centroids[i] = M_AABBCenter(&bounds[i]);
+    }
+
+    bvh_builder_t builder = {
+        .bvh = bvh,
+        .centroids = centroids,
+        .thread_count = thread_count
+    };
+    SDL_SetAtomicInt(&builder.node_count, 1);
+    SDL_SetAtomicInt(&builder.free_threads, thread_count - 1);
+
+    BVH_BuildNode(&builder, 0, 0, count, 0);
+    bvh->node_count = (uint32_t) SDL_GetAtomicInt(&builder.node_count);
+
+    SDL_free(centroids);
+    return 1;
+}
+
+void
+BVH_Refit(bvh_t* bvh, const aabb_t* bounds) {
+    SDL_memcpy(bvh->prim_bounds, bounds, bvh->prim_count * sizeof(aabb_t));
+
+    // children always follow their parent, so a reverse sweep sees every
+    // child before the node that contains it
+    for (uint32_t i = bvh->node_count; i-- > 0;) {
+        bvh_node_t* node = &bvh->nodes[i];
+        if (node->count) {
+            aabb_t box = M_AABBEmpty();
+            for (uint32_t j = node->first; j < node->first + node->count; j++) {
+                box = M_AABBUnion(&box, &bvh->prim_bounds[bvh->indices[j]]);
+            }
+            node->bounds = box;
+        } else {
+            node->bounds = M_AABBUnion(&bvh->nodes[node->first].bounds,
+                &bvh->nodes[node->first + 1].bounds);
+        }
+    }
+}
+
+void
+BVH_Destroy(bvh_t* bvh) {
+    SDL_free(bvh->nodes);
+    SDL_free(bvh->indices);
+    SDL_free(bvh->prim_bounds);
+    SDL_memset(bvh, 0, sizeof(*bvh));
+}
+
+/**
+ * Slab test of one packet lane. On a hit closer than *t, writes the entry
+ * distance to *t.
+ */
+static int
+BVH_SlabTest(const bvh_packet_t* p, int lane, const aabb_t* box, float* t) {
+    const float t1x = (box->min.x - p->ox[lane]) * p->ix[lane];
+    const float t2x = (box->max.x - p->ox[lane]) * p->ix[lane];
+    const float t1y = (box->min.y - p->oy[lane]) * p->iy[lane];
+    const float t2y = (box->max.y - p->oy[lane]) * p->iy[lane];
+    const float t1z = (box->min.z - p->oz[lane]) * p->iz[lane];
+    const float t2z = (box->max.z - p->oz[lane]) * p->iz[lane];
+
+    const float t_near = fmaxf(fmaxf(fminf(t1x, t2x), fminf(t1y, t2y)),
+        fmaxf(fminf(t1z, t2z), 0.0f));
+    const float t_far = fminf(fminf(fmaxf(t1x, t2x), fmaxf(t1y, t2y)),
+        fminf(fmaxf(t1z, t2z), *t));
+    if (t_near > t_far) {
+        return 0;
+    }
+
+    *t = t_near;
+    return 1;
+}
+
+static int
+BVH_SlabTest4Scalar(const bvh_packet_t* p, const aabb_t* box) {
+    int mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        float t = p->t[lane];
+        if (BVH_SlabTest(p, lane, box, &t)) {
+            mask |= 1 << lane;
+        }
+    }
+
+    return mask;
+}
+
+#if M_SIMD_X86
+__attribute__((target("sse2")))
+static int
+BVH_SlabTest4SSE2(const bvh_packet_t* p, const aabb_t* box) {
+    const __m128 ox = _mm_load_ps(p->ox);
+    const __m128 oy = _mm_load_ps(p->oy);
+    const __m128 oz = _mm_load_ps(p->oz);
+    const __m128 ix = _mm_load_ps(p->ix);
+    const __m128 iy = _mm_load_ps(p->iy);
+    const __m128 iz = _mm_load_ps(p->iz);
+
+    const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box->min.x), ox), ix);
+    const __m128 t2x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box->max.x), ox), ix);
+    const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box->min.y), oy), iy);
+    const __m128 t2y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box->max.y), oy), iy);
+    const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box->min.z), oz), iz);
+    const __m128 t2z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box->max.z), oz), iz);
+
+    const __m128 t_near = _mm_max_ps(
+        _mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)),
+        _mm_max_ps(_mm_min_ps(t1z, t2z), _mm_setzero_ps()));
+    const __m128 t_far = _mm_min_ps(
+        _mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)),
+        _mm_min_ps(_mm_max_ps(t1z, t2z), _mm_load_ps(p->t)));
+
+    return _mm_movemask_ps(_mm_cmple_ps(t_near, t_far));
+}
+#endif // M_SIMD_X86
+
+static bvh_slab4_fn
+BVH_SelectSlabTest(void) {
+#if M_SIMD_X86
+    if (M_GetSimdLevel() >= M_SIMD_SSE2) {
+        return BVH_SlabTest4SSE2;
+    }
+#endif
+    return BVH_SlabTest4Scalar;
+}
+
+/**
+ * Trace up to four rays together. Lanes past lane_count are padding and never
+ * hit. With any_hit set, a lane stops at its first hit and its t becomes -1.
+ */
+static void
+BVH_TracePacket(
+    const bvh_t* bvh,
+    const ray_t* rays,
+    int lane_count,
+    BVH_PrimitiveTest test,
+    void* user,
+    int any_hit,
+    bvh_slab4_fn slab4,
+    bvh_hit_t* out_hits) {
+    bvh_packet_t p;
+    const int live = (1 << lane_count) - 1;
+    int done = 0;
+
+    for (int lane = 0; lane < 4; lane++) {
+        out_hits[lane].prim = BVH_NO_HIT;
+        out_hits[lane].t = 0.0f;
+        if (lane < lane_count) {
+            const ray_t* ray = &rays[lane];
+            p.ox[lane] = ray->origin.x;
+            p.oy[lane] = ray->origin.y;
+            p.oz[lane] = ray->origin.z;
+            p.ix[lane] = 1.0f / ray->dir.x;
+            p.iy[lane] = 1.0f / ray->dir.y;
+            p.iz[lane] = 1.0f / ray->dir.z;
+            p.t[lane] = ray->t_max;
+            out_hits[lane].t = ray->t_max;
+        } else {
+            p.ox[lane] = p.oy[lane] = p.oz[lane] = 0.0f;
+            p.ix[lane] = p.iy[lane] = p.iz[lane] = 0.0f;
+            p.t[lane] = -1.0f;
+        }
+    }
+
+    uint32_t stack[BVH_MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const bvh_node_t* node = &bvh->nodes[stack[--sp]];
+        const int mask = slab4(&p, &node->bounds) & live & ~done;
+        if (!mask) {
+            continue;
+        }
+
+        if (node->count) {
+            for (uint32_t i = node->first; i < node->first + node->count; i++) {
+                const uint32_t prim = bvh->indices[i];
+                for (int lane = 0; lane < lane_count; lane++) {
+                    if (!(mask & (1 << lane)) || (done & (1 << lane))) {
+                        continue;
+                    }
+
+                    float t = p.t[lane];
+                    const int hit = test
+                        ? test(user, prim, &rays[lane], &t)
+                        : BVH_SlabTest(&p, lane, &bvh->prim_bounds[prim], &t);
+                    if (!hit) {
+                        continue;
+                    }
+
+                    out_hits[lane].prim = prim;
+                    out_hits[lane].t = t;
+                    if (any_hit) {
+                        p.t[lane] = -1.0f;
+                        done |= 1 << lane;
+                        if (done == live) {
+                            return;
+                        }
+                    } else {
+                        p.t[lane] = t;
+                    }
+                }
+            }
+            continue;
+        }
+
+        // visit the child nearer along the first active ray before the other
+        int lane = 0;
+        while (!(mask & (1 << lane))) {
+            lane++;
+        }
+        const vec_t* dir = &rays[lane].dir;
+        const vec_t cl = M_AABBCenter(&bvh->nodes[node->first].bounds);
+        const vec_t cr = M_AABBCenter(&bvh->nodes[node->first + 1].bounds);
+        const float toward_right = dir->x * (cr.x - cl.x)
+            + dir->y * (cr.y - cl.y) + dir->z * (cr.z - cl.z);
+        if (toward_right > 0.0f) {
+            stack[sp++] = node->first + 1;
+            stack[sp++] = node->first;
+        } else {
+            stack[sp++] = node->first;
+            stack[sp++] = node->first + 1;
+        }
+    }
+}
+
+void
+BVH_IntersectRays(
+    const bvh_t* bvh,
+    const ray_t* rays,
+    size_t count,
+    BVH_PrimitiveTest test,
+    void* user,
+    bvh_hit_t* out_hits) {
+    const bvh_slab4_fn slab4 = BVH_SelectSlabTest();
+
+    for (size_t i = 0; i < count; i += 4) {
+        const int lane_count = count - i < 4 ? (int) (count - i) : 4;
+        bvh_hit_t hits[4];
+        if (bvh->node_count) {
+            BVH_TracePacket(bvh, rays + i, lane_count, test, user, 0, slab4,
+                hits);
+        } else {
+            for (int lane = 0; lane < lane_count; lane++) {
+                hits[lane].prim = BVH_NO_HIT;
+                hits[lane].t = rays[i + lane].t_max;
+            }
+        }
+
+        SDL_memcpy(out_hits + i, hits, lane_count * sizeof(bvh_hit_t));
+    }
+}
+
+void
+BVH_OccludedRays(
+    const bvh_t* bvh,
+    const ray_t* rays,
+    size_t count,
+    BVH_PrimitiveTest test,
+    void* user,
+    uint32_t* out_mask) {
+    const bvh_slab4_fn slab4 = BVH_SelectSlabTest();
+
+    SDL_memset(out_mask, 0, ((count + 31) / 32) * sizeof(uint32_t));
+    if (!bvh->node_count) {
+        return;
+    }
+
+    for (size_t i = 0; i < count; i += 4) {
+        const int lane_count = count - i < 4 ? (int) (count - i) : 4;
+        bvh_hit_t hits[4];
+        BVH_TracePacket(bvh, rays + i, lane_count, test, user, 1, slab4, hits);
+
+        for (int lane = 0; lane < lane_count; lane++) {
+            if (hits[lane].prim != BVH_NO_HIT) {
+                out_mask[(i + lane) / 32] |= 1u << ((i + lane) % 32);
+            }
+        }
+    }
+}
+
+typedef int (*bvh_overlap_fn)(const void* shape, const aabb_t* box);
+
+static int
+BVH_OverlapAABB(const void* shape, const aabb_t* box) {
+    return M_AABBOverlap(shape, box);
+}
+
+static int
+BVH_OverlapSphere(const void* shape, const aabb_t* box) {
+    return M_SphereOverlapAABB(shape, box);
+}
+
+static size_t
+BVH_Query(
+    const bvh_t* bvh,
+    bvh_overlap_fn overlap,
+    const void* shape,
+    uint32_t* out,
+    size_t max) {
+    if (!bvh->node_count) {
+        return 0;
+    }
+
+    size_t found = 0;
+    uint32_t stack[BVH_MAX_DEPTH + 2];
+    int sp = 0;
+    stack[sp++] = 0;
+    while (sp > 0) {
+        const bvh_node_t* node = &bvh->nodes[stack[--sp]];
+        if (!overlap(shape, &node->bounds)) {
+            continue;
+        }
+
+        if (!node->count) {
+            stack[sp++] = node->first + 1;
+            stack[sp++] = node->first;
+            continue;
+        }
+
+        for (uint32_t i = node->first; i < node->first + node->count; i++) {
+            const uint32_t prim = bvh->indices[i];
+            if (overlap(shape, &bvh->prim_bounds[prim])) {
+                if (found < max) {
+                    out[found] = prim;
+                }
+                found++;
+            }
+        }
+    }
+
+    return found;
+}
+
+size_t
+BVH_QueryAABB(
+    const bvh_t* bvh,
+    const aabb_t* box,
+    uint32_t* out,
+    size_t max) {
+    return BVH_Query(bvh, BVH_OverlapAABB, box, out, max);
+}
+
+size_t
+BVH_QuerySphere(
+    const bvh_t* bvh,
+    const sphere_t* sphere,
+    uint32_t* out,
+    size_t max) {
+    return BVH_Query(bvh, BVH_OverlapSphere, sphere, out, max);
+}
@@ -0,0 +1,211 @@
+/**
+ * File: c_bvh.h
+ * Description: Bounding volume hierarchy over axis-aligned boxes, for
+ * picking, line-of-sight and projectile queries against many objects.
+ */
+#ifndef BVH_H_
+#define BVH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c_math.h"
+
+/* Number of SAH bins evaluated per axis when splitting a node. */
+#define BVH_BIN_COUNT 16
+
+/* Nodes with this many primitives or fewer always become leaves. */
+#define BVH_MAX_LEAF_SIZE 4
+
+/* Deepest level the builder will split to; also bounds the query stacks. */
+#define BVH_MAX_DEPTH 48
+
+/* Nodes with at least this many primitives are built across threads. */
+#define BVH_PARALLEL_THRESHOLD 4096
+
+/* Upper limit on the number of build threads. */
+#define BVH_MAX_THREADS 16
+
+/* bvh_hit_t.prim when a ray hit nothing. */
+#define BVH_NO_HIT UINT32_MAX
+
+/**
+ * @struct bvh_node_t
+ * @brief A node of the tree. Children of an inner node are stored next to
+ * each other at nodes[first] and nodes[first + 1]; a leaf covers
+ * indices[first] to indices[first + count - 1].
+ */
+typedef struct bvh_node_t {
+    aabb_t bounds;
+
+    uint32_t first;
+
+    /**
+     * @brief Number of primitives in a leaf, 0 for inner nodes.
+     */
+    uint32_t count;
+} bvh_node_t;
+
+/**
+ * @struct bvh_t
+ * @brief The tree. nodes[0] is the root, and every child has a larger index
+ * than its parent.
+ */
+typedef struct bvh_t {
+    bvh_node_t* nodes;
+    uint32_t node_count;
+
+    /**
+     * @brief Primitive indices, ordered so each leaf covers a contiguous range.
+     */
+    uint32_t* indices;
+
+    /**
+     * @brief Copy of the primitive bounds from the last build or refit.
+     */
+    aabb_t* prim_bounds;
+    uint32_t prim_count;
+} bvh_t;
+
+/**
+ * @struct ray_t
+ * @brief Ray or segment: points origin + dir * t for 0 <= t <= t_max. dir
+ * does not need to be normalized; hit distances are in units of dir.
+ */
+typedef struct ray_t {
+    vec_t origin;
+    vec_t dir;
+
+    /**
+     * @brief End of the segment, FLT_MAX for an infinite ray.
+     */
+    float t_max;
+} ray_t;
+
+/**
+ * @struct bvh_hit_t
+ * @brief Closest hit of a ray.
+ */
+typedef struct bvh_hit_t {
+    /**
+     * @brief The primitive that was hit, BVH_NO_HIT if none.
+     */
+    uint32_t prim;
+    float t;
+} bvh_hit_t;
+
+/**
+ * Exact test of a ray against one primitive. Return 1 and write the distance
+ * to *t if the primitive is hit closer than the value *t holds on entry,
+ * otherwise return 0 and leave *t alone. May be called from the thread that
+ * issued the query only.
+ */
+typedef int (*BVH_PrimitiveTest)(
+    void* user,
+    uint32_t prim,
+    const ray_t* ray,
+    float* t);
+
+/**
+ * @brief Build the tree with binned SAH splits. Large nodes bin their
+ * primitives and build their subtrees on several threads.
+ * @param bvh Output - the tree, release with BVH_Destroy
+ * @param bounds The bounds of each primitive
+ * @param count The number of primitives
+ * @param thread_count The number of threads to use, 0 for one per logical
+ * core, 1 to build on the calling thread only
+ * @return 1 on success, 0 on failure
+ */
+int
+BVH_Build(
+    bvh_t* bvh,
+    const aabb_t* bounds,
+    uint32_t count,
+    int thread_count);
+
+/**
+ * @brief Update the tree in place for moved primitives, keeping its
+ * topology. Query quality degrades as primitives drift from where they were
+ * at build time, so rebuild when objects move far.
+ * @param bvh The tree
+ * @param bounds The new bounds of each primitive, same count as the build
+ */
+void
+BVH_Refit(bvh_t* bvh, const aabb_t* bounds);
+
+/**
+ * @brief Free the tree.
+ * @param bvh The tree
+ */
+void
+BVH_Destroy(bvh_t* bvh);
+
+/**
+ * @brief Find the closest hit of each ray. Rays are traversed in packets of
+ * four with SIMD slab tests.
+ * @param bvh The tree
+ * @param rays The rays
+ * @param count The number of rays
+ * @param test Exact primitive test, or NULL to hit the primitive boxes
+ * @param user Passed to test
+ * @param out_hits Output - the closest hit of each ray
+ */
+void
+BVH_IntersectRays(
+    const bvh_t* bvh,
+    const ray_t* rays,
+    size_t count,
+    BVH_PrimitiveTest test,
+    void* user,
+    bvh_hit_t* out_hits);
+
+/**
+ * @brief Test each ray for any hit, stopping at the first one found. Use for
+ * line-of-sight, with t_max set to the distance of the target.
+ * @param bvh The tree
+ * @param rays The rays
+ * @param count The number of rays
+ * @param test Exact primitive test, or NULL to hit the primitive boxes
+ * @param user Passed to test
+ * @param out_mask Output - bit i of word i / 32 is set if ray i is blocked
+ */
+void
+BVH_OccludedRays(
+    const bvh_t* bvh,
+    const ray_t* rays,
+    size_t count,
+    BVH_PrimitiveTest test,
+    void* user,
+    uint32_t* out_mask);
+
+/**
+ * @brief Find the primitives whose bounds overlap a box.
+ * @param bvh The tree
+ * @param box The box
+ * @param out Output - the primitive indices, at most max are written
+ * @param max The capacity of out
+ * @return The number of overlapping primitives, which may exceed max
+ */
+size_t
+BVH_QueryAABB(
+    const bvh_t* bvh,
+    const aabb_t* box,
+    uint32_t* out,
+    size_t max);
+
+/**
+ * @brief Find the primitives whose bounds overlap a sphere.
+ * @param bvh The tree
+ * @param sphere The sphere
+ * @param out Output - the primitive indices, at most max are written
+ * @param max The capacity of out
+ * @return The number of overlapping primitives, which may exceed max
+ */
+size_t
+BVH_QuerySphere(
+    const bvh_t* bvh,
+    const sphere_t* sphere,
+    uint32_t* out,
+    size_t max);
+
+#endif // BVH_H_
@@ -0,0 +1,394 @@
+#define VEC_IMPL_H_
+#include "c_fastmath.h"
+
+/*
+ * sincos follows the Cephes single precision routines: reduce by multiples
+ * of pi/4 using a three-part Cody-Waite split of pi/4, then evaluate a
+ * degree-7 sine or degree-8 cosine polynomial on [-pi/4, pi/4]. The octant
+ * decides which polynomial and which sign each output takes.
+ */
+
+#define FM_4_OVER_PI 1.27323954473516f
+#define FM_DP1 0.78515625f
+#define FM_DP2 2.4187564849853515625e-4f
+#define FM_DP3 3.77489497744594108e-8f
+
+/* Largest |x| the scalar path reduces itself; past it the reduction loses
+ * too many bits, and the octant index soon overflows. */
+#define FM_SINCOS_MAX 8192.0f
+
+#define FM_SIN_C0 -1.9515295891e-4f
+#define FM_SIN_C1 8.3321608736e-3f
+#define FM_SIN_C2 -1.6666654611e-1f
+
+#define FM_COS_C0 2.443315711809948e-5f
+#define FM_COS_C1 -1.388731625493765e-3f
+#define FM_COS_C2 4.166664568298827e-2f
+
+float
+M_FastRsqrt(float x) {
+#if M_SIMD_VECTOR_TYPES
+    const __m128 v = _mm_set_ss(x);
+    const __m128 y = _mm_rsqrt_ss(v);
+    // y * (1.5 - 0.5 * x * y * y)
+    const __m128 yy = _mm_mul_ss(y, y);
+    const __m128 nr = _mm_sub_ss(_mm_set_ss(1.5f), 
+        _mm_mul_ss(_mm_mul_ss(_mm_set_ss(0.5f), v), yy));
+    return _mm_cvtss_f32(_mm_mul_ss(y, nr));
+#else
+    return 1.0f / sqrtf(x);
+#endif
+}
+
+void
+M_FastNormalizeVec(vec_t* a) {
+    const float len2 = M_SumOfSquares(a);
+    if (len2 == 0.0f) {
+        return;
+    }
+
+    const float inv = M_FastRsqrt(len2);
+    a->x *= inv;
+    a->y *= inv;
+    a->z *= inv;
+}
+
+void
+M_FastSinCos(float x, float* out_sin, float* out_cos) {
+    const float ax = fabsf(x);
+
+    // also catches NaN, which compares false
+    if (!(ax <= FM_SINCOS_MAX)) {
+        if (!isfinite(x)) {
+            *out_sin = NAN;
+            *out_cos = NAN;
+        } else {
+            // rare enough that exact beats fast
+            *out_sin = sinf(x);
+            *out_cos = cosf(x);
+        }
+        return;
+    }
+
+    // octant j, rounded up to even so r lands in [-pi/4, pi/4]
+    unsigned int j = (unsigned int) (ax * FM_4_OVER_PI);
+    j = (j + 1) & ~1u;
+    const float fj = (float) j;
+    const float r = ((ax - fj * FM_DP1) - fj * FM_DP2) - fj * FM_DP3;
+    const float z = r * r;
+
+    const float ps = ((FM_SIN_C0 * z + FM_SIN_C1) * z + FM_SIN_C2) * z * r + r;
+    const float pc = ((FM_COS_C0 * z + FM_COS_C1) * z + FM_COS_C2) * z * z 
+        - 0.5f * z + 1.0f;
+
+    const unsigned int q = j & 7;
+    const int swap = (q == 2) || (q == 6);
+    float s = swap ? pc : ps;
+    float c = swap ? ps : pc;
+
+    if ((q >= 4) != (x < 0.0f)) {
+        s = -s;
+    }
+    if (q == 2 || q == 4) {
+        c = -c;
+    }
+
+    *out_sin = s;
+    *out_cos = c;
+}
+
+#if M_SIMD_X86
+
+__attribute__((target("sse2")))
+static inline __m128
+M_FastRsqrt4(__m128 x) {
+    const __m128 y = _mm_rsqrt_ps(x);
+    const __m128 nr = _mm_sub_ps(_mm_set1_ps(1.5f),
+        _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), x), _mm_mul_ps(y, y)));
+    // zero length gives inf * 0 above, mask those lanes to zero
+    return _mm_and_ps(_mm_mul_ps(y, nr), 
+        _mm_cmpneq_ps(x, _mm_setzero_ps()));
+}
+
+__attribute__((target("avx")))
+static inline __m256
+M_FastRsqrt8(__m256 x) {
+    const __m256 y = _mm256_rsqrt_ps(x);
+    const __m256 nr = _mm256_sub_ps(_mm256_set1_ps(1.5f),
+        _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), x), 
+            _mm256_mul_ps(y, y)));
+    return _mm256_and_ps(_mm256_mul_ps(y, nr), 
+        _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_FastNormalizeVecBatchSSE2(vec_t* vecs, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        M_LoadVec3x4(&vecs[i], &x, &y, &z);
+        const __m128 inv = M_FastRsqrt4(_mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), 
+            _mm_mul_ps(z, z)));
+        M_StoreVec3x4(&vecs[i], 
+            _mm_mul_ps(x, inv), _mm_mul_ps(y, inv), _mm_mul_ps(z, inv));
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_FastNormalizeSoASSE2(float* x, float* y, float* z, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 vx = _mm_loadu_ps(x + i);
+        const __m128 vy = _mm_loadu_ps(y + i);
+        const __m128 vz = _mm_loadu_ps(z + i);
+        const __m128 inv = M_FastRsqrt4(_mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), 
+            _mm_mul_ps(vz, vz)));
+        _mm_storeu_ps(x + i, _mm_mul_ps(vx, inv));
+        _mm_storeu_ps(y + i, _mm_mul_ps(vy, inv));
+        _mm_storeu_ps(z + i, _mm_mul_ps(vz, inv));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+M_FastNormalizeSoAAVX(float* x, float* y, float* z, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 vx = _mm256_loadu_ps(x + i);
+        const __m256 vy = _mm256_loadu_ps(y + i);
+        const __m256 vz = _mm256_loadu_ps(z + i);
+        const __m256 inv = M_FastRsqrt8(_mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)), 
+            _mm256_mul_ps(vz, vz)));
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(vx, inv));
+        _mm256_storeu_ps(y + i, _mm256_mul_ps(vy, inv));
+        _mm256_storeu_ps(z + i, _mm256_mul_ps(vz, inv));
+    }
+
+    return i;
+}
+
+/* 
+ * The SIMD sincos keeps the octant in float lanes rather than integers, since
+ * AVX without AVX2 has no 256-bit integer ops. Every value involved is a small
+ * whole number, so the float arithmetic is exact.
+ */
+
+__attribute__((target("sse2")))
+static inline __m128
+M_Select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_FastSinCosBatchSSE2(
+    const float* x, float* out_sin, float* out_cos, size_t count) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 v = _mm_loadu_ps(x + i);
+        const __m128 sgn = _mm_and_ps(v, sign);
+        const __m128 ax = _mm_andnot_ps(sign, v);
+
+        // j = (trunc(ax * 4/pi) + 1) & ~1, q = j mod 8
+        __m128 j = _mm_cvtepi32_ps(
+            _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(FM_4_OVER_PI))));
+        j = _mm_add_ps(j, _mm_set1_ps(1.0f));
+        j = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(
+            _mm_mul_ps(j, _mm_set1_ps(0.5f)))), _mm_set1_ps(2.0f));
+        const __m128 q = _mm_sub_ps(j, _mm_mul_ps(_mm_set1_ps(8.0f),
+            _mm_cvtepi32_ps(_mm_cvttps_epi32(
+                _mm_mul_ps(j, _mm_set1_ps(0.125f))))));
+
+        __m128 r = _mm_sub_ps(ax, _mm_mul_ps(j, _mm_set1_ps(FM_DP1)));
+        r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(FM_DP2)));
+        r = _mm_sub_ps(r, _mm_mul_ps(j, _mm_set1_ps(FM_DP3)));
+        const __m128 z = _mm_mul_ps(r, r);
+
+        __m128 ps = _mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(FM_SIN_C0), z), _mm_set1_ps(FM_SIN_C1));
+        ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(FM_SIN_C2));
+        ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), r), r);
+
+        __m128 pc = _mm_add_ps(
+            _mm_mul_ps(_mm_set1_ps(FM_COS_C0), z), _mm_set1_ps(FM_COS_C1));
+        pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(FM_COS_C2));
+        pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+        pc = _mm_add_ps(
+            _mm_sub_ps(pc, _mm_mul_ps(_mm_set1_ps(0.5f), z)), 
+            _mm_set1_ps(1.0f));
+
+        const __m128 q2 = _mm_cmpeq_ps(q, _mm_set1_ps(2.0f));
+        const __m128 q4 = _mm_cmpeq_ps(q, _mm_set1_ps(4.0f));
+        const __m128 q6 = _mm_cmpeq_ps(q, _mm_set1_ps(6.0f));
+        const __m128 swap = _mm_or_ps(q2, q6);
+
+        __m128 s = M_Select4(swap, pc, ps);
+        __m128 c = M_Select4(swap, ps, pc);
+        s = _mm_xor_ps(s, _mm_xor_ps(sgn, _mm_and_ps(_mm_or_ps(q4, q6), sign)));
+        c = _mm_xor_ps(c, _mm_and_ps(_mm_or_ps(q2, q4), sign));
+
+        if (out_sin) {
+            _mm_storeu_ps(out_sin + i, s);
+        }
+        if (out_cos) {
+            _mm_storeu_ps(out_cos + i, c);
+        }
+    }
+
+    return i;
+}
+
+/* FMA variant of the 8-lane kernel; plain AVX builds use the macro below. */
+#define FM_SINCOS8_BODY(MADD)                                                 \
+    const __m256 sign = _mm256_set1_ps(-0.0f);                                \
+    size_t i = 0;                                                             \
+    for (; i + 8 <= count; i += 8) {                                          \
+        const __m256 v = _mm256_loadu_ps(x + i);                              \
+        const __m256 sgn = _mm256_and_ps(v, sign);                            \
+        const __m256 ax = _mm256_andnot_ps(sign, v);                          \
+        __m256 j = _mm256_round_ps(                                           \
+            _mm256_mul_ps(ax, _mm256_set1_ps(FM_4_OVER_PI)),                  \
+            _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);                          \
+        j = _mm256_add_ps(j, _mm256_set1_ps(1.0f));                           \
+        j = _mm256_mul_ps(_mm256_round_ps(                                    \
+            _mm256_mul_ps(j, _mm256_set1_ps(0.5f)),                           \
+            _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), _mm256_set1_ps(2.0f));   \
+        const __m256 q = _mm256_sub_ps(j, _mm256_mul_ps(                      \
+            _mm256_set1_ps(8.0f), _mm256_round_ps(                            \
+                _mm256_mul_ps(j, _mm256_set1_ps(0.125f)),                     \
+                _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)));                    \
+        __m256 r = _mm256_sub_ps(ax, _mm256_mul_ps(j, _mm256_set1_ps(FM_DP1)));\
+        r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(FM_DP2)));       \
+        r = _mm256_sub_ps(r, _mm256_mul_ps(j, _mm256_set1_ps(FM_DP3)));       \
+        const __m256 z = _mm256_mul_ps(r, r);                                 \
+        __m256 ps = MADD(_mm256_set1_ps(FM_SIN_C0), z,                        \
+            _mm256_set1_ps(FM_SIN_C1));                                       \
+        ps = MADD(ps, z, _mm256_set1_ps(FM_SIN_C2));                          \
+        ps = MADD(_mm256_mul_ps(ps, z), r, r);                                \
+        __m256 pc = MADD(_mm256_set1_ps(FM_COS_C0), z,                        \
+            _mm256_set1_ps(FM_COS_C1));                                       \
+        pc = MADD(pc, z, _mm256_set1_ps(FM_COS_C2));                          \
+        pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);                          \
+        pc = MADD(_mm256_set1_ps(-0.5f), z, pc);                              \
+        pc = _mm256_add_ps(pc, _mm256_set1_ps(1.0f));                         \
+        const __m256 q2 = _mm256_cmp_ps(q, _mm256_set1_ps(2.0f), _CMP_EQ_OQ); \
+        const __m256 q4 = _mm256_cmp_ps(q, _mm256_set1_ps(4.0f), _CMP_EQ_OQ); \
+        const __m256 q6 = _mm256_cmp_ps(q, _mm256_set1_ps(6.0f), _CMP_EQ_OQ); \
+        const __m256 swap = _mm256_or_ps(q2, q6);                             \
+        __m256 s = _mm256_or_ps(_mm256_and_ps(swap, pc),                      \
+            _mm256_andnot_ps(swap, ps));                                      \
+        __m256 c = _mm256_or_ps(_mm256_and_ps(swap, ps),                      \
+            _mm256_andnot_ps(swap, pc));                                      \
+        s = _mm256_xor_ps(s, _mm256_xor_ps(sgn,                               \
+            _mm256_and_ps(_mm256_or_ps(q4, q6), sign)));                      \
+        c = _mm256_xor_ps(c, _mm256_and_ps(_mm256_or_ps(q2, q4), sign));      \
+        if (out_sin) {                                                        \
+            _mm256_storeu_ps(out_sin + i, s);                                 \
+        }                                                                     \
+        if (out_cos) {                                                        \
+            _mm256_storeu_ps(out_cos + i, c);                                 \
+        }                                                                     \
+    }                                                                         \
+    return i;
+
+#define FM_MADD_AVX(a, b, c) _mm256_add_ps(_mm256_mul_ps((a), (b)), (c))
+
+__attribute__((target("avx")))
+static size_t
+M_FastSinCosBatchAVX(
+    const float* x, float* out_sin, float* out_cos, size_t count) {
+    FM_SINCOS8_BODY(FM_MADD_AVX)
+}
+
+__attribute__((target("avx,fma")))
+static size_t
+M_FastSinCosBatchFMA(
+    const float* x, float* out_sin, float* out_cos, size_t count) {
+    FM_SINCOS8_BODY(_mm256_fmadd_ps)
+}
+
+#endif // M_SIMD_X86
+
+void
+M_FastNormalizeVecBatch(vec_t* vecs, size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    if (M_GetSimdLevel() >= M_SIMD_SSE2) {
+        i = M_FastNormalizeVecBatchSSE2(vecs, count);
+    }
+#endif
+
+    for (; i < count; i++) {
+        M_FastNormalizeVec(&vecs[i]);
+    }
+}
+
+void
+M_FastNormalizeSoA(float* x, float* y, float* z, size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    const MathSimdLevel level = M_GetSimdLevel();
+    if (level >= M_SIMD_AVX) {
+        i = M_FastNormalizeSoAAVX(x, y, z, count);
+    } else if (level >= M_SIMD_SSE2) {
+        i = M_FastNormalizeSoASSE2(x, y, z, count);
+    }
+#endif
+
+    for (; i < count; i++) {
+        vec_t v = { .x = x[i], .y = y[i], .z = z[i] };
+        M_FastNormalizeVec(&v);
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+}
+
+void
+M_FastSinCosBatch(
+    const float* x, 
+    float* out_sin, 
+    float* out_cos, 
+    size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    switch (M_GetSimdLevel()) {
+        case M_SIMD_FMA:
+            i = M_FastSinCosBatchFMA(x, out_sin, out_cos, count);
+            break;
+        case M_SIMD_AVX:
+            i = M_FastSinCosBatchAVX(x, out_sin, out_cos, count);
+            break;
+        case M_SIMD_SSE2:
+            i = M_FastSinCosBatchSSE2(x, out_sin, out_cos, count);
+            break;
+        default:
+            break;
+    }
+#endif
+
+    for (; i < count; i++) {
+        float s, c;
+        M_FastSinCos(x[i], &s, &c);
+        if (out_sin) {
+            out_sin[i] = s;
+        }
+        if (out_cos) {
+            out_cos[i] = c;
+        }
+    }
+}
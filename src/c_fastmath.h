@@ -0,0 +1,83 @@
+#ifndef FASTMATH_H_
+#define FASTMATH_H_
+
+#include <stddef.h>
+
+#include "c_math.h"
+
+/*
+ * Approximate versions of the c_math.h routines for code that runs millions
+ * of times per second and does not need libm accuracy (particles, steering).
+ * Batched functions evaluate 4 (SSE2) or 8 (AVX/FMA) lanes at once, following
+ * the level selected by M_InitSimd.
+ *
+ * Maximum errors, measured against double precision libm:
+ *  - M_FastRsqrt:            relative error < 3e-7 (hardware estimate + one
+ *                            Newton-Raphson step; scalar fallback is exact)
+ *  - M_FastNormalizeVec*:    ||v| - 1| < 3e-7
+ *  - M_FastSinCos*:          absolute error < 1e-7 for |x| <= 8192; past
+ *                            that the batched lanes lose accuracy as range
+ *                            reduction loses bits, while M_FastSinCos falls
+ *                            back to libm. NaN and infinite angles give NaN
+ */
+
+/**
+ * @brief Approximate 1 / sqrt(x)
+ * @param x The value, must be positive
+ * @return The reciprocal square root
+ */
+float
+M_FastRsqrt(float x);
+
+/**
+ * @brief Approximately normalize the vector in place. A zero vector stays
+ * zero instead of becoming NaN.
+ * @param a The vector to normalize, in place
+ */
+void
+M_FastNormalizeVec(vec_t* a);
+
+/**
+ * @brief Approximately normalize an array of vectors in place. Zero vectors
+ * stay zero.
+ * @param vecs The vectors
+ * @param count The number of vectors
+ */
+void
+M_FastNormalizeVecBatch(vec_t* vecs, size_t count);
+
+/**
+ * @brief Approximately normalize structure-of-arrays vectors in place. Zero
+ * vectors stay zero.
+ * @param x The x components
+ * @param y The y components
+ * @param z The z components
+ * @param count The number of vectors
+ */
+void
+M_FastNormalizeSoA(float* x, float* y, float* z, size_t count);
+
+/**
+ * @brief Polynomial sine and cosine of one angle
+ * @param x The angle in radians
+ * @param out_sin Output - the sine
+ * @param out_cos Output - the cosine
+ */
+void
+M_FastSinCos(float x, float* out_sin, float* out_cos);
+
+/**
+ * @brief Polynomial sine and cosine of an array of angles
+ * @param x The angles in radians
+ * @param out_sin Output - the sines, may be NULL
+ * @param out_cos Output - the cosines, may be NULL
+ * @param count The number of angles
+ */
+void
+M_FastSinCosBatch(
+    const float* x, 
+    float* out_sin, 
+    float* out_cos, 
+    size_t count);
+
+#endif // FASTMATH_H_
@@ -1,42 +1,849 @@
+/* ftruncate and MAP_SHARED are extensions to strict c99 headers */
+#define _DEFAULT_SOURCE
+#define _DARWIN_C_SOURCE
+
 #include "c_log.h"
+#include "c_logring.h"
 
 #include <stdio.h>
 #include <time.h>
 
-// TODO - not thread-safe
+#if CGAME_LOG_FILE == CGAME_LOG_FILE_RING \
+    && (defined(__unix__) || defined(__APPLE__))
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #define LOG_RING_FILE 1
+#else
+  #define LOG_RING_FILE 0
+#endif
+
+/* A message waiting in the ring for the writer. */
+typedef struct {
+    /* Position the slot is free for, or one past the position it holds. */
+    SDL_AtomicU32 sequence;
+
+    /* The call site of a binary event, NULL for a text message. */
+    log_format_t* format;
+
+    /* SDL_GetTicksNS for text, SDL_GetPerformanceCounter for binary. */
+    Uint64 ticks;
+
+    /* Level of a leveled message, -1 for G_Log. */
+    int level;
+
+    /* Bytes of msg used by a binary event's arguments. */
+    Uint16 length;
+
+    char tag[CGAME_LOG_TAG_LENGTH];
+    char msg[LOG_MAX_MESSAGE_LENGTH];
+} log_record_t;
+
 static FILE* out = NULL;
+static FILE* bin_out = NULL;
 
-void
-G_Log(const char* tag, const char* msg) {
+#if LOG_RING_FILE
+/* The mapped ring file, or NULL until it is opened. */
+static log_ring_header_t* ring_file;
+static char* ring_file_data;
+static int ring_file_failed;
+#endif
+
+/* Serializes writes to stdout and the files, and the state below. A mutex
+ * between G_LogStart and G_LogStop, so a thread that logs while another is
+ * stuck on the disk sleeps rather than spins; the spinlock covers the
+ * single threaded start and end, before the mutex can be allocated. */
+static SDL_Mutex* write_mutex;
+static SDL_SpinLock write_spin;
+static Uint32 next_format_id = 1;
+
+/* Take the write lock. Returns what to hand to G_LogUnlockOutput. */
+static SDL_Mutex*
+G_LogLockOutput(void) {
+    SDL_Mutex* mutex = write_mutex;
+    if (mutex) {
+        SDL_LockMutex(mutex);
+    } else {
+        SDL_LockSpinlock(&write_spin);
+    }
+    return mutex;
+}
+
+static void
+G_LogUnlockOutput(SDL_Mutex* mutex) {
+    if (mutex) {
+        SDL_UnlockMutex(mutex);
+    } else {
+        SDL_UnlockSpinlock(&write_spin);
+    }
+}
+
+/* Wall clock time and SDL_GetTicksNS read together, so the wall clock time
+ * of a line comes from its ticks alone. */
+static Sint64 anchor_time;
+static Uint64 anchor_ticks;
+static int anchored;
+
+/* Formatted date and time of the second lines are currently written in. */
+static Sint64 cached_second = -1;
+static char cached_date[32];
+static char cached_year[8];
+
+/* Filters of the tags seen so far. Guarded by filter_lock. */
+typedef struct {
+    char name[CGAME_LOG_TAG_LENGTH];
+
+    /* Level set for the tag, or LOG_LEVEL_DEFAULT. */
+    int own_level;
+
+    log_filter_t filter;
+} log_tag_t;
+
+static SDL_SpinLock filter_lock;
+static log_tag_t tags[CGAME_LOG_MAX_TAGS];
+static int tag_count;
+static int default_level = CGAME_LOG_DEFAULT_LEVEL;
+
+/* Used by sites whose tag did not fit in the table. */
+static log_filter_t overflow_filter = { CGAME_LOG_DEFAULT_LEVEL };
+
+log_filter_t log_unresolved = { LOG_LEVEL_VERBOSE };
+
+static const char* level_names[] = {
+    "VERBOSE",
+    "DEBUG",
+    "INFO",
+    "WARNING",
+    "ERROR"
+};
+
+/* Bounded multiple producer, single consumer queue: producers claim a
+ * position with a compare and swap, and a slot's sequence says whether it
+ * is free or filled for that position. */
+static log_record_t ring[CGAME_LOG_RING_SIZE];
+static SDL_AtomicU32 write_pos;
+static SDL_AtomicU32 read_pos;
+
+/* Messages lost to a full ring, and how many of them the writer logged. */
+static SDL_AtomicInt dropped;
+static int reported;
+
+static SDL_AtomicInt running;
+static SDL_Thread* writer;
+static SDL_Semaphore* wake;
+static log_overflow_t policy;
+
+/* Format the date and time of a line, reformatting only once a second.
+ * Lock held. */
+static void
+G_LogTimestamp(Uint64 ticks, char* out, size_t size) {
+    if (!anchored) {
+        SDL_Time now;
+        anchor_time = SDL_GetCurrentTime(&now) ? now : 0;
+        anchor_ticks = SDL_GetTicksNS();
+        anchored = 1;
+    }
+
+    const Sint64 ns = anchor_time + (Sint64) (ticks - anchor_ticks);
+    Sint64 second = ns / SDL_NS_PER_SECOND;
+    Sint64 fraction = ns % SDL_NS_PER_SECOND;
+    if (fraction < 0) {
+        second--;
+        fraction += SDL_NS_PER_SECOND;
+    }
+
+    if (second != cached_second) {
+        const time_t t = (time_t) second;
+        struct tm* tm_info = localtime(&t);
+        strftime(cached_date, sizeof(cached_date), "%a %b %d %H:%M:%S",
+            tm_info);
+        strftime(cached_year, sizeof(cached_year), "%Y", tm_info);
+        cached_second = second;
+    }
+
+    snprintf(out, size, "%s.%06d %s",
+        cached_date, (int) (fraction / 1000), cached_year);
+}
+
+#if LOG_RING_FILE
+/* Map the ring file, carrying on after the text of the last run if it has
+ * the same size, so a crash log survives a restart. Lock held. */
+static int
+G_LogOpenRingFile(void) {
+    // room for the header to grow
+    const size_t data_offset = 64;
+    const size_t size = data_offset + CGAME_LOG_RING_FILE_SIZE;
+
+    const int fd = open(CGAME_LOG_RING_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return 0;
+    }
+
+    const off_t old_size = lseek(fd, 0, SEEK_END);
+    if (old_size != (off_t) size && ftruncate(fd, (off_t) size) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+
+    log_ring_header_t* header = base;
+    if (old_size != (off_t) size
+        || SDL_memcmp(header->magic, LOG_RING_MAGIC, sizeof(header->magic))
+        || header->byte_order != LOG_RING_BYTE_ORDER
+        || header->data_offset != data_offset
+        || header->capacity != CGAME_LOG_RING_FILE_SIZE) {
+        SDL_memcpy(header->magic, LOG_RING_MAGIC, sizeof(header->magic));
+        header->byte_order = LOG_RING_BYTE_ORDER;
+        header->data_offset = (Uint32) data_offset;
+        header->capacity = CGAME_LOG_RING_FILE_SIZE;
+        header->cursor = 0;
+    }
+
+    ring_file = header;
+    ring_file_data = (char*) base + data_offset;
+    return 1;
+}
+
+/* Copy a line into the ring file, then move the cursor past it, so a
+ * reader never sees the cursor ahead of the text. Lock held. */
+static void
+G_LogWriteRingFile(const char* line, size_t length) {
+    const Uint64 capacity = ring_file->capacity;
+    const size_t at = (size_t) (ring_file->cursor % capacity);
+    const size_t first = length < capacity - at ? length : capacity - at;
+
+    SDL_memcpy(ring_file_data + at, line, first);
+    SDL_memcpy(ring_file_data, line + first, length - first);
+    SDL_MemoryBarrierRelease();
+    ring_file->cursor += length;
+}
+#endif
+
+/* Format one line and write it to stdout and the file, without flushing.
+ * Lock held. */
+static void
+G_LogWrite(Uint64 ticks, int level, const char* tag, const char* msg) {
+#if LOG_RING_FILE
+    if (!ring_file && !ring_file_failed && !G_LogOpenRingFile()) {
+        ring_file_failed = 1;
+    }
+    if (!ring_file && !out) {
+        out = fopen("log.out", "w");
+    }
+#else
     // open the file if not opened
     if (!out) {
         out = fopen("log.out", "w");
     }
-    // get time
-    time_t now;
-    time(&now);
-    struct tm* tm_info = localtime(&now);
+#endif
 
     char time_str[64];
-    strftime(time_str, sizeof(time_str), "%a %b %d %H:%M:%S %Y", tm_info);
-
-    #define LOG_MAX_MESSAGE_LENGTH 1024
+    G_LogTimestamp(ticks, time_str, sizeof(time_str));
 
     char log_message[LOG_MAX_MESSAGE_LENGTH] = { 0 };
 
-    snprintf(
-        log_message,
-        LOG_MAX_MESSAGE_LENGTH,
-        "%s [%s]: %s\n", 
-        time_str, 
-        tag, 
-        msg
-    );
-    
+    if (level < 0) {
+        snprintf(
+            log_message,
+            LOG_MAX_MESSAGE_LENGTH,
+            "%s [%s]: %s\n",
+            time_str,
+            tag,
+            msg
+        );
+    } else {
+        snprintf(
+            log_message,
+            LOG_MAX_MESSAGE_LENGTH,
+            "%s [%s %s]: %s\n",
+            time_str,
+            level_names[level],
+            tag,
+            msg
+        );
+    }
+
     // log the messages to stdout and file
     printf("%s", log_message);
+#if LOG_RING_FILE
+    if (ring_file) {
+        G_LogWriteRingFile(log_message, SDL_strlen(log_message));
+        return;
+    }
+#endif
     if (out) {
         fprintf(out, "%s", log_message);
+    }
+}
+
+/* Open the binary log and write its header. Lock held. */
+static FILE*
+G_LogOpenBinary(void) {
+    FILE* file = fopen(CGAME_LOG_BINARY_FILE, "wb");
+    if (!file) {
+        return NULL;
+    }
+
+    log_bin_header_t header = { { 0 } };
+    SDL_memcpy(header.magic, LOG_BIN_MAGIC, sizeof(header.magic));
+    header.byte_order = LOG_BIN_BYTE_ORDER;
+    header.tick_frequency = SDL_GetPerformanceFrequency();
+    header.start_ticks = SDL_GetPerformanceCounter();
+    header.start_time = (Sint64) time(NULL);
+    fwrite(&header, sizeof(header), 1, file);
+
+    return file;
+}
+
+/* Write a string as a length and its bytes. */
+static void
+G_LogWriteString(FILE* file, const char* str) {
+    const size_t len = SDL_strlen(str);
+    const Uint16 length = (Uint16) (len > 0xffff ? 0xffff : len);
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(str, 1, length, file);
+}
+
+/* Write a binary event, and its format the first time, without flushing.
+ * Lock held. */
+static void
+G_LogWriteBinary(
+    log_format_t* format,
+    Uint64 ticks,
+    const void* payload,
+    Uint16 length
+) {
+    if (!bin_out) {
+        bin_out = G_LogOpenBinary();
+        if (!bin_out) {
+            return;
+        }
+    }
+
+    Uint8 type;
+    if (!format->id) {
+        format->id = next_format_id++;
+        type = LOG_BIN_RECORD_FORMAT;
+        fwrite(&type, sizeof(type), 1, bin_out);
+        fwrite(&format->id, sizeof(format->id), 1, bin_out);
+        G_LogWriteString(bin_out, format->tag);
+        G_LogWriteString(bin_out, format->format);
+        fwrite(&format->count, sizeof(format->count), 1, bin_out);
+        fwrite(format->kinds, 1, format->count, bin_out);
+    }
+
+    type = LOG_BIN_RECORD_EVENT;
+    fwrite(&type, sizeof(type), 1, bin_out);
+    fwrite(&format->id, sizeof(format->id), 1, bin_out);
+    fwrite(&ticks, sizeof(ticks), 1, bin_out);
+    fwrite(&length, sizeof(length), 1, bin_out);
+    fwrite(payload, 1, length, bin_out);
+}
+
+/* Write and flush every record in the ring. Writer only. */
+static int
+G_LogDrain(void) {
+    int written = 0;
+    Uint32 pos = SDL_GetAtomicU32(&read_pos);
+
+    SDL_Mutex* lock = G_LogLockOutput();
+
+    for (;;) {
+        log_record_t* record = &ring[pos & (CGAME_LOG_RING_SIZE - 1)];
+        if (SDL_GetAtomicU32(&record->sequence) != pos + 1) {
+            break;
+        }
+        SDL_MemoryBarrierAcquire();
+
+        if (record->format) {
+            G_LogWriteBinary(
+                record->format,
+                record->ticks,
+                record->msg,
+                record->length);
+        } else {
+            G_LogWrite(
+                record->ticks,
+                record->level,
+                record->tag,
+                record->msg);
+        }
+        written++;
+
+        // hand the slot back to producers for its next lap
+        SDL_MemoryBarrierRelease();
+        SDL_SetAtomicU32(&record->sequence, pos + CGAME_LOG_RING_SIZE);
+        pos++;
+    }
+
+    const int lost = SDL_GetAtomicInt(&dropped);
+    if (policy == LOG_OVERFLOW_COUNT && lost != reported) {
+        char msg[64];
+        snprintf(msg, sizeof(msg), "%d log messages dropped.",
+            lost - reported);
+        G_LogWrite(SDL_GetTicksNS(), -1, "WARNING", msg);
+        reported = lost;
+        written++;
+    }
+
+    if (written && out) {
+        fflush(out);
+    }
+    if (written && bin_out) {
+        fflush(bin_out);
+    }
+    G_LogUnlockOutput(lock);
+
+    SDL_SetAtomicU32(&read_pos, pos);
+    return written;
+}
+
+static int SDLCALL
+G_LogWriter(void* data) {
+    (void) data;
+
+    while (SDL_GetAtomicInt(&running)) {
+        SDL_WaitSemaphoreTimeout(wake, CGAME_LOG_FLUSH_MS);
+        G_LogDrain();
+    }
+    return 0;
+}
+
+/* Claim a slot for position *pos. Returns NULL if the ring is full. */
+static log_record_t*
+G_LogClaim(Uint32* pos) {
+    Uint32 p = SDL_GetAtomicU32(&write_pos);
+
+    for (;;) {
+        log_record_t* record = &ring[p & (CGAME_LOG_RING_SIZE - 1)];
+        const int diff = (int) (SDL_GetAtomicU32(&record->sequence) - p);
+
+        if (diff == 0) {
+            if (SDL_CompareAndSwapAtomicU32(&write_pos, p, p + 1)) {
+                SDL_MemoryBarrierAcquire();
+                *pos = p;
+                return record;
+            }
+        } else if (diff < 0) {
+            // the writer has not freed this slot from the previous lap
+            return NULL;
+        }
+        p = SDL_GetAtomicU32(&write_pos);
+    }
+}
+
+/* Claim a slot, applying the overflow policy. Returns NULL if the message
+ * is to be dropped. */
+static log_record_t*
+G_LogAcquire(Uint32* pos) {
+    log_record_t* record;
+    while (!(record = G_LogClaim(pos))) {
+        if (policy != LOG_OVERFLOW_BLOCK) {
+            SDL_AddAtomicInt(&dropped, 1);
+            return NULL;
+        }
+        SDL_SignalSemaphore(wake);
+        SDL_Delay(1);
+    }
+    return record;
+}
+
+/* Hand a filled slot to the writer. */
+static void
+G_LogPublish(log_record_t* record, Uint32 pos) {
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicU32(&record->sequence, pos + 1);
+
+    // only wake the writer once a batch is pending, the timeout covers
+    // the rest
+    if (pos + 1 - SDL_GetAtomicU32(&read_pos) == CGAME_LOG_BATCH) {
+        SDL_SignalSemaphore(wake);
+    }
+}
+
+void
+G_Log(const char* tag, const char* msg) {
+#if CGAME_LOG_ASYNC
+    if (SDL_GetAtomicInt(&running)) {
+        Uint32 pos;
+        log_record_t* record = G_LogAcquire(&pos);
+        if (record) {
+            record->format = NULL;
+            record->ticks = SDL_GetTicksNS();
+            record->level = -1;
+            SDL_strlcpy(record->tag, tag, sizeof(record->tag));
+            SDL_strlcpy(record->msg, msg, sizeof(record->msg));
+            G_LogPublish(record, pos);
+        }
+        return;
+    }
+#endif
+
+    const Uint64 ticks = SDL_GetTicksNS();
+    SDL_Mutex* lock = G_LogLockOutput();
+    G_LogWrite(ticks, -1, tag, msg);
+    if (out) {
+        fflush(out);
+    }
+    G_LogUnlockOutput(lock);
+}
+
+/* Find the entry of a tag, adding it if there is room. Lock held. */
+static log_tag_t*
+G_LogFindTag(const char* tag) {
+    for (int i = 0; i < tag_count; i++) {
+        if (SDL_strncmp(tags[i].name, tag, sizeof(tags[i].name) - 1) == 0) {
+            return &tags[i];
+        }
+    }
+    if (tag_count == CGAME_LOG_MAX_TAGS) {
+        return NULL;
+    }
+
+    log_tag_t* entry = &tags[tag_count++];
+    SDL_strlcpy(entry->name, tag, sizeof(entry->name));
+    entry->own_level = LOG_LEVEL_DEFAULT;
+    entry->filter.level = default_level;
+    return entry;
+}
+
+void
+G_LogAt(log_site_t* site, int level, const char* fmt, ...) {
+    if (site->filter == &log_unresolved) {
+        SDL_LockSpinlock(&filter_lock);
+        log_tag_t* entry = G_LogFindTag(site->tag);
+        site->filter = entry ? &entry->filter : &overflow_filter;
+        SDL_UnlockSpinlock(&filter_lock);
+
+        if (level < site->filter->level) {
+            return;
+        }
+    }
+
+    const Uint64 ticks = SDL_GetTicksNS();
+    va_list args;
+
+#if CGAME_LOG_ASYNC
+    if (SDL_GetAtomicInt(&running)) {
+        Uint32 pos;
+        log_record_t* record = G_LogAcquire(&pos);
+        if (record) {
+            record->format = NULL;
+            record->ticks = ticks;
+            record->level = level;
+            SDL_strlcpy(record->tag, site->tag, sizeof(record->tag));
+            va_start(args, fmt);
+            SDL_vsnprintf(record->msg, sizeof(record->msg), fmt, args);
+            va_end(args);
+            G_LogPublish(record, pos);
+        }
+        return;
+    }
+#endif
+
+    char msg[LOG_MAX_MESSAGE_LENGTH];
+    va_start(args, fmt);
+    SDL_vsnprintf(msg, sizeof(msg), fmt, args);
+    va_end(args);
+
+    SDL_Mutex* lock = G_LogLockOutput();
+    G_LogWrite(ticks, level, site->tag, msg);
+    if (out) {
         fflush(out);
     }
-}
\ No newline at end of file
+    G_LogUnlockOutput(lock);
+}
+
+void
+G_LogSetLevel(int level) {
+    SDL_LockSpinlock(&filter_lock);
+    default_level = level;
+    overflow_filter.level = level;
+    for (int i = 0; i < tag_count; i++) {
+        if (tags[i].own_level == LOG_LEVEL_DEFAULT) {
+            tags[i].filter.level = level;
+        }
+    }
+    SDL_UnlockSpinlock(&filter_lock);
+}
+
+int
+G_LogSetTagLevel(const char* tag, int level) {
+    SDL_LockSpinlock(&filter_lock);
+    log_tag_t* entry = G_LogFindTag(tag);
+    if (entry) {
+        entry->own_level = level;
+        entry->filter.level = level == LOG_LEVEL_DEFAULT
+            ? default_level : level;
+    }
+    SDL_UnlockSpinlock(&filter_lock);
+
+    if (!entry) {
+        G_Log("ERROR", "Too many log tags to set a level for another.");
+        return 0;
+    }
+    return 1;
+}
+
+int
+G_LogEnabled(int level, const char* tag) {
+    SDL_LockSpinlock(&filter_lock);
+    const log_tag_t* entry = G_LogFindTag(tag);
+    const int enabled = level >= (entry ? entry->filter.level
+        : overflow_filter.level);
+    SDL_UnlockSpinlock(&filter_lock);
+    return enabled;
+}
+
+/* Fill in the argument kinds of a call site. Returns 0 if its format has a
+ * conversion the binary log does not support. */
+static int
+G_LogParseFormat(log_format_t* format) {
+    const int parsed = SDL_GetAtomicInt(&format->parsed);
+    if (parsed) {
+        return parsed > 0;
+    }
+
+    SDL_LockSpinlock(&format->lock);
+    if (!SDL_GetAtomicInt(&format->parsed)) {
+        int ok = 1;
+        int count = 0;
+        const char* p = format->format;
+
+        while (ok && (p = SDL_strchr(p, '%'))) {
+            const log_arg_t kind = C_LogBinConversion(p, &p);
+            if (kind == LOG_ARG_INVALID || count == LOG_BIN_MAX_ARGS) {
+                ok = 0;
+            } else if (kind != LOG_ARG_NONE) {
+                format->kinds[count++] = (Uint8) kind;
+            }
+        }
+        format->count = (Uint8) count;
+
+        if (!ok) {
+            char msg[256];
+            snprintf(msg, sizeof(msg),
+                "Binary log format \"%s\" is not supported.", format->format);
+            G_Log("ERROR", msg);
+        }
+        SDL_MemoryBarrierRelease();
+        SDL_SetAtomicInt(&format->parsed, ok ? 1 : -1);
+    }
+    SDL_UnlockSpinlock(&format->lock);
+
+    return SDL_GetAtomicInt(&format->parsed) > 0;
+}
+
+/* Copy the arguments of a call site into a payload of at most size bytes,
+ * shortening strings to fit. Returns the bytes used. */
+static Uint16
+G_LogEncode(
+    const log_format_t* format,
+    va_list args,
+    Uint8* payload,
+    size_t size
+) {
+    size_t used = 0;
+
+    for (int i = 0; i < format->count; i++) {
+        Uint64 value = 0;
+        double real;
+        const char* str;
+
+        switch (format->kinds[i]) {
+        case LOG_ARG_INT:
+            value = (Uint64) (Sint64) va_arg(args, int);
+            break;
+        case LOG_ARG_UINT:
+            value = va_arg(args, unsigned int);
+            break;
+        case LOG_ARG_LONG:
+            value = (Uint64) (Sint64) va_arg(args, long);
+            break;
+        case LOG_ARG_ULONG:
+            value = va_arg(args, unsigned long);
+            break;
+        case LOG_ARG_LLONG:
+            value = (Uint64) va_arg(args, long long);
+            break;
+        case LOG_ARG_ULLONG:
+            value = va_arg(args, unsigned long long);
+            break;
+        case LOG_ARG_SIZE:
+            value = va_arg(args, size_t);
+            break;
+        case LOG_ARG_DOUBLE:
+            real = va_arg(args, double);
+            SDL_memcpy(&value, &real, sizeof(value));
+            break;
+        case LOG_ARG_POINTER:
+            value = (Uint64) (uintptr_t) va_arg(args, void*);
+            break;
+        case LOG_ARG_STRING: {
+            str = va_arg(args, const char*);
+            if (!str) {
+                str = "(null)";
+            }
+            if (used + sizeof(Uint16) > size) {
+                return (Uint16) used;
+            }
+
+            // leave room for the arguments after this one
+            const size_t reserved = used + sizeof(Uint16)
+                + (size_t) (format->count - i - 1) * sizeof(Uint64);
+            const size_t room = reserved < size ? size - reserved : 0;
+            size_t len = SDL_strlen(str);
+            if (len > room) {
+                len = room;
+            }
+
+            const Uint16 length = (Uint16) len;
+            SDL_memcpy(payload + used, &length, sizeof(length));
+            SDL_memcpy(payload + used + sizeof(length), str, len);
+            used += sizeof(length) + len;
+            continue;
+        }
+        default:
+            break;
+        }
+
+        if (used + sizeof(value) > size) {
+            break;
+        }
+        SDL_memcpy(payload + used, &value, sizeof(value));
+        used += sizeof(value);
+    }
+
+    return (Uint16) used;
+}
+
+void
+G_LogRecord(log_format_t* format, const char* fmt, ...) {
+    (void) fmt;
+    if (!G_LogParseFormat(format)) {
+        return;
+    }
+
+    const Uint64 ticks = SDL_GetPerformanceCounter();
+    va_list args;
+
+#if CGAME_LOG_ASYNC
+    if (SDL_GetAtomicInt(&running)) {
+        Uint32 pos;
+        log_record_t* record = G_LogAcquire(&pos);
+        if (record) {
+            record->format = format;
+            record->ticks = ticks;
+            va_start(args, fmt);
+            record->length = G_LogEncode(
+                format,
+                args,
+                (Uint8*) record->msg,
+                sizeof(record->msg));
+            va_end(args);
+            G_LogPublish(record, pos);
+        }
+        return;
+    }
+#endif
+
+    Uint8 payload[LOG_MAX_MESSAGE_LENGTH];
+    va_start(args, fmt);
+    const Uint16 length = G_LogEncode(format, args, payload, sizeof(payload));
+    va_end(args);
+
+    SDL_Mutex* lock = G_LogLockOutput();
+    G_LogWriteBinary(format, ticks, payload, length);
+    if (bin_out) {
+        fflush(bin_out);
+    }
+    G_LogUnlockOutput(lock);
+}
+
+int
+G_LogStart(log_overflow_t overflow) {
+    // other threads may log from here on
+    if (!write_mutex) {
+        write_mutex = SDL_CreateMutex();
+        if (!write_mutex) {
+            G_Log("ERROR", "Failed to create the log mutex.");
+            return 0;
+        }
+    }
+
+#if CGAME_LOG_ASYNC
+    if (writer) {
+        return 1;
+    }
+
+    const Uint32 pos = SDL_GetAtomicU32(&write_pos);
+    for (Uint32 i = 0; i < CGAME_LOG_RING_SIZE; i++) {
+        SDL_SetAtomicU32(&ring[(pos + i) & (CGAME_LOG_RING_SIZE - 1)].sequence,
+            pos + i);
+    }
+    SDL_SetAtomicU32(&read_pos, pos);
+    policy = overflow;
+
+    wake = SDL_CreateSemaphore(0);
+    if (!wake) {
+        G_Log("ERROR", "Failed to create the log semaphore.");
+        return 0;
+    }
+
+    SDL_SetAtomicInt(&running, 1);
+    writer = SDL_CreateThread(G_LogWriter, "log", NULL);
+    if (!writer) {
+        SDL_SetAtomicInt(&running, 0);
+        SDL_DestroySemaphore(wake);
+        wake = NULL;
+        G_Log("ERROR", "Failed to create the log writer thread.");
+        return 0;
+    }
+#else
+    (void) overflow;
+#endif
+    return 1;
+}
+
+void
+G_LogFlush(void) {
+    if (!writer) {
+        return;
+    }
+
+    const Uint32 target = SDL_GetAtomicU32(&write_pos);
+    SDL_SignalSemaphore(wake);
+    while ((int) (SDL_GetAtomicU32(&read_pos) - target) < 0) {
+        SDL_Delay(1);
+    }
+}
+
+void
+G_LogStop(void) {
+    if (writer) {
+        SDL_SetAtomicInt(&running, 0);
+        SDL_SignalSemaphore(wake);
+        SDL_WaitThread(writer, NULL);
+        writer = NULL;
+
+        // anything pushed while the writer was on its way out
+        G_LogDrain();
+
+        SDL_DestroySemaphore(wake);
+        wake = NULL;
+    }
+
+    // only this thread logs now
+    SDL_DestroyMutex(write_mutex);
+    write_mutex = NULL;
+}
+
+Uint32
+G_LogDropped(void) {
+    return (Uint32) SDL_GetAtomicInt(&dropped);
+}
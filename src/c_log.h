@@ -4,11 +4,274 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <SDL3/SDL.h>
+
+#include "c_logbin.h"
+
+/* Set to 0 to always write on the calling thread. */
+#define CGAME_LOG_ASYNC 1
+
+/* Longest line written; longer messages are truncated. */
+#define LOG_MAX_MESSAGE_LENGTH 1024
+
+/* Longest tag kept by the async ring. */
+#define CGAME_LOG_TAG_LENGTH 32
+
+/* Records the async ring holds, a power of two. */
+#define CGAME_LOG_RING_SIZE 256
+
+/* Pending records that wake the writer before its timeout. */
+#define CGAME_LOG_BATCH 32
+
+/* Longest a record waits before the writer flushes it, in milliseconds. */
+#define CGAME_LOG_FLUSH_MS 50
+
+/* What G_Log does when the async ring is full. */
+typedef enum {
+    /* Lose the message. */
+    LOG_OVERFLOW_DROP,
+
+    /* Wait for the writer to make room. */
+    LOG_OVERFLOW_BLOCK,
+
+    /* Lose the message, and log how many were lost once there is room. */
+    LOG_OVERFLOW_COUNT
+} log_overflow_t;
+
+/* Overflow policy the game starts the logger with. */
+#define CGAME_LOG_OVERFLOW LOG_OVERFLOW_COUNT
+
+/* Files the text log can be written to, besides stdout. */
+#define CGAME_LOG_FILE_STREAM 0
+#define CGAME_LOG_FILE_RING 1
+
+/* log.out grows without limit. The ring file keeps the last
+ * CGAME_LOG_RING_FILE_SIZE bytes, is written with plain memory stores and
+ * survives a crash of the game; read it with tools/log_read. Only on unix,
+ * other platforms fall back to log.out. */
+#ifndef CGAME_LOG_FILE
+#define CGAME_LOG_FILE CGAME_LOG_FILE_STREAM
+#endif
+
+#define CGAME_LOG_RING_FILE "log.ring"
+
+/* Bytes of text the ring file holds. */
+#define CGAME_LOG_RING_FILE_SIZE (16u << 20)
+
+/* Severities of the leveled log macros. */
+#define LOG_LEVEL_VERBOSE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_ERROR 4
+
+/* Above every level, to turn a tag off. */
+#define LOG_LEVEL_OFF 5
+
+/* Makes a tag follow the default level again. */
+#define LOG_LEVEL_DEFAULT -1
+
+/* Leveled statements below this level are compiled out. Set it with e.g.
+ * -DCGAME_LOG_LEVEL=2 to leave only INFO and above in a build. */
+#ifndef CGAME_LOG_LEVEL
+#define CGAME_LOG_LEVEL LOG_LEVEL_VERBOSE
+#endif
+
+/* Level logged by tags without a level of their own, until changed. */
+#define CGAME_LOG_DEFAULT_LEVEL LOG_LEVEL_INFO
+
+/* Most tags that can have a level of their own. */
+#define CGAME_LOG_MAX_TAGS 64
+
+/* Lowest level a tag logs. Read without a lock by every statement, so a
+ * change may take a moment to reach other threads. */
+typedef struct {
+    int level;
+} log_filter_t;
+
+/* Every site starts out pointing here, which lets the first call through
+ * to look up the filter of its tag. */
+extern log_filter_t log_unresolved;
+
+/* A call site of the leveled log macros. The filter is set on the first
+ * call, and always to the same one, so it is also read without a lock. */
+typedef struct {
+    const char* tag;
+    const log_filter_t* filter;
+} log_site_t;
+
+/*
+ * Log a printf style message at a level, under a tag naming the subsystem.
+ * When the level is below the tag's filter the statement costs one load and
+ * a branch, and the arguments are not evaluated. Below CGAME_LOG_LEVEL it
+ * is compiled out, though the arguments are still type checked.
+ */
+#define G_LOG_AT(level_, tag_, ...) \
+    do { \
+        static log_site_t log_site_ = { (tag_), &log_unresolved }; \
+        if ((level_) >= log_site_.filter->level) { \
+            G_LogAt(&log_site_, (level_), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define G_LOG_NEVER(level_, tag_, ...) \
+    do { \
+        if (0) { \
+            G_LogAt(NULL, (level_), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if CGAME_LOG_LEVEL <= LOG_LEVEL_VERBOSE
+#define G_LogVerbose(tag, ...) G_LOG_AT(LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#else
+#define G_LogVerbose(tag, ...) G_LOG_NEVER(LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#endif
+
+#if CGAME_LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define G_LogDebug(tag, ...) G_LOG_AT(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#else
+#define G_LogDebug(tag, ...) G_LOG_NEVER(LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#endif
+
+#if CGAME_LOG_LEVEL <= LOG_LEVEL_INFO
+#define G_LogInfo(tag, ...) G_LOG_AT(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#else
+#define G_LogInfo(tag, ...) G_LOG_NEVER(LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#endif
+
+#if CGAME_LOG_LEVEL <= LOG_LEVEL_WARNING
+#define G_LogWarning(tag, ...) G_LOG_AT(LOG_LEVEL_WARNING, tag, __VA_ARGS__)
+#else
+#define G_LogWarning(tag, ...) G_LOG_NEVER(LOG_LEVEL_WARNING, tag, __VA_ARGS__)
+#endif
+
+#if CGAME_LOG_LEVEL <= LOG_LEVEL_ERROR
+#define G_LogError(tag, ...) G_LOG_AT(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#else
+#define G_LogError(tag, ...) G_LOG_NEVER(LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#endif
+
+/* File G_LogBinary writes to, read back with tools/log_decode. */
+#define CGAME_LOG_BINARY_FILE "log.bin"
+
+/* A call site of G_LogBinary. */
+typedef struct {
+    const char* tag;
+    const char* format;
+
+    /* 1 once kinds is filled in, -1 if the format cannot be logged. */
+    SDL_AtomicInt parsed;
+    SDL_SpinLock lock;
+    Uint8 count;
+    Uint8 kinds[LOG_BIN_MAX_ARGS];
+
+    /* Id in the binary file, 0 until its format record is written. */
+    Uint32 id;
+} log_format_t;
+
+#if defined(__GNUC__)
+#define LOG_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define LOG_PRINTF_FORMAT(fmt, args)
+#endif
+
+#define LOG_FIRST_(first, ...) first
+#define LOG_FIRST(...) LOG_FIRST_(__VA_ARGS__, 0)
+
+/*
+ * Log a printf style message to the binary log without formatting it. The
+ * format must be a string literal; only its raw arguments are recorded,
+ * along with a monotonic timestamp, and tools/log_decode formats them.
+ * Supports the d, i, u, x, X, o, c, f, e, g, a, s and p conversions with
+ * the h, hh, l, ll and z lengths.
+ */
+#define G_LogBinary(tag, ...) \
+    do { \
+        static log_format_t log_format_ = { (tag), LOG_FIRST(__VA_ARGS__) }; \
+        G_LogRecord(&log_format_, __VA_ARGS__); \
+    } while (0)
 
 /**
- * Print a log message to file and stdout.
+ * Print a log message to file and stdout. Thread safe. Once G_LogStart has
+ * been called the message is only copied into a ring, and a writer thread
+ * formats and writes it.
  */
 void
 G_Log(const char* tag, const char* msg);
 
-#endif
\ No newline at end of file
+/**
+ * Format and log one leveled message; use the G_LogInfo family of macros
+ * rather than calling this.
+ * @param site The call site, whose filter is looked up on the first call.
+ * @param level The level of the message.
+ * @param fmt The printf format.
+ */
+void
+G_LogAt(log_site_t* site, int level, const char* fmt, ...)
+    LOG_PRINTF_FORMAT(3, 4);
+
+/**
+ * Set the level logged by tags that do not have one of their own.
+ * @param level The lowest level logged.
+ */
+void
+G_LogSetLevel(int level);
+
+/**
+ * Set the level logged under one tag.
+ * @param tag The tag.
+ * @param level The lowest level logged, or LOG_LEVEL_DEFAULT.
+ * @returns Success, or failure if CGAME_LOG_MAX_TAGS tags are in use.
+ */
+int
+G_LogSetTagLevel(const char* tag, int level);
+
+/**
+ * Check a level against the filter of a tag, for messages that are costly
+ * to build and whose level is only known at run time. Looks the tag up,
+ * so it costs more than the check made by the macros.
+ * @param level The level.
+ * @param tag The tag.
+ * @returns 1 if a message would be logged, 0 otherwise.
+ */
+int
+G_LogEnabled(int level, const char* tag);
+
+/**
+ * Record one binary log event; use G_LogBinary rather than calling this.
+ * @param format The call site.
+ * @param fmt The format string, the same as format->format.
+ */
+void
+G_LogRecord(log_format_t* format, const char* fmt, ...) LOG_PRINTF_FORMAT(2, 3);
+
+/**
+ * Start the writer thread. Messages logged before this, or when it fails,
+ * are written on the calling thread. Call before other threads log.
+ * @param overflow What to do with messages when the ring is full.
+ * @returns Success or failure.
+ */
+int
+G_LogStart(log_overflow_t overflow);
+
+/**
+ * Wait until every message logged so far has been written and flushed.
+ */
+void
+G_LogFlush(void);
+
+/**
+ * Write what is left in the ring and stop the writer thread. Logging goes
+ * back to the calling thread. Other threads must have stopped logging.
+ */
+void
+G_LogStop(void);
+
+/**
+ * Number of messages lost to a full ring since the writer started.
+ * @returns The count.
+ */
+Uint32
+G_LogDropped(void);
+
+#endif
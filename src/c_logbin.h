@@ -0,0 +1,139 @@
+#ifndef LOGBIN_H_
+#define LOGBIN_H_
+
+#include <stdint.h>
+
+/*
+ * Layout of the binary log written by G_LogBinary, shared with the decoder
+ * in tools/. Everything is in the byte order of the machine that wrote it.
+ *
+ * The file starts with a log_bin_header_t, followed by records that each
+ * start with a type byte:
+ *
+ *   format: id (u32), tag length (u16), tag, format length (u16), format,
+ *           argument count (u8), one kind (u8) per argument
+ *   event:  format id (u32), ticks (u64), payload length (u16), payload
+ *
+ * A format record comes before the first event that uses it. An event
+ * payload holds its arguments in order: integers, pointers and doubles as
+ * 8 bytes, strings as a length (u16) and that many bytes.
+ */
+
+#define LOG_BIN_MAGIC "CGLOGBIN"
+#define LOG_BIN_BYTE_ORDER 0x01020304u
+
+/* Most arguments a binary log format may take. */
+#define LOG_BIN_MAX_ARGS 16
+
+#define LOG_BIN_RECORD_FORMAT 1
+#define LOG_BIN_RECORD_EVENT 2
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t reserved;
+
+    /* Ticks per second of the event timestamps. */
+    uint64_t tick_frequency;
+
+    /* Ticks and seconds since the Unix epoch when the file was opened. */
+    uint64_t start_ticks;
+    int64_t start_time;
+} log_bin_header_t;
+
+/* How an argument is read from the caller and passed back to printf. */
+typedef enum {
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_LONG,
+    LOG_ARG_ULONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_ULLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,
+    LOG_ARG_POINTER,
+
+    /* "%%", which takes no argument. */
+    LOG_ARG_NONE,
+
+    /* A conversion the binary log does not support, such as '*' widths. */
+    LOG_ARG_INVALID
+} log_arg_t;
+
+/**
+ * Parse one printf conversion.
+ * @param spec Points at the '%' that starts the conversion.
+ * @param end Set to just past the conversion.
+ * @returns The kind of argument the conversion takes.
+ */
+static inline log_arg_t
+C_LogBinConversion(const char* spec, const char** end) {
+    const char* p = spec + 1;
+
+    // flags, width and precision
+    while (*p && (*p == '-' || *p == '+' || *p == ' ' || *p == '#'
+        || *p == '0')) {
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    if (*p == '.') {
+        p++;
+        while (*p >= '0' && *p <= '9') {
+            p++;
+        }
+    }
+
+    // length modifier, 1 for l, 2 for ll, 3 for z
+    int length = 0;
+    if (*p == 'h') {
+        p += p[1] == 'h' ? 2 : 1;
+    } else if (*p == 'l') {
+        length = p[1] == 'l' ? 2 : 1;
+        p += length;
+    } else if (*p == 'z') {
+        length = 3;
+        p++;
+    }
+
+    const char c = *p;
+    *end = c ? p + 1 : p;
+
+    switch (c) {
+    case '%':
+        return p == spec + 1 ? LOG_ARG_NONE : LOG_ARG_INVALID;
+    case 'd':
+    case 'i':
+        return length == 0 ? LOG_ARG_INT
+            : length == 1 ? LOG_ARG_LONG
+            : length == 2 ? LOG_ARG_LLONG : LOG_ARG_SIZE;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        return length == 0 ? LOG_ARG_UINT
+            : length == 1 ? LOG_ARG_ULONG
+            : length == 2 ? LOG_ARG_ULLONG : LOG_ARG_SIZE;
+    case 'c':
+        return length == 0 ? LOG_ARG_INT : LOG_ARG_INVALID;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+        return length < 2 ? LOG_ARG_DOUBLE : LOG_ARG_INVALID;
+    case 's':
+        return length == 0 ? LOG_ARG_STRING : LOG_ARG_INVALID;
+    case 'p':
+        return length == 0 ? LOG_ARG_POINTER : LOG_ARG_INVALID;
+    default:
+        return LOG_ARG_INVALID;
+    }
+}
+
+#endif
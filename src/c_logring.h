@@ -0,0 +1,35 @@
+#ifndef LOGRING_H_
+#define LOGRING_H_
+
+#include <stdint.h>
+
+/*
+ * Layout of the ring file the text log is written to when CGAME_LOG_FILE is
+ * CGAME_LOG_FILE_RING, shared with the reader in tools/. Everything is in
+ * the byte order of the machine that wrote it.
+ *
+ * The file is a log_ring_header_t followed by capacity bytes of text. Line
+ * bytes are stored at cursor % capacity, wrapping to the start of the data,
+ * and the cursor is advanced once a whole line is in place. Once the cursor
+ * passes the capacity the oldest text starts at cursor % capacity, usually
+ * in the middle of a line.
+ */
+
+#define LOG_RING_MAGIC "CGLOGRNG"
+#define LOG_RING_BYTE_ORDER 0x01020304u
+
+typedef struct {
+    char magic[8];
+    uint32_t byte_order;
+
+    /* Offset of the text from the start of the file. */
+    uint32_t data_offset;
+
+    /* Bytes of text the file holds. */
+    uint64_t capacity;
+
+    /* Bytes of text written since the file was created. */
+    uint64_t cursor;
+} log_ring_header_t;
+
+#endif
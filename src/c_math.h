@@ -1,7 +1,39 @@
 #ifndef VEC_H_
 #define VEC_H_
 
+#include <float.h>
 #include <math.h>
+#include <stddef.h>
+
+/*
+ * SIMD kernels are only built for x86 with a GCC-compatible compiler, since
+ * they rely on per-function target attributes so the rest of the build does
+ * not need -mavx/-mfma. Define CGAME_NO_SIMD to force the scalar path.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) \
+    && !defined(CGAME_NO_SIMD)
+#define M_SIMD_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define M_SIMD_X86 0
+#endif
+
+/*
+ * The aligned register types below are backed by __m128 whenever SSE2 is part
+ * of the baseline (always on x86-64), otherwise by an aligned float array.
+ */
+#if M_SIMD_X86 && defined(__SSE2__)
+#define M_SIMD_VECTOR_TYPES 1
+#else
+#define M_SIMD_VECTOR_TYPES 0
+#endif
+
+#if defined(__GNUC__)
+#define M_ALIGN16 __attribute__((aligned(16)))
+#else
+#define M_ALIGN16
+#endif
 
 #define M_2_PI 6.28318530717958647692
 #define M_1_PI 0.31830988618379067153803535746773
@@ -81,6 +113,102 @@ typedef struct mat3_t {
     float m[3][3];
 } mat3_t;
 
+/**
+ * @struct aabb_t
+ * @brief Axis-aligned bounding box given by its corners. An empty box has
+ * min > max on every axis (see M_AABBEmpty).
+ */
+typedef struct aabb_t {
+    /**
+     * @brief Minimum corner.
+     */
+    vec_t min;
+
+    /**
+     * @brief Maximum corner.
+     */
+    vec_t max;
+} aabb_t;
+
+/**
+ * @struct sphere_t
+ * @brief Bounding sphere.
+ */
+typedef struct sphere_t {
+    /**
+     * @brief Center of the sphere.
+     */
+    vec_t center;
+
+    /**
+     * @brief Radius of the sphere.
+     */
+    float radius;
+} sphere_t;
+
+/**
+ * @struct vec3a_t
+ * @brief 16-byte aligned 3-component vector kept in one SIMD register. The
+ * fourth lane is padding and is always zero.
+ */
+typedef struct vec3a_t {
+#if M_SIMD_VECTOR_TYPES
+    /**
+     * @brief x, y, z, 0 lanes.
+     */
+    __m128 v;
+#else
+    /**
+     * @brief x, y, z, 0 lanes.
+     */
+    float v[4] M_ALIGN16;
+#endif
+} vec3a_t;
+
+/**
+ * @struct vec4a_t
+ * @brief 16-byte aligned 4-component vector kept in one SIMD register.
+ */
+typedef struct vec4a_t {
+#if M_SIMD_VECTOR_TYPES
+    /**
+     * @brief x, y, z, w lanes.
+     */
+    __m128 v;
+#else
+    /**
+     * @brief x, y, z, w lanes.
+     */
+    float v[4] M_ALIGN16;
+#endif
+} vec4a_t;
+
+/**
+ * @struct mat4a_t
+ * @brief 16-byte aligned row-major 4x4 matrix, one register per row.
+ */
+typedef struct mat4a_t {
+    /**
+     * @brief Matrix rows.
+     */
+    vec4a_t r[4];
+} mat4a_t;
+
+/**
+ * @enum eMathSimdLevel
+ * @brief Instruction set used by the dispatched matrix kernels.
+ */
+typedef enum eMathSimdLevel {
+    /** Plain C reference path. */
+    M_SIMD_SCALAR,
+    /** 128-bit SSE2. */
+    M_SIMD_SSE2,
+    /** 256-bit AVX, two rows per iteration. */
+    M_SIMD_AVX,
+    /** AVX with fused multiply-add. */
+    M_SIMD_FMA
+} MathSimdLevel;
+
 /**
  * @brief Adds two 3-dimension vectors together.
  * @param a The first vector
@@ -204,6 +332,58 @@ M_SumOfSquares(const vec_t* a);
 mat4_t
 M_MultiplyMat4(const mat4_t* a, const mat4_t* b);
 
+/**
+ * @brief Reference implementation of M_MultiplyMat4. Always scalar.
+ * @param a The first mat
+ * @param b The second mat
+ * @return The multipled mat4
+ */
+mat4_t
+M_MultiplyMat4Scalar(const mat4_t* a, const mat4_t* b);
+
+/**
+ * @brief Multiply a mat4 by a column vec4 (mat * vec)
+ * @param mat The matrix
+ * @param vec The vector
+ * @return The transformed vector
+ */
+vec4_t
+M_MultiplyMat4Vec4(const mat4_t* mat, const vec4_t* vec);
+
+/**
+ * @brief Reference implementation of M_MultiplyMat4Vec4. Always scalar.
+ * @param mat The matrix
+ * @param vec The vector
+ * @return The transformed vector
+ */
+vec4_t
+M_MultiplyMat4Vec4Scalar(const mat4_t* mat, const vec4_t* vec);
+
+/**
+ * @brief Detect the best instruction set with cpuid and select the matrix
+ * kernels for it. Called once at startup; before it runs every dispatched
+ * function uses the scalar path.
+ * @return The selected level
+ */
+MathSimdLevel
+M_InitSimd(void);
+
+/**
+ * @brief Get the instruction set currently used by the matrix kernels.
+ * @return The current level
+ */
+MathSimdLevel
+M_GetSimdLevel(void);
+
+/**
+ * @brief Force the matrix kernels to a given level (benchmarks, debugging).
+ * Levels the CPU does not support are clamped to the detected level.
+ * @param level The requested level
+ * @return The level actually selected
+ */
+MathSimdLevel
+M_SetSimdLevel(MathSimdLevel level);
+
 /**
  * @brief Multiply two mat3 matrices together
  * @param a The first mat
@@ -237,6 +417,139 @@ M_Mat3Identity(void);
 void
 Vec4_MultiplyMatrix(vec4_t* vec, const mat4_t* mat);
 
+/**
+ * @brief Transform an array of vec4s by one matrix (mat * vec each).
+ * @param mat The matrix
+ * @param in The source vectors
+ * @param out The destination vectors, may alias in
+ * @param count The number of vectors
+ */
+void
+M_TransformVec4Batch(
+    const mat4_t* mat,
+    const vec4_t* in,
+    vec4_t* out,
+    size_t count);
+
+/**
+ * @brief Transform structure-of-arrays points (w = 1) by one matrix.
+ * Outputs may alias the inputs.
+ * @param mat The matrix
+ * @param x The source x components
+ * @param y The source y components
+ * @param z The source z components
+ * @param out_x The destination x components
+ * @param out_y The destination y components
+ * @param out_z The destination z components
+ * @param out_w The destination w components, or NULL for affine matrices
+ * @param count The number of points
+ */
+void
+M_TransformPointsSoA(
+    const mat4_t* mat,
+    const float* x,
+    const float* y,
+    const float* z,
+    float* out_x,
+    float* out_y,
+    float* out_z,
+    float* out_w,
+    size_t count);
+
+/**
+ * @brief Normalize an array of vectors in place
+ * @param vecs The vectors
+ * @param count The number of vectors
+ */
+void
+M_NormalizeVecBatch(vec_t* vecs, size_t count);
+
+/**
+ * @brief Dot product of each pair of vectors: out[i] = a[i] . b[i]
+ * @param a The first vectors
+ * @param b The second vectors
+ * @param out The dot products
+ * @param count The number of vectors
+ */
+void
+M_DotBatch(const vec_t* a, const vec_t* b, float* out, size_t count);
+
+/**
+ * @brief Cross product of each pair of vectors: out[i] = a[i] x b[i]
+ * @param a The first vectors
+ * @param b The second vectors
+ * @param out The cross products, may alias a or b
+ * @param count The number of vectors
+ */
+void
+M_CrossBatch(const vec_t* a, const vec_t* b, vec_t* out, size_t count);
+
+/**
+ * @brief Get an empty box that any union or expand replaces
+ * @return The empty box
+ */
+aabb_t
+M_AABBEmpty(void);
+
+/**
+ * @brief Get the smallest box containing both boxes
+ * @param a The first box
+ * @param b The second box
+ * @return The union
+ */
+aabb_t
+M_AABBUnion(const aabb_t* a, const aabb_t* b);
+
+/**
+ * @brief Grow the box to contain the point
+ * @param box The box, in place
+ * @param p The point
+ */
+void
+M_AABBExpand(aabb_t* box, const vec_t* p);
+
+/**
+ * @brief Get the center of the box
+ * @param box The box
+ * @return The center
+ */
+vec_t
+M_AABBCenter(const aabb_t* box);
+
+/**
+ * @brief Get the surface area of the box, 0 for an empty box
+ * @param box The box
+ * @return The surface area
+ */
+float
+M_AABBSurfaceArea(const aabb_t* box);
+
+/**
+ * @brief Test if two boxes overlap, touching counts
+ * @param a The first box
+ * @param b The second box
+ * @return 1 if they overlap, 0 if not
+ */
+int
+M_AABBOverlap(const aabb_t* a, const aabb_t* b);
+
+/**
+ * @brief Test if a sphere overlaps a box, touching counts
+ * @param s The sphere
+ * @param box The box
+ * @return 1 if they overlap, 0 if not
+ */
+int
+M_SphereOverlapAABB(const sphere_t* s, const aabb_t* box);
+
+/**
+ * @brief Get the box enclosing a sphere
+ * @param s The sphere
+ * @return The bounding box
+ */
+aabb_t
+M_AABBFromSphere(const sphere_t* s);
+
 mat4_t
 Mat4_TranslationMatrix(float x, float y, float z);
 
@@ -267,6 +580,409 @@ Mat4_LookAt(vec_t eye, vec_t target, vec_t up);
 
 mat4_t Mat4_Transpose(mat4_t mat);
 
+/**
+ * @brief Invert a general 4x4 matrix using cofactors
+ * @param mat The matrix
+ * @param out Output - the inverse, untouched if mat is singular
+ * @return True on success, false if the matrix is singular
+ */
+int
+Mat4_Inverse(const mat4_t* mat, mat4_t* out);
+
+/**
+ * @brief Invert an affine matrix (bottom row 0 0 0 1) by inverting the upper
+ * 3x3 and the translation separately. Handles rotation, scale and shear.
+ * @param mat The affine matrix
+ * @param out Output - the inverse, untouched if mat is singular
+ * @return True on success, false if the 3x3 part is singular
+ */
+int
+Mat4_InverseAffine(const mat4_t* mat, mat4_t* out);
+
+/**
+ * @brief Invert a rigid matrix (orthonormal rotation plus translation, e.g.
+ * Mat4_LookAt or Mat4_RotationMatrix * Mat4_TranslationMatrix) with a
+ * transposed 3x3 and a rotated translation. Undefined for scaled matrices.
+ * @param mat The rigid matrix
+ * @return The inverse
+ */
+mat4_t
+Mat4_InverseRigid(const mat4_t* mat);
+
+/**
+ * @brief Multiply two affine matrices, skipping the constant bottom row
+ * @param a The first affine mat
+ * @param b The second affine mat
+ * @return The multiplied affine mat4
+ */
+mat4_t
+M_MultiplyMat4Affine(const mat4_t* a, const mat4_t* b);
+
+/**
+ * @brief Get the normal matrix, the inverse transpose of the upper 3x3
+ * @param mat The model or model-view matrix
+ * @return The normal matrix, or the identity if the 3x3 part is singular
+ */
+mat3_t
+Mat4_NormalMatrix(const mat4_t* mat);
+
+#if M_SIMD_X86
+
+/*
+ * vec_t is a packed 12-byte struct, so four of them are exactly three
+ * __m128 loads: x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3. These helpers shuffle
+ * between that layout and one register per component.
+ */
+
+__attribute__((target("sse2")))
+static inline void
+M_LoadVec3x4(const vec_t* v, __m128* x, __m128* y, __m128* z) {
+    const float* f = &v->x;
+    const __m128 m0 = _mm_loadu_ps(f);
+    const __m128 m1 = _mm_loadu_ps(f + 4);
+    const __m128 m2 = _mm_loadu_ps(f + 8);
+
+    const __m128 xy23 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+    const __m128 y01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 0, 1, 1));
+    const __m128 z01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 1, 2, 2));
+
+    *x = _mm_shuffle_ps(m0, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+    *y = _mm_shuffle_ps(y01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+    *z = _mm_shuffle_ps(z01, m2, _MM_SHUFFLE(3, 0, 2, 0));
+}
+
+__attribute__((target("sse2")))
+static inline void
+M_StoreVec3x4(vec_t* v, __m128 x, __m128 y, __m128 z) {
+    float* f = &v->x;
+    const __m128 xy01 = _mm_unpacklo_ps(x, y);
+    const __m128 xy23 = _mm_unpackhi_ps(x, y);
+    const __m128 zx01 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0));
+    const __m128 yz11 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1));
+    const __m128 zx23 = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2));
+    const __m128 yz33 = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3));
+
+    _mm_storeu_ps(f, _mm_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0)));
+    _mm_storeu_ps(f + 4, _mm_shuffle_ps(yz11, xy23, _MM_SHUFFLE(1, 0, 2, 0)));
+    _mm_storeu_ps(f + 8, _mm_shuffle_ps(zx23, yz33, _MM_SHUFFLE(2, 0, 2, 0)));
+}
+
+#endif // M_SIMD_X86
+
+/*
+ * Aligned register types. These are static inline so that hot loops keep the
+ * values in registers across calls instead of going through vec_t memory.
+ */
+
+/**
+ * @brief Load a vec_t into an aligned register vector
+ * @param a The vector
+ * @return The register vector
+ */
+static inline vec3a_t
+M_Vec3aFromVec(const vec_t* a) {
+    vec3a_t res;
+#if M_SIMD_VECTOR_TYPES
+    res.v = _mm_set_ps(0.0f, a->z, a->y, a->x);
+#else
+    res.v[0] = a->x;
+    res.v[1] = a->y;
+    res.v[2] = a->z;
+    res.v[3] = 0.0f;
+#endif
+    return res;
+}
+
+/**
+ * @brief Store an aligned register vector back into a vec_t
+ * @param a The register vector
+ * @return The vector
+ */
+static inline vec_t
+M_VecFromVec3a(vec3a_t a) {
+#if M_SIMD_VECTOR_TYPES
+    float f[4] M_ALIGN16;
+    _mm_store_ps(f, a.v);
+    return (vec_t) { .x = f[0], .y = f[1], .z = f[2] };
+#else
+    return (vec_t) { .x = a.v[0], .y = a.v[1], .z = a.v[2] };
+#endif
+}
+
+/**
+ * @brief Load a vec4_t into an aligned register vector
+ * @param a The vector
+ * @return The register vector
+ */
+static inline vec4a_t
+M_Vec4aFromVec4(const vec4_t* a) {
+    vec4a_t res;
+#if M_SIMD_VECTOR_TYPES
+    res.v = _mm_loadu_ps(&a->x);
+#else
+    res.v[0] = a->x;
+    res.v[1] = a->y;
+    res.v[2] = a->z;
+    res.v[3] = a->w;
+#endif
+    return res;
+}
+
+/**
+ * @brief Store an aligned register vector back into a vec4_t
+ * @param a The register vector
+ * @return The vector
+ */
+static inline vec4_t
+M_Vec4FromVec4a(vec4a_t a) {
+    vec4_t res;
+#if M_SIMD_VECTOR_TYPES
+    _mm_storeu_ps(&res.x, a.v);
+#else
+    res.x = a.v[0];
+    res.y = a.v[1];
+    res.z = a.v[2];
+    res.w = a.v[3];
+#endif
+    return res;
+}
+
+/**
+ * @brief Load a mat4_t into an aligned register matrix
+ * @param a The matrix
+ * @return The register matrix
+ */
+static inline mat4a_t
+M_Mat4aFromMat4(const mat4_t* a) {
+    mat4a_t res;
+    for (unsigned char i = 0; i < 4; i++) {
+        res.r[i] = M_Vec4aFromVec4((const vec4_t*) a->m[i]);
+    }
+    return res;
+}
+
+/**
+ * @brief Store an aligned register matrix back into a mat4_t
+ * @param a The register matrix
+ * @return The matrix
+ */
+static inline mat4_t
+M_Mat4FromMat4a(const mat4a_t* a) {
+    mat4_t res;
+    for (unsigned char i = 0; i < 4; i++) {
+        vec4_t row = M_Vec4FromVec4a(a->r[i]);
+        res.m[i][0] = row.x;
+        res.m[i][1] = row.y;
+        res.m[i][2] = row.z;
+        res.m[i][3] = row.w;
+    }
+    return res;
+}
+
+/**
+ * @brief Adds two register vectors together.
+ * @param a The first vector
+ * @param b The second vector
+ * @return The summed vector
+ */
+static inline vec3a_t
+M_AddVec3a(vec3a_t a, vec3a_t b) {
+    vec3a_t res;
+#if M_SIMD_VECTOR_TYPES
+    res.v = _mm_add_ps(a.v, b.v);
+#else
+    for (unsigned char i = 0; i < 4; i++) {
+        res.v[i] = a.v[i] + b.v[i];
+    }
+#endif
+    return res;
+}
+
+/**
+ * @brief Subtracts two register vectors.
+ * @param a The first vector
+ * @param b The second vector
+ * @return The subtracted vector
+ */
+static inline vec3a_t
+M_SubtractVec3a(vec3a_t a, vec3a_t b) {
+    vec3a_t res;
+#if M_SIMD_VECTOR_TYPES
+    res.v = _mm_sub_ps(a.v, b.v);
+#else
+    for (unsigned char i = 0; i < 4; i++) {
+        res.v[i] = a.v[i] - b.v[i];
+    }
+#endif
+    return res;
+}
+
+/**
+ * @brief Multiply a register vector by the scalar amount
+ * @param a The vector
+ * @param s The scalar amount
+ * @return The multiplied vector
+ */
+static inline vec3a_t
+M_MultiplyVec3aByScalar(vec3a_t a, float s) {
+    vec3a_t res;
+#if M_SIMD_VECTOR_TYPES
+    res.v = _mm_mul_ps(a.v, _mm_set1_ps(s));
+#else
+    for (unsigned char i = 0; i < 4; i++) {
+        res.v[i] = a.v[i] * s;
+    }
+#endif
+    return res;
+}
+
+#if M_SIMD_VECTOR_TYPES
+/* Horizontal sum of all four lanes, broadcast to every lane. */
+static inline __m128
+M_HorizontalSum4(__m128 v) {
+    __m128 t = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+#endif
+
+/**
+ * @brief Get the dot product of two register vectors
+ * @param a The first vector
+ * @param b The second vector
+ * @return The dot product
+ */
+static inline float
+M_Dot3a(vec3a_t a, vec3a_t b) {
+#if M_SIMD_VECTOR_TYPES
+    return _mm_cvtss_f32(M_HorizontalSum4(_mm_mul_ps(a.v, b.v)));
+#else
+    return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+#endif
+}
+
+/**
+ * @brief Get the dot product of two 4-component register vectors
+ * @param a The first vector
+ * @param b The second vector
+ * @return The dot product
+ */
+static inline float
+M_Dot4a(vec4a_t a, vec4a_t b) {
+#if M_SIMD_VECTOR_TYPES
+    return _mm_cvtss_f32(M_HorizontalSum4(_mm_mul_ps(a.v, b.v)));
+#else
+    return a.v[0] * b.v[0] + a.v[1] * b.v[1] 
+        + a.v[2] * b.v[2] + a.v[3] * b.v[3];
+#endif
+}
+
+/**
+ * @brief Get the cross product of two register vectors
+ * @param a The first vector
+ * @param b The second vector
+ * @return The cross product
+ */
+static inline vec3a_t
+M_Cross3a(vec3a_t a, vec3a_t b) {
+    vec3a_t res;
+#if M_SIMD_VECTOR_TYPES
+    // a * b.yzx - a.yzx * b, then rotate the result back by yzx
+    const __m128 a_yzx = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 b_yzx = _mm_shuffle_ps(b.v, b.v, _MM_SHUFFLE(3, 0, 2, 1));
+    const __m128 c = _mm_sub_ps(_mm_mul_ps(a.v, b_yzx), _mm_mul_ps(a_yzx, b.v));
+    res.v = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+#else
+    res.v[0] = (a.v[1] * b.v[2]) - (b.v[1] * a.v[2]);
+    res.v[1] = (a.v[2] * b.v[0]) - (b.v[2] * a.v[0]);
+    res.v[2] = (a.v[0] * b.v[1]) - (b.v[0] * a.v[1]);
+    res.v[3] = 0.0f;
+#endif
+    return res;
+}
+
+/**
+ * @brief Normalize a register vector
+ * @param a The vector
+ * @return The normalized vector
+ */
+static inline vec3a_t
+M_NormalizeVec3a(vec3a_t a) {
+    vec3a_t res;
+#if M_SIMD_VECTOR_TYPES
+    const __m128 len = _mm_sqrt_ps(M_HorizontalSum4(_mm_mul_ps(a.v, a.v)));
+    res.v = _mm_div_ps(a.v, len);
+#else
+    const float len = sqrtf(M_Dot3a(a, a));
+    for (unsigned char i = 0; i < 4; i++) {
+        res.v[i] = a.v[i] / len;
+    }
+#endif
+    return res;
+}
+
+/**
+ * @brief Multiply a register matrix by a register vector (mat * vec)
+ * @param mat The matrix
+ * @param vec The vector
+ * @return The transformed vector
+ */
+static inline vec4a_t
+M_MultiplyMat4aVec4a(const mat4a_t* mat, vec4a_t vec) {
+    vec4a_t res;
+#if M_SIMD_VECTOR_TYPES
+    __m128 c0 = mat->r[0].v;
+    __m128 c1 = mat->r[1].v;
+    __m128 c2 = mat->r[2].v;
+    __m128 c3 = mat->r[3].v;
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    const __m128 v = vec.v;
+    __m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), c1));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xAA), c2));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xFF), c3));
+    res.v = r;
+#else
+    for (unsigned char i = 0; i < 4; i++) {
+        res.v[i] = M_Dot4a(mat->r[i], vec);
+    }
+#endif
+    return res;
+}
+
+/**
+ * @brief Multiply two register matrices together
+ * @param a The first mat
+ * @param b The second mat
+ * @return The multiplied mat
+ */
+static inline mat4a_t
+M_MultiplyMat4a(const mat4a_t* a, const mat4a_t* b) {
+    mat4a_t res;
+#if M_SIMD_VECTOR_TYPES
+    for (unsigned char i = 0; i < 4; i++) {
+        const __m128 ai = a->r[i].v;
+        __m128 row = _mm_mul_ps(_mm_shuffle_ps(ai, ai, 0x00), b->r[0].v);
+        row = _mm_add_ps(row,
+            _mm_mul_ps(_mm_shuffle_ps(ai, ai, 0x55), b->r[1].v));
+        row = _mm_add_ps(row,
+            _mm_mul_ps(_mm_shuffle_ps(ai, ai, 0xAA), b->r[2].v));
+        row = _mm_add_ps(row,
+            _mm_mul_ps(_mm_shuffle_ps(ai, ai, 0xFF), b->r[3].v));
+        res.r[i].v = row;
+    }
+#else
+    for (unsigned char i = 0; i < 4; i++) {
+        for (unsigned char j = 0; j < 4; j++) {
+            res.r[i].v[j] = 0.0f;
+            for (unsigned char k = 0; k < 4; k++) {
+                res.r[i].v[j] += a->r[i].v[k] * b->r[k].v[j];
+            }
+        }
+    }
+#endif
+    return res;
+}
+
 #ifndef VEC_IMPL_H_
 
 vec_t
@@ -378,7 +1094,7 @@ M_SumOfSquares(const vec_t* a) {
 }
 
 mat4_t
-M_MultiplyMat4(const mat4_t* a, const mat4_t* b) {
+M_MultiplyMat4Scalar(const mat4_t* a, const mat4_t* b) {
     mat4_t res = (mat4_t) {
         .m = { { 0 } }
     };
@@ -448,29 +1164,635 @@ M_Mat3Identity(void) {
     };
 }
 
-void 
-Vec4_MultiplyMatrix(vec4_t* vec, const mat4_t* mat) {
+vec4_t
+M_MultiplyMat4Vec4Scalar(const mat4_t* mat, const vec4_t* vec) {
     float x = vec->x;
     float y = vec->y;
     float z = vec->z;
     float w = vec->w;
 
-    vec->x = mat->m[0][0] * x 
-        + mat->m[0][1] * y 
-        + mat->m[0][2] * z 
-        + mat->m[0][3] * w;
-    vec->y = mat->m[1][0] * x 
-        + mat->m[1][1] * y 
-        + mat->m[1][2] * z 
-        + mat->m[1][3] * w;
-    vec->z = mat->m[2][0] * x 
-        + mat->m[2][1] * y 
-        + mat->m[2][2] * z 
-        + mat->m[2][3] * w;
-    vec->w = mat->m[3][0] * x 
-        + mat->m[3][1] * y 
-        + mat->m[3][2] * z 
-        + mat->m[3][3] * w;
+    return (vec4_t) {
+        .x = mat->m[0][0] * x 
+            + mat->m[0][1] * y 
+            + mat->m[0][2] * z 
+            + mat->m[0][3] * w,
+        .y = mat->m[1][0] * x 
+            + mat->m[1][1] * y 
+            + mat->m[1][2] * z 
+            + mat->m[1][3] * w,
+        .z = mat->m[2][0] * x 
+            + mat->m[2][1] * y 
+            + mat->m[2][2] * z 
+            + mat->m[2][3] * w,
+        .w = mat->m[3][0] * x 
+            + mat->m[3][1] * y 
+            + mat->m[3][2] * z 
+            + mat->m[3][3] * w
+    };
+}
+
+#if M_SIMD_X86
+
+/*
+ * Row-major kernels: row i of (a * b) is sum_k a[i][k] * row_k(b), so each
+ * output row is four broadcast-multiply-adds against the rows of b. mat4_t
+ * has no alignment guarantee, so every load is unaligned.
+ */
+
+__attribute__((target("sse2")))
+static mat4_t
+M_MultiplyMat4SSE2(const mat4_t* a, const mat4_t* b) {
+    mat4_t res;
+    const __m128 b0 = _mm_loadu_ps(b->m[0]);
+    const __m128 b1 = _mm_loadu_ps(b->m[1]);
+    const __m128 b2 = _mm_loadu_ps(b->m[2]);
+    const __m128 b3 = _mm_loadu_ps(b->m[3]);
+
+    for (unsigned char i = 0; i < 4; i++) {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a->m[i][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[i][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[i][2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[i][3]), b3));
+        _mm_storeu_ps(res.m[i], row);
+    }
+
+    return res;
+}
+
+// two output rows per 256-bit register: low lane is row i, high lane row i+1
+__attribute__((target("avx")))
+static mat4_t
+M_MultiplyMat4AVX(const mat4_t* a, const mat4_t* b) {
+    mat4_t res;
+    const __m256 b0 = _mm256_broadcast_ps((const __m128*) b->m[0]);
+    const __m256 b1 = _mm256_broadcast_ps((const __m128*) b->m[1]);
+    const __m256 b2 = _mm256_broadcast_ps((const __m128*) b->m[2]);
+    const __m256 b3 = _mm256_broadcast_ps((const __m128*) b->m[3]);
+
+    for (unsigned char i = 0; i < 4; i += 2) {
+        const __m256 ai = _mm256_loadu_ps(a->m[i]);
+        __m256 rows = _mm256_mul_ps(_mm256_permute_ps(ai, 0x00), b0);
+        rows = _mm256_add_ps(rows,
+            _mm256_mul_ps(_mm256_permute_ps(ai, 0x55), b1));
+        rows = _mm256_add_ps(rows,
+            _mm256_mul_ps(_mm256_permute_ps(ai, 0xAA), b2));
+        rows = _mm256_add_ps(rows,
+            _mm256_mul_ps(_mm256_permute_ps(ai, 0xFF), b3));
+        _mm256_storeu_ps(res.m[i], rows);
+    }
+
+    return res;
+}
+
+__attribute__((target("avx,fma")))
+static mat4_t
+M_MultiplyMat4FMA(const mat4_t* a, const mat4_t* b) {
+    mat4_t res;
+    const __m256 b0 = _mm256_broadcast_ps((const __m128*) b->m[0]);
+    const __m256 b1 = _mm256_broadcast_ps((const __m128*) b->m[1]);
+    const __m256 b2 = _mm256_broadcast_ps((const __m128*) b->m[2]);
+    const __m256 b3 = _mm256_broadcast_ps((const __m128*) b->m[3]);
+
+    for (unsigned char i = 0; i < 4; i += 2) {
+        const __m256 ai = _mm256_loadu_ps(a->m[i]);
+        __m256 rows = _mm256_mul_ps(_mm256_permute_ps(ai, 0x00), b0);
+        rows = _mm256_fmadd_ps(_mm256_permute_ps(ai, 0x55), b1, rows);
+        rows = _mm256_fmadd_ps(_mm256_permute_ps(ai, 0xAA), b2, rows);
+        rows = _mm256_fmadd_ps(_mm256_permute_ps(ai, 0xFF), b3, rows);
+        _mm256_storeu_ps(res.m[i], rows);
+    }
+
+    return res;
+}
+
+/*
+ * mat * vec is four row dot products. Transposing the rows into columns turns
+ * that into x*c0 + y*c1 + z*c2 + w*c3 with no horizontal adds.
+ */
+
+__attribute__((target("sse2")))
+static vec4_t
+M_MultiplyMat4Vec4SSE2(const mat4_t* mat, const vec4_t* vec) {
+    vec4_t res;
+    __m128 c0 = _mm_loadu_ps(mat->m[0]);
+    __m128 c1 = _mm_loadu_ps(mat->m[1]);
+    __m128 c2 = _mm_loadu_ps(mat->m[2]);
+    __m128 c3 = _mm_loadu_ps(mat->m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    __m128 col = _mm_mul_ps(_mm_set1_ps(vec->x), c0);
+    col = _mm_add_ps(col, _mm_mul_ps(_mm_set1_ps(vec->y), c1));
+    col = _mm_add_ps(col, _mm_mul_ps(_mm_set1_ps(vec->z), c2));
+    col = _mm_add_ps(col, _mm_mul_ps(_mm_set1_ps(vec->w), c3));
+    _mm_storeu_ps(&res.x, col);
+
+    return res;
+}
+
+// rows 0/1 and 2/3 are multiplied in one go, then reduced with two hadds
+__attribute__((target("avx")))
+static vec4_t
+M_MultiplyMat4Vec4AVX(const mat4_t* mat, const vec4_t* vec) {
+    vec4_t res;
+    const __m256 v = _mm256_broadcast_ps((const __m128*) &vec->x);
+    const __m256 p01 = _mm256_mul_ps(_mm256_loadu_ps(mat->m[0]), v);
+    const __m256 p23 = _mm256_mul_ps(_mm256_loadu_ps(mat->m[2]), v);
+
+    // low lane: r0 r2 r0 r2, high lane: r1 r3 r1 r3
+    __m256 sums = _mm256_hadd_ps(p01, p23);
+    sums = _mm256_hadd_ps(sums, sums);
+
+    const __m128 lo = _mm256_castps256_ps128(sums);
+    const __m128 hi = _mm256_extractf128_ps(sums, 1);
+    _mm_storeu_ps(&res.x, _mm_unpacklo_ps(lo, hi));
+
+    return res;
+}
+
+__attribute__((target("avx,fma")))
+static vec4_t
+M_MultiplyMat4Vec4FMA(const mat4_t* mat, const vec4_t* vec) {
+    vec4_t res;
+    __m128 c0 = _mm_loadu_ps(mat->m[0]);
+    __m128 c1 = _mm_loadu_ps(mat->m[1]);
+    __m128 c2 = _mm_loadu_ps(mat->m[2]);
+    __m128 c3 = _mm_loadu_ps(mat->m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    __m128 col = _mm_mul_ps(_mm_set1_ps(vec->x), c0);
+    col = _mm_fmadd_ps(_mm_set1_ps(vec->y), c1, col);
+    col = _mm_fmadd_ps(_mm_set1_ps(vec->z), c2, col);
+    col = _mm_fmadd_ps(_mm_set1_ps(vec->w), c3, col);
+    _mm_storeu_ps(&res.x, col);
+
+    return res;
+}
+
+/* Query cpuid leaf 1 and XCR0 for the highest usable level. */
+static MathSimdLevel
+M_DetectSimdLevel(void) {
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return M_SIMD_SCALAR;
+    }
+
+    MathSimdLevel level = M_SIMD_SCALAR;
+    if (edx & bit_SSE2) {
+        level = M_SIMD_SSE2;
+    }
+
+    // AVX also needs the OS to save the ymm registers on context switch
+    if ((ecx & bit_AVX) && (ecx & bit_OSXSAVE)) {
+        unsigned int xcr0_lo = 0, xcr0_hi = 0;
+        __asm__ __volatile__ (
+            "xgetbv" : "=a" (xcr0_lo), "=d" (xcr0_hi) : "c" (0));
+        if ((xcr0_lo & 0x6) == 0x6) {
+            level = (ecx & bit_FMA) ? M_SIMD_FMA : M_SIMD_AVX;
+        }
+    }
+
+    return level;
+}
+
+#endif // M_SIMD_X86
+
+static MathSimdLevel m_simd_level = M_SIMD_SCALAR;
+
+static mat4_t (*m_multiply_mat4)(const mat4_t*, const mat4_t*)
+    = M_MultiplyMat4Scalar;
+
+static vec4_t (*m_multiply_mat4_vec4)(const mat4_t*, const vec4_t*)
+    = M_MultiplyMat4Vec4Scalar;
+
+MathSimdLevel
+M_SetSimdLevel(MathSimdLevel level) {
+#if M_SIMD_X86
+    MathSimdLevel supported = M_DetectSimdLevel();
+    if (level > supported) {
+        level = supported;
+    }
+#else
+    level = M_SIMD_SCALAR;
+#endif
+
+    switch (level) {
+#if M_SIMD_X86
+        case M_SIMD_FMA:
+            m_multiply_mat4 = M_MultiplyMat4FMA;
+            m_multiply_mat4_vec4 = M_MultiplyMat4Vec4FMA;
+            break;
+        case M_SIMD_AVX:
+            m_multiply_mat4 = M_MultiplyMat4AVX;
+            m_multiply_mat4_vec4 = M_MultiplyMat4Vec4AVX;
+            break;
+        case M_SIMD_SSE2:
+            m_multiply_mat4 = M_MultiplyMat4SSE2;
+            m_multiply_mat4_vec4 = M_MultiplyMat4Vec4SSE2;
+            break;
+#endif
+        default:
+            level = M_SIMD_SCALAR;
+            m_multiply_mat4 = M_MultiplyMat4Scalar;
+            m_multiply_mat4_vec4 = M_MultiplyMat4Vec4Scalar;
+            break;
+    }
+
+    m_simd_level = level;
+    return level;
+}
+
+MathSimdLevel
+M_InitSimd(void) {
+    return M_SetSimdLevel(M_SIMD_FMA);
+}
+
+MathSimdLevel
+M_GetSimdLevel(void) {
+    return m_simd_level;
+}
+
+mat4_t
+M_MultiplyMat4(const mat4_t* a, const mat4_t* b) {
+    return m_multiply_mat4(a, b);
+}
+
+vec4_t
+M_MultiplyMat4Vec4(const mat4_t* mat, const vec4_t* vec) {
+    return m_multiply_mat4_vec4(mat, vec);
+}
+
+void 
+Vec4_MultiplyMatrix(vec4_t* vec, const mat4_t* mat) {
+    *vec = M_MultiplyMat4Vec4(mat, vec);
+}
+
+#if M_SIMD_X86
+
+/*
+ * Batch kernels. Each loop handles full SIMD blocks and leaves the remainder
+ * to the scalar code after it, so count does not need to be a multiple of
+ * the vector width.
+ */
+
+__attribute__((target("sse2")))
+static size_t
+M_TransformVec4BatchSSE2(
+    const mat4_t* mat, const vec4_t* in, vec4_t* out, size_t count) {
+    __m128 c0 = _mm_loadu_ps(mat->m[0]);
+    __m128 c1 = _mm_loadu_ps(mat->m[1]);
+    __m128 c2 = _mm_loadu_ps(mat->m[2]);
+    __m128 c3 = _mm_loadu_ps(mat->m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    for (size_t i = 0; i < count; i++) {
+        const __m128 v = _mm_loadu_ps(&in[i].x);
+        __m128 r = _mm_mul_ps(_mm_shuffle_ps(v, v, 0x00), c0);
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0x55), c1));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xAA), c2));
+        r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(v, v, 0xFF), c3));
+        _mm_storeu_ps(&out[i].x, r);
+    }
+
+    return count;
+}
+
+// two vec4s per 256-bit register, columns duplicated into both lanes
+__attribute__((target("avx")))
+static size_t
+M_TransformVec4BatchAVX(
+    const mat4_t* mat, const vec4_t* in, vec4_t* out, size_t count) {
+    __m128 c0 = _mm_loadu_ps(mat->m[0]);
+    __m128 c1 = _mm_loadu_ps(mat->m[1]);
+    __m128 c2 = _mm_loadu_ps(mat->m[2]);
+    __m128 c3 = _mm_loadu_ps(mat->m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    const __m256 C0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c0), c0, 1);
+    const __m256 C1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c1), c1, 1);
+    const __m256 C2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c2), c2, 1);
+    const __m256 C3 = _mm256_insertf128_ps(_mm256_castps128_ps256(c3), c3, 1);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m256 v = _mm256_loadu_ps(&in[i].x);
+        __m256 r = _mm256_mul_ps(_mm256_permute_ps(v, 0x00), C0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0x55), C1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0xAA), C2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_permute_ps(v, 0xFF), C3));
+        _mm256_storeu_ps(&out[i].x, r);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx,fma")))
+static size_t
+M_TransformVec4BatchFMA(
+    const mat4_t* mat, const vec4_t* in, vec4_t* out, size_t count) {
+    __m128 c0 = _mm_loadu_ps(mat->m[0]);
+    __m128 c1 = _mm_loadu_ps(mat->m[1]);
+    __m128 c2 = _mm_loadu_ps(mat->m[2]);
+    __m128 c3 = _mm_loadu_ps(mat->m[3]);
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+    const __m256 C0 = _mm256_insertf128_ps(_mm256_castps128_ps256(c0), c0, 1);
+    const __m256 C1 = _mm256_insertf128_ps(_mm256_castps128_ps256(c1), c1, 1);
+    const __m256 C2 = _mm256_insertf128_ps(_mm256_castps128_ps256(c2), c2, 1);
+    const __m256 C3 = _mm256_insertf128_ps(_mm256_castps128_ps256(c3), c3, 1);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m256 v = _mm256_loadu_ps(&in[i].x);
+        __m256 r = _mm256_mul_ps(_mm256_permute_ps(v, 0x00), C0);
+        r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0x55), C1, r);
+        r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0xAA), C2, r);
+        r = _mm256_fmadd_ps(_mm256_permute_ps(v, 0xFF), C3, r);
+        _mm256_storeu_ps(&out[i].x, r);
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_TransformPointsSoASSE2(
+    const mat4_t* mat,
+    const float* x, const float* y, const float* z,
+    float* out_x, float* out_y, float* out_z, float* out_w,
+    size_t count) {
+    __m128 m[4][4];
+    for (unsigned char r = 0; r < 4; r++) {
+        for (unsigned char c = 0; c < 4; c++) {
+            m[r][c] = _mm_set1_ps(mat->m[r][c]);
+        }
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 px = _mm_loadu_ps(x + i);
+        const __m128 py = _mm_loadu_ps(y + i);
+        const __m128 pz = _mm_loadu_ps(z + i);
+        __m128 res[4];
+        for (unsigned char r = 0; r < 4; r++) {
+            res[r] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(m[r][0], px), _mm_mul_ps(m[r][1], py)),
+                _mm_add_ps(_mm_mul_ps(m[r][2], pz), m[r][3]));
+        }
+        _mm_storeu_ps(out_x + i, res[0]);
+        _mm_storeu_ps(out_y + i, res[1]);
+        _mm_storeu_ps(out_z + i, res[2]);
+        if (out_w) {
+            _mm_storeu_ps(out_w + i, res[3]);
+        }
+    }
+
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+M_TransformPointsSoAAVX(
+    const mat4_t* mat,
+    const float* x, const float* y, const float* z,
+    float* out_x, float* out_y, float* out_z, float* out_w,
+    size_t count) {
+    __m256 m[4][4];
+    for (unsigned char r = 0; r < 4; r++) {
+        for (unsigned char c = 0; c < 4; c++) {
+            m[r][c] = _mm256_set1_ps(mat->m[r][c]);
+        }
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 px = _mm256_loadu_ps(x + i);
+        const __m256 py = _mm256_loadu_ps(y + i);
+        const __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 res[4];
+        for (unsigned char r = 0; r < 4; r++) {
+            res[r] = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(m[r][0], px), _mm256_mul_ps(m[r][1], py)),
+                _mm256_add_ps(_mm256_mul_ps(m[r][2], pz), m[r][3]));
+        }
+        _mm256_storeu_ps(out_x + i, res[0]);
+        _mm256_storeu_ps(out_y + i, res[1]);
+        _mm256_storeu_ps(out_z + i, res[2]);
+        if (out_w) {
+            _mm256_storeu_ps(out_w + i, res[3]);
+        }
+    }
+
+    return i;
+}
+
+__attribute__((target("avx,fma")))
+static size_t
+M_TransformPointsSoAFMA(
+    const mat4_t* mat,
+    const float* x, const float* y, const float* z,
+    float* out_x, float* out_y, float* out_z, float* out_w,
+    size_t count) {
+    __m256 m[4][4];
+    for (unsigned char r = 0; r < 4; r++) {
+        for (unsigned char c = 0; c < 4; c++) {
+            m[r][c] = _mm256_set1_ps(mat->m[r][c]);
+        }
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 px = _mm256_loadu_ps(x + i);
+        const __m256 py = _mm256_loadu_ps(y + i);
+        const __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 res[4];
+        for (unsigned char r = 0; r < 4; r++) {
+            res[r] = _mm256_fmadd_ps(m[r][0], px,
+                _mm256_fmadd_ps(m[r][1], py,
+                    _mm256_fmadd_ps(m[r][2], pz, m[r][3])));
+        }
+        _mm256_storeu_ps(out_x + i, res[0]);
+        _mm256_storeu_ps(out_y + i, res[1]);
+        _mm256_storeu_ps(out_z + i, res[2]);
+        if (out_w) {
+            _mm256_storeu_ps(out_w + i, res[3]);
+        }
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_NormalizeVecBatchSSE2(vec_t* vecs, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        M_LoadVec3x4(&vecs[i], &x, &y, &z);
+        const __m128 len = _mm_sqrt_ps(_mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)),
+            _mm_mul_ps(z, z)));
+        M_StoreVec3x4(&vecs[i],
+            _mm_div_ps(x, len), _mm_div_ps(y, len), _mm_div_ps(z, len));
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_DotBatchSSE2(const vec_t* a, const vec_t* b, float* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 ax, ay, az, bx, by, bz;
+        M_LoadVec3x4(&a[i], &ax, &ay, &az);
+        M_LoadVec3x4(&b[i], &bx, &by, &bz);
+        _mm_storeu_ps(out + i, _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+            _mm_mul_ps(az, bz)));
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+M_CrossBatchSSE2(const vec_t* a, const vec_t* b, vec_t* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 ax, ay, az, bx, by, bz;
+        M_LoadVec3x4(&a[i], &ax, &ay, &az);
+        M_LoadVec3x4(&b[i], &bx, &by, &bz);
+        M_StoreVec3x4(&out[i],
+            _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(by, az)),
+            _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(bz, ax)),
+            _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(bx, ay)));
+    }
+
+    return i;
+}
+
+#endif // M_SIMD_X86
+
+void
+M_TransformVec4Batch(
+    const mat4_t* mat,
+    const vec4_t* in,
+    vec4_t* out,
+    size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    switch (m_simd_level) {
+        case M_SIMD_FMA:
+            i = M_TransformVec4BatchFMA(mat, in, out, count);
+            break;
+        case M_SIMD_AVX:
+            i = M_TransformVec4BatchAVX(mat, in, out, count);
+            break;
+        case M_SIMD_SSE2:
+            i = M_TransformVec4BatchSSE2(mat, in, out, count);
+            break;
+        default:
+            break;
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = M_MultiplyMat4Vec4Scalar(mat, &in[i]);
+    }
+}
+
+void
+M_TransformPointsSoA(
+    const mat4_t* mat,
+    const float* x,
+    const float* y,
+    const float* z,
+    float* out_x,
+    float* out_y,
+    float* out_z,
+    float* out_w,
+    size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    switch (m_simd_level) {
+        case M_SIMD_FMA:
+            i = M_TransformPointsSoAFMA(
+                mat, x, y, z, out_x, out_y, out_z, out_w, count);
+            break;
+        case M_SIMD_AVX:
+            i = M_TransformPointsSoAAVX(
+                mat, x, y, z, out_x, out_y, out_z, out_w, count);
+            break;
+        case M_SIMD_SSE2:
+            i = M_TransformPointsSoASSE2(
+                mat, x, y, z, out_x, out_y, out_z, out_w, count);
+            break;
+        default:
+            break;
+    }
+#endif
+
+    for (; i < count; i++) {
+        const float px = x[i];
+        const float py = y[i];
+        const float pz = z[i];
+        out_x[i] = mat->m[0][0] * px + mat->m[0][1] * py
+            + mat->m[0][2] * pz + mat->m[0][3];
+        out_y[i] = mat->m[1][0] * px + mat->m[1][1] * py
+            + mat->m[1][2] * pz + mat->m[1][3];
+        out_z[i] = mat->m[2][0] * px + mat->m[2][1] * py
+            + mat->m[2][2] * pz + mat->m[2][3];
+        if (out_w) {
+            out_w[i] = mat->m[3][0] * px + mat->m[3][1] * py
+                + mat->m[3][2] * pz + mat->m[3][3];
+        }
+    }
+}
+
+void
+M_NormalizeVecBatch(vec_t* vecs, size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    if (m_simd_level >= M_SIMD_SSE2) {
+        i = M_NormalizeVecBatchSSE2(vecs, count);
+    }
+#endif
+
+    for (; i < count; i++) {
+        M_NormalizeVec(&vecs[i]);
+    }
+}
+
+void
+M_DotBatch(const vec_t* a, const vec_t* b, float* out, size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    if (m_simd_level >= M_SIMD_SSE2) {
+        i = M_DotBatchSSE2(a, b, out, count);
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = M_Dot(&a[i], &b[i]);
+    }
+}
+
+void
+M_CrossBatch(const vec_t* a, const vec_t* b, vec_t* out, size_t count) {
+    size_t i = 0;
+
+#if M_SIMD_X86
+    if (m_simd_level >= M_SIMD_SSE2) {
+        i = M_CrossBatchSSE2(a, b, out, count);
+    }
+#endif
+
+    for (; i < count; i++) {
+        out[i] = M_Cross(&a[i], &b[i]);
+    }
 }
 
 
@@ -579,7 +1901,7 @@ Mat4_LookAt(vec_t eye, vec_t target, vec_t up) {
     res.m[1][0] = upNew.x;
     res.m[1][1] = upNew.y;
     res.m[1][2] = upNew.z;
-    res.m[1][3] = -M_Dot(&up, &eye);
+    res.m[1][3] = -M_Dot(&upNew, &eye);
 
     res.m[2][0] = forward.x;
     res.m[2][1] = forward.y;
@@ -604,7 +1926,358 @@ mat4_t Mat4_Transpose(mat4_t mat) {
     return result;
 }
 
+int
+Mat4_Inverse(const mat4_t* mat, mat4_t* out) {
+    const float (*a)[4] = mat->m;
+
+    // 2x2 determinants of the top two rows (s) and bottom two rows (c)
+    const float s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+    const float s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+    const float s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+    const float s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+    const float s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+    const float s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+    const float c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+    const float c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+    const float c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+    const float c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+    const float c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+    const float c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+    const float det = s0 * c5 - s1 * c4 + s2 * c3 
+        + s3 * c2 - s4 * c1 + s5 * c0;
+    if (det == 0.0f) {
+        return 0;
+    }
+    const float inv = 1.0f / det;
+
+    mat4_t res;
+    res.m[0][0] = ( a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) * inv;
+    res.m[0][1] = (-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) * inv;
+    res.m[0][2] = ( a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) * inv;
+    res.m[0][3] = (-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) * inv;
+
+    res.m[1][0] = (-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) * inv;
+    res.m[1][1] = ( a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) * inv;
+    res.m[1][2] = (-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) * inv;
+    res.m[1][3] = ( a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) * inv;
+
+    res.m[2][0] = ( a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) * inv;
+    res.m[2][1] = (-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) * inv;
+    res.m[2][2] = ( a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) * inv;
+    res.m[2][3] = (-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) * inv;
+
+    res.m[3][0] = (-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) * inv;
+    res.m[3][1] = ( a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) * inv;
+    res.m[3][2] = (-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) * inv;
+    res.m[3][3] = ( a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) * inv;
+
+    *out = res;
+    return 1;
+}
+
+/* Cofactor matrix of the upper 3x3, returns its determinant. */
+static float
+M_Cofactor3(const mat4_t* mat, float cof[3][3]) {
+    const float (*a)[4] = mat->m;
+
+    cof[0][0] = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+    cof[0][1] = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+    cof[0][2] = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+
+    cof[1][0] = a[0][2] * a[2][1] - a[0][1] * a[2][2];
+    cof[1][1] = a[0][0] * a[2][2] - a[0][2] * a[2][0];
+    cof[1][2] = a[0][1] * a[2][0] - a[0][0] * a[2][1];
+
+    cof[2][0] = a[0][1] * a[1][2] - a[0][2] * a[1][1];
+    cof[2][1] = a[0][2] * a[1][0] - a[0][0] * a[1][2];
+    cof[2][2] = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+
+    return a[0][0] * cof[0][0] + a[0][1] * cof[0][1] + a[0][2] * cof[0][2];
+}
+
+int
+Mat4_InverseAffine(const mat4_t* mat, mat4_t* out) {
+    float cof[3][3];
+    const float det = M_Cofactor3(mat, cof);
+    if (det == 0.0f) {
+        return 0;
+    }
+    const float inv = 1.0f / det;
+
+    // inverse of the 3x3 is the transposed cofactor matrix over det
+    mat4_t res = M_Mat4Identity();
+    for (unsigned char i = 0; i < 3; i++) {
+        for (unsigned char j = 0; j < 3; j++) {
+            res.m[i][j] = cof[j][i] * inv;
+        }
+    }
+
+    // translation is -inv(M) * t
+    for (unsigned char i = 0; i < 3; i++) {
+        res.m[i][3] = -(res.m[i][0] * mat->m[0][3]
+            + res.m[i][1] * mat->m[1][3]
+            + res.m[i][2] * mat->m[2][3]);
+    }
+
+    *out = res;
+    return 1;
+}
+
+mat4_t
+Mat4_InverseRigid(const mat4_t* mat) {
+    mat4_t res = M_Mat4Identity();
+
+    // the inverse of a rotation is its transpose
+    for (unsigned char i = 0; i < 3; i++) {
+        for (unsigned char j = 0; j < 3; j++) {
+            res.m[i][j] = mat->m[j][i];
+        }
+    }
+
+    for (unsigned char i = 0; i < 3; i++) {
+        res.m[i][3] = -(res.m[i][0] * mat->m[0][3]
+            + res.m[i][1] * mat->m[1][3]
+            + res.m[i][2] * mat->m[2][3]);
+    }
+
+    return res;
+}
 
+#if M_SIMD_X86
+// rows 0-2 only: three broadcast-multiply-adds plus a's translation column
+__attribute__((target("sse2")))
+static mat4_t
+M_MultiplyMat4AffineSSE2(const mat4_t* a, const mat4_t* b) {
+    mat4_t res;
+    const __m128 b0 = _mm_loadu_ps(b->m[0]);
+    const __m128 b1 = _mm_loadu_ps(b->m[1]);
+    const __m128 b2 = _mm_loadu_ps(b->m[2]);
+    const __m128 w = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+
+    for (unsigned char i = 0; i < 3; i++) {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a->m[i][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[i][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[i][2]), b2));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a->m[i][3]), w));
+        _mm_storeu_ps(res.m[i], row);
+    }
+    _mm_storeu_ps(res.m[3], w);
+
+    return res;
+}
+
+// rows 0/1 share a 256-bit register as in M_MultiplyMat4AVX and row 2 uses
+// the low lane alone; a's translation column is blended in, not multiplied
+__attribute__((target("avx")))
+static mat4_t
+M_MultiplyMat4AffineAVX(const mat4_t* a, const mat4_t* b) {
+    mat4_t res;
+    const __m256 b0 = _mm256_broadcast_ps((const __m128*) b->m[0]);
+    const __m256 b1 = _mm256_broadcast_ps((const __m128*) b->m[1]);
+    const __m256 b2 = _mm256_broadcast_ps((const __m128*) b->m[2]);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256 a01 = _mm256_loadu_ps(a->m[0]);
+    __m256 rows = _mm256_mul_ps(_mm256_permute_ps(a01, 0x00), b0);
+    rows = _mm256_add_ps(rows,
+        _mm256_mul_ps(_mm256_permute_ps(a01, 0x55), b1));
+    rows = _mm256_add_ps(rows,
+        _mm256_mul_ps(_mm256_permute_ps(a01, 0xAA), b2));
+    rows = _mm256_add_ps(rows,
+        _mm256_blend_ps(zero, _mm256_permute_ps(a01, 0xFF), 0x88));
+    _mm256_storeu_ps(res.m[0], rows);
+
+    const __m128 a2 = _mm_loadu_ps(a->m[2]);
+    __m128 row = _mm_mul_ps(
+        _mm_permute_ps(a2, 0x00), _mm256_castps256_ps128(b0));
+    row = _mm_add_ps(row, _mm_mul_ps(
+        _mm_permute_ps(a2, 0x55), _mm256_castps256_ps128(b1)));
+    row = _mm_add_ps(row, _mm_mul_ps(
+        _mm_permute_ps(a2, 0xAA), _mm256_castps256_ps128(b2)));
+    row = _mm_add_ps(row, _mm_blend_ps(
+        _mm256_castps256_ps128(zero), _mm_permute_ps(a2, 0xFF), 0x8));
+    _mm_storeu_ps(res.m[2], row);
+    _mm_storeu_ps(res.m[3], _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+
+    return res;
+}
+
+__attribute__((target("avx,fma")))
+static mat4_t
+M_MultiplyMat4AffineFMA(const mat4_t* a, const mat4_t* b) {
+    mat4_t res;
+    const __m256 b0 = _mm256_broadcast_ps((const __m128*) b->m[0]);
+    const __m256 b1 = _mm256_broadcast_ps((const __m128*) b->m[1]);
+    const __m256 b2 = _mm256_broadcast_ps((const __m128*) b->m[2]);
+    const __m256 zero = _mm256_setzero_ps();
+
+    const __m256 a01 = _mm256_loadu_ps(a->m[0]);
+    __m256 rows = _mm256_blend_ps(zero, _mm256_permute_ps(a01, 0xFF), 0x88);
+    rows = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0x00), b0, rows);
+    rows = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0x55), b1, rows);
+    rows = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0xAA), b2, rows);
+    _mm256_storeu_ps(res.m[0], rows);
+
+    const __m128 a2 = _mm_loadu_ps(a->m[2]);
+    __m128 row = _mm_blend_ps(
+        _mm256_castps256_ps128(zero), _mm_permute_ps(a2, 0xFF), 0x8);
+    row = _mm_fmadd_ps(
+        _mm_permute_ps(a2, 0x00), _mm256_castps256_ps128(b0), row);
+    row = _mm_fmadd_ps(
+        _mm_permute_ps(a2, 0x55), _mm256_castps256_ps128(b1), row);
+    row = _mm_fmadd_ps(
+        _mm_permute_ps(a2, 0xAA), _mm256_castps256_ps128(b2), row);
+    _mm_storeu_ps(res.m[2], row);
+    _mm_storeu_ps(res.m[3], _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f));
+
+    return res;
+}
+#endif
+
+mat4_t
+M_MultiplyMat4Affine(const mat4_t* a, const mat4_t* b) {
+#if M_SIMD_X86
+    switch (m_simd_level) {
+        case M_SIMD_FMA:
+            return M_MultiplyMat4AffineFMA(a, b);
+        case M_SIMD_AVX:
+            return M_MultiplyMat4AffineAVX(a, b);
+        case M_SIMD_SSE2:
+            return M_MultiplyMat4AffineSSE2(a, b);
+        default:
+            break;
+    }
+#endif
+
+    mat4_t res = M_Mat4Identity();
+    for (unsigned char i = 0; i < 3; i++) {
+        for (unsigned char j = 0; j < 4; j++) {
+            res.m[i][j] = a->m[i][0] * b->m[0][j]
+                + a->m[i][1] * b->m[1][j]
+                + a->m[i][2] * b->m[2][j];
+        }
+        res.m[i][3] += a->m[i][3];
+    }
+
+    return res;
+}
+
+mat3_t
+Mat4_NormalMatrix(const mat4_t* mat) {
+    float cof[3][3];
+    const float det = M_Cofactor3(mat, cof);
+    if (det == 0.0f) {
+        return M_Mat3Identity();
+    }
+    const float inv = 1.0f / det;
+
+    // transpose(inverse(M)) = cofactor(M) / det
+    mat3_t res;
+    for (unsigned char i = 0; i < 3; i++) {
+        for (unsigned char j = 0; j < 3; j++) {
+            res.m[i][j] = cof[i][j] * inv;
+        }
+    }
+
+    return res;
+}
+
+aabb_t
+M_AABBEmpty(void) {
+    aabb_t res = {
+        .min = { FLT_MAX, FLT_MAX, FLT_MAX },
+        .max = { -FLT_MAX, -FLT_MAX, -FLT_MAX }
+    };
+    return res;
+}
+
+aabb_t
+M_AABBUnion(const aabb_t* a, const aabb_t* b) {
+    aabb_t res = {
+        .min = {
+            fminf(a->min.x, b->min.x),
+            fminf(a->min.y, b->min.y),
+            fminf(a->min.z, b->min.z)
+        },
+        .max = {
+            fmaxf(a->max.x, b->max.x),
+            fmaxf(a->max.y, b->max.y),
+            fmaxf(a->max.z, b->max.z)
+        }
+    };
+    return res;
+}
+
+void
+M_AABBExpand(aabb_t* box, const vec_t* p) {
+    box->min.x = fminf(box->min.x, p->x);
+    box->min.y = fminf(box->min.y, p->y);
+    box->min.z = fminf(box->min.z, p->z);
+    box->max.x = fmaxf(box->max.x, p->x);
+    box->max.y = fmaxf(box->max.y, p->y);
+    box->max.z = fmaxf(box->max.z, p->z);
+}
+
+vec_t
+M_AABBCenter(const aabb_t* box) {
+    vec_t res = {
+        .x = 0.5f * (box->min.x + box->max.x),
+        .y = 0.5f * (box->min.y + box->max.y),
+        .z = 0.5f * (box->min.z + box->max.z)
+    };
+    return res;
+}
+
+float
+M_AABBSurfaceArea(const aabb_t* box) {
+    const float dx = box->max.x - box->min.x;
+    const float dy = box->max.y - box->min.y;
+    const float dz = box->max.z - box->min.z;
+    if (dx < 0.0f || dy < 0.0f || dz < 0.0f) {
+        return 0.0f;
+    }
+
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+int
+M_AABBOverlap(const aabb_t* a, const aabb_t* b) {
+    return a->min.x <= b->max.x && a->max.x >= b->min.x
+        && a->min.y <= b->max.y && a->max.y >= b->min.y
+        && a->min.z <= b->max.z && a->max.z >= b->min.z;
+}
+
+int
+M_SphereOverlapAABB(const sphere_t* s, const aabb_t* box) {
+    // distance from the center to the closest point in the box
+    const float dx = s->center.x - fmaxf(box->min.x, 
+        fminf(s->center.x, box->max.x));
+    const float dy = s->center.y - fmaxf(box->min.y, 
+        fminf(s->center.y, box->max.y));
+    const float dz = s->center.z - fmaxf(box->min.z, 
+        fminf(s->center.z, box->max.z));
+
+    return dx * dx + dy * dy + dz * dz <= s->radius * s->radius;
+}
+
+aabb_t
+M_AABBFromSphere(const sphere_t* s) {
+    aabb_t res = {
+        .min = {
+            s->center.x - s->radius,
+            s->center.y - s->radius,
+            s->center.z - s->radius
+        },
+        .max = {
+            s->center.x + s->radius,
+            s->center.y + s->radius,
+            s->center.z + s->radius
+        }
+    };
+    return res;
+}
 
 #endif // VEC_IMPL_H_
 #endif // VEC_H_
\ No newline at end of file
@@ -0,0 +1,529 @@
+#include "c_memory.h"
+#include "c_log.h"
+#include "c_tlsf.h"
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* The allocator the tracker sits on: SDL's own, or the main heap. */
+static SDL_malloc_func real_malloc;
+static SDL_calloc_func real_calloc;
+static SDL_realloc_func real_realloc;
+static SDL_free_func real_free;
+
+#if CGAME_MEM_HEAP == CGAME_MEM_HEAP_TLSF
+
+static void* SDLCALL
+C_HeapMalloc(size_t size) {
+    return C_TlsfAlloc(C_MainHeap(), size, 0);
+}
+
+static void* SDLCALL
+C_HeapCalloc(size_t count, size_t size) {
+    return C_TlsfAllocArray(C_MainHeap(), count, size);
+}
+
+static void* SDLCALL
+C_HeapRealloc(void* ptr, size_t size) {
+    return C_TlsfRealloc(C_MainHeap(), ptr, size);
+}
+
+static void SDLCALL
+C_HeapFree(void* ptr) {
+    C_TlsfFree(C_MainHeap(), ptr);
+}
+
+#endif
+
+#if CGAME_MEM_TRACK
+
+/* In front of every tracked allocation; live ones are kept in a list. */
+typedef struct mem_header_t {
+    struct mem_header_t* prev;
+    struct mem_header_t* next;
+
+    /* Call site, NULL if the caller did not record one. */
+    const char* file;
+    const char* tag;
+
+    size_t size;
+
+    /* SDL_GetTicksNS when allocated. */
+    Uint64 time;
+
+    Uint32 line;
+    Uint32 frame;
+} mem_header_t;
+
+/* Keeps the memory after the header 16 byte aligned. */
+#define MEM_HEADER_SIZE ((sizeof(mem_header_t) + 15u) & ~(size_t) 15u)
+
+typedef struct {
+    const char* file;
+    Uint32 line;
+    size_t size;
+} mem_site_t;
+
+/* Set once the tracker sits behind SDL_malloc, after which the C_Malloc
+ * macros allocate tracked blocks directly. */
+static int installed;
+
+/* Site of the C_AlignedAlloc in progress on this thread, picked up by the
+ * one SDL_malloc call SDL_aligned_alloc makes. */
+static SDL_TLSID aligned_site;
+
+/* Everything below is guarded by lock. */
+static SDL_SpinLock lock;
+
+static mem_header_t* live;
+static mem_stats_t stats;
+
+static const char* tag;
+
+/* Frame in progress. */
+static Uint64 frame_allocs;
+static Uint64 frame_bytes;
+static mem_site_t frame_sites[CGAME_MEM_FRAME_SITES];
+static long frame_budget = CGAME_MEM_FRAME_BUDGET;
+
+/* Add a header to the live list. Lock held. */
+static void
+C_MemLink(mem_header_t* header) {
+    header->prev = NULL;
+    header->next = live;
+    if (live) {
+        live->prev = header;
+    }
+    live = header;
+
+    stats.live_count++;
+    stats.live_bytes += header->size;
+    if (stats.live_bytes > stats.peak_bytes) {
+        stats.peak_bytes = stats.live_bytes;
+    }
+}
+
+/* Remove a header from the live list. Lock held. */
+static void
+C_MemUnlink(mem_header_t* header) {
+    if (header->prev) {
+        header->prev->next = header->next;
+    } else {
+        live = header->next;
+    }
+    if (header->next) {
+        header->next->prev = header->prev;
+    }
+
+    stats.live_count--;
+    stats.live_bytes -= header->size;
+}
+
+/* Fill in a new header, link it in and count it. Lock held. */
+static void*
+C_MemTrack(mem_header_t* header, size_t size, const char* file, int line) {
+    header->size = size;
+    header->tag = tag;
+    header->time = SDL_GetTicksNS();
+    header->frame = (Uint32) stats.frames;
+    header->file = file;
+    header->line = (Uint32) line;
+
+    C_MemLink(header);
+    stats.allocs++;
+
+    if (frame_allocs < CGAME_MEM_FRAME_SITES) {
+        mem_site_t* s = &frame_sites[frame_allocs];
+        s->file = header->file;
+        s->line = header->line;
+        s->size = size;
+    }
+    frame_allocs++;
+    frame_bytes += size;
+
+    return (unsigned char*) header + MEM_HEADER_SIZE;
+}
+
+static mem_header_t*
+C_MemHeader(void* ptr) {
+    return (mem_header_t*) ((unsigned char*) ptr - MEM_HEADER_SIZE);
+}
+
+static void*
+C_MemMallocSite(size_t size, const char* file, int line) {
+    if (size > SIZE_MAX - MEM_HEADER_SIZE) {
+        return NULL;
+    }
+    mem_header_t* header = real_malloc(MEM_HEADER_SIZE + size);
+    if (!header) {
+        return NULL;
+    }
+
+    SDL_LockSpinlock(&lock);
+    void* ptr = C_MemTrack(header, size, file, line);
+    SDL_UnlockSpinlock(&lock);
+    return ptr;
+}
+
+static void*
+C_MemCallocSite(size_t count, size_t size, const char* file, int line) {
+    if (size && count > (SIZE_MAX - MEM_HEADER_SIZE) / size) {
+        return NULL;
+    }
+    // the header is zeroed too, which costs nothing next to the block
+    mem_header_t* header = real_calloc(1, MEM_HEADER_SIZE + count * size);
+    if (!header) {
+        return NULL;
+    }
+
+    SDL_LockSpinlock(&lock);
+    void* ptr = C_MemTrack(header, count * size, file, line);
+    SDL_UnlockSpinlock(&lock);
+    return ptr;
+}
+
+static void*
+C_MemReallocSite(void* ptr, size_t size, const char* file, int line) {
+    if (!ptr) {
+        return C_MemMallocSite(size, file, line);
+    }
+    if (size > SIZE_MAX - MEM_HEADER_SIZE) {
+        return NULL;
+    }
+
+    // the block may move, so it leaves the list while it is resized
+    mem_header_t* header = C_MemHeader(ptr);
+    SDL_LockSpinlock(&lock);
+    C_MemUnlink(header);
+    SDL_UnlockSpinlock(&lock);
+
+    mem_header_t* resized = real_realloc(header, MEM_HEADER_SIZE + size);
+
+    SDL_LockSpinlock(&lock);
+    void* out = NULL;
+    if (resized) {
+        stats.frees++;
+        out = C_MemTrack(resized, size, file, line);
+    } else {
+        // the old block is untouched and still live
+        C_MemLink(header);
+    }
+    SDL_UnlockSpinlock(&lock);
+
+    return out;
+}
+
+static void* SDLCALL
+C_MemMalloc(size_t size) {
+    // only a C_AlignedAlloc on this thread leaves a site here
+    mem_site_t* site = SDL_GetTLS(&aligned_site);
+    if (site && site->file) {
+        const char* file = site->file;
+        site->file = NULL;
+        return C_MemMallocSite(size, file, (int) site->line);
+    }
+    return C_MemMallocSite(size, NULL, 0);
+}
+
+static void* SDLCALL
+C_MemCalloc(size_t count, size_t size) {
+    return C_MemCallocSite(count, size, NULL, 0);
+}
+
+static void* SDLCALL
+C_MemRealloc(void* ptr, size_t size) {
+    return C_MemReallocSite(ptr, size, NULL, 0);
+}
+
+static void SDLCALL
+C_MemFree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    mem_header_t* header = C_MemHeader(ptr);
+    SDL_LockSpinlock(&lock);
+    C_MemUnlink(header);
+    stats.frees++;
+    SDL_UnlockSpinlock(&lock);
+
+    real_free(header);
+}
+
+#endif // CGAME_MEM_TRACK
+
+int
+C_MemInstall(void) {
+    SDL_GetOriginalMemoryFunctions(
+        &real_malloc,
+        &real_calloc,
+        &real_realloc,
+        &real_free);
+
+#if CGAME_MEM_HEAP == CGAME_MEM_HEAP_TLSF
+    if (!C_TlsfCreate(
+        C_MainHeap(),
+        CGAME_HEAP_INIT_SIZE,
+        CGAME_HEAP_GROW_SIZE)) {
+        return 0;
+    }
+    real_malloc = C_HeapMalloc;
+    real_calloc = C_HeapCalloc;
+    real_realloc = C_HeapRealloc;
+    real_free = C_HeapFree;
+#endif
+
+#if CGAME_MEM_TRACK
+    const bool set = SDL_SetMemoryFunctions(
+        C_MemMalloc,
+        C_MemCalloc,
+        C_MemRealloc,
+        C_MemFree);
+#else
+    const bool set = SDL_SetMemoryFunctions(
+        real_malloc,
+        real_calloc,
+        real_realloc,
+        real_free);
+#endif
+    if (!set) {
+        G_Log("ERROR", "Failed to install the engine allocator.");
+        G_Log("SDL ERROR", SDL_GetError());
+        return 0;
+    }
+
+#if CGAME_MEM_TRACK
+    installed = 1;
+#endif
+    return 1;
+}
+
+/* SDL_malloc and SDL_realloc hand out a byte for a size of 0, and so do
+ * these. Until the tracker is installed they go through SDL as they are. */
+
+void*
+C_MemMallocAt(const char* file, int line, size_t size) {
+#if CGAME_MEM_TRACK
+    if (installed) {
+        return C_MemMallocSite(size ? size : 1, file, line);
+    }
+#endif
+    (void) file;
+    (void) line;
+    return SDL_malloc(size);
+}
+
+void*
+C_MemCallocAt(const char* file, int line, size_t count, size_t size) {
+#if CGAME_MEM_TRACK
+    if (installed) {
+        return count && size
+            ? C_MemCallocSite(count, size, file, line)
+            : C_MemCallocSite(1, 1, file, line);
+    }
+#endif
+    (void) file;
+    (void) line;
+    return SDL_calloc(count, size);
+}
+
+void*
+C_MemReallocAt(const char* file, int line, void* ptr, size_t size) {
+#if CGAME_MEM_TRACK
+    if (installed) {
+        return C_MemReallocSite(ptr, size ? size : 1, file, line);
+    }
+#endif
+    (void) file;
+    (void) line;
+    return SDL_realloc(ptr, size);
+}
+
+void*
+C_MemAlignedAllocAt(const char* file, int line, size_t align, size_t size) {
+#if CGAME_MEM_TRACK
+    // SDL_aligned_alloc lays the block out itself, so the site is left for
+    // its SDL_malloc call, and cleared after whether or not it was used
+    mem_site_t site = { file, (Uint32) line, size };
+    const bool set = installed && SDL_SetTLS(&aligned_site, &site, NULL);
+    void* ptr = SDL_aligned_alloc(align, size);
+    if (set) {
+        SDL_SetTLS(&aligned_site, NULL, NULL);
+    }
+    return ptr;
+#else
+    (void) file;
+    (void) line;
+    return SDL_aligned_alloc(align, size);
+#endif
+}
+
+const char*
+C_MemSetTag(const char* new_tag) {
+#if CGAME_MEM_TRACK
+    SDL_LockSpinlock(&lock);
+    const char* old = tag;
+    tag = new_tag;
+    SDL_UnlockSpinlock(&lock);
+    return old;
+#else
+    (void) new_tag;
+    return NULL;
+#endif
+}
+
+void
+C_MemSetFrameBudget(long max_allocs) {
+#if CGAME_MEM_TRACK
+    SDL_LockSpinlock(&lock);
+    frame_budget = max_allocs;
+    SDL_UnlockSpinlock(&lock);
+#else
+    (void) max_allocs;
+#endif
+}
+
+int
+C_MemEndFrame(void) {
+#if CGAME_MEM_TRACK
+    SDL_LockSpinlock(&lock);
+    const Uint64 allocs = frame_allocs;
+    const Uint64 bytes = frame_bytes;
+    mem_site_t sites[CGAME_MEM_FRAME_SITES];
+    SDL_memcpy(sites, frame_sites, sizeof(sites));
+
+    const long budget = frame_budget;
+    const int over = budget >= 0
+        && stats.frames >= CGAME_MEM_WARMUP_FRAMES
+        && allocs > (Uint64) budget;
+
+    stats.frame_allocs = allocs;
+    stats.frame_bytes = bytes;
+    stats.frames++;
+    stats.frames_over_budget += over;
+    const Uint64 frame = stats.frames;
+    frame_allocs = 0;
+    frame_bytes = 0;
+    SDL_UnlockSpinlock(&lock);
+
+    if (!over) {
+        return 1;
+    }
+
+    char msg[256];
+    snprintf(msg, sizeof(msg),
+        "Frame %llu made %llu allocations (%llu bytes), budget is %ld.",
+        (unsigned long long) frame,
+        (unsigned long long) allocs,
+        (unsigned long long) bytes,
+        budget);
+    G_Log("ERROR", msg);
+
+    for (Uint64 i = 0; i < allocs && i < CGAME_MEM_FRAME_SITES; i++) {
+        snprintf(msg, sizeof(msg), "  %zu bytes from %s:%u",
+            sites[i].size,
+            sites[i].file ? sites[i].file : "an unmarked site",
+            (unsigned int) sites[i].line);
+        G_Log("ERROR", msg);
+    }
+
+#if CGAME_MEM_BUDGET_FATAL
+    SDL_assert_release(!"Frame allocation budget exceeded.");
+#endif
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+void
+C_MemGetStats(mem_stats_t* out) {
+#if CGAME_MEM_TRACK
+    SDL_LockSpinlock(&lock);
+    *out = stats;
+    SDL_UnlockSpinlock(&lock);
+#else
+    SDL_memset(out, 0, sizeof(*out));
+#endif
+}
+
+void
+C_MemReport(void) {
+#if CGAME_MEM_HEAP == CGAME_MEM_HEAP_TLSF
+    const tlsf_stats_t h = C_TlsfGetStats(C_MainHeap());
+    G_LogInfo("memory",
+        "Main heap: %zu of %zu bytes used in %zu regions, peak %zu, "
+        "%zu used and %zu free blocks, %zu allocs, %zu frees, %zu failed.",
+        h.used, h.capacity, h.regions, h.peak,
+        h.used_blocks, h.free_blocks, h.allocs, h.frees, h.failed);
+
+    if (!C_TlsfWalk(C_MainHeap(), NULL, NULL)) {
+        G_Log("ERROR", "Main heap is corrupt.");
+    }
+#endif
+
+#if CGAME_MEM_TRACK
+
+    // copy out what to print so the lock is not held while logging
+    mem_site_t leaks[CGAME_MEM_REPORT_MAX];
+    const char* leak_tags[CGAME_MEM_REPORT_MAX];
+    Uint64 leak_times[CGAME_MEM_REPORT_MAX];
+    Uint32 leak_frames[CGAME_MEM_REPORT_MAX];
+    size_t listed = 0;
+    Uint64 unmarked_count = 0;
+    Uint64 unmarked_bytes = 0;
+
+    SDL_LockSpinlock(&lock);
+    const mem_stats_t s = stats;
+    for (const mem_header_t* h = live; h; h = h->next) {
+        if (!h->file) {
+            // made by SDL itself or without the C_Malloc macros
+            unmarked_count++;
+            unmarked_bytes += h->size;
+        } else if (listed < CGAME_MEM_REPORT_MAX) {
+            leaks[listed].file = h->file;
+            leaks[listed].line = h->line;
+            leaks[listed].size = h->size;
+            leak_tags[listed] = h->tag;
+            leak_times[listed] = h->time;
+            leak_frames[listed] = h->frame;
+            listed++;
+        }
+    }
+    SDL_UnlockSpinlock(&lock);
+
+    G_LogInfo("memory",
+        "Heap: %llu allocations (%llu bytes) live, peak %llu bytes, "
+        "%llu allocs, %llu frees, %llu of %llu frames over budget.",
+        (unsigned long long) s.live_count,
+        (unsigned long long) s.live_bytes,
+        (unsigned long long) s.peak_bytes,
+        (unsigned long long) s.allocs,
+        (unsigned long long) s.frees,
+        (unsigned long long) s.frames_over_budget,
+        (unsigned long long) s.frames);
+
+    for (size_t i = 0; i < listed; i++) {
+        G_LogWarning("memory",
+            "Leak: %zu bytes from %s:%u [%s], frame %u, %.3f ms.",
+            leaks[i].size,
+            leaks[i].file,
+            (unsigned int) leaks[i].line,
+            leak_tags[i] ? leak_tags[i] : "untagged",
+            (unsigned int) leak_frames[i],
+            leak_times[i] / 1e6);
+    }
+
+    const Uint64 marked = s.live_count - unmarked_count;
+    if (marked > listed) {
+        G_LogWarning("memory", "Leak: %llu more not listed.",
+            (unsigned long long) (marked - listed));
+    }
+    if (unmarked_count) {
+        G_LogInfo("memory",
+            "%llu allocations (%llu bytes) from unmarked sites still live.",
+            (unsigned long long) unmarked_count,
+            (unsigned long long) unmarked_bytes);
+    }
+#endif
+}
@@ -0,0 +1,135 @@
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <stddef.h>
+#include <SDL3/SDL.h>
+
+/* Set to 0 to leave SDL's allocator alone and compile tracking out. */
+#define CGAME_MEM_TRACK 1
+
+/* Heaps that can sit behind SDL_malloc. */
+#define CGAME_MEM_HEAP_SYSTEM 0
+#define CGAME_MEM_HEAP_TLSF 1
+
+/* The heap SDL_malloc allocates from, under the tracker if it is on. */
+#define CGAME_MEM_HEAP CGAME_MEM_HEAP_TLSF
+
+/* Allocations allowed per frame once the game reaches a steady state. */
+#define CGAME_MEM_FRAME_BUDGET 0
+
+/* Frames after startup before the frame budget is enforced. */
+#define CGAME_MEM_WARMUP_FRAMES 120
+
+/* Set to 1 to assert when a frame goes over budget, instead of logging. */
+#define CGAME_MEM_BUDGET_FATAL 0
+
+/* Most live allocations listed individually by the leak report. */
+#define CGAME_MEM_REPORT_MAX 64
+
+/* Allocation sites kept per frame for the over budget message. */
+#define CGAME_MEM_FRAME_SITES 4
+
+/*
+ * Allocate through SDL, recording the calling file and line. Memory is
+ * released with SDL_free (SDL_aligned_free for C_AlignedAlloc) as usual.
+ */
+#define C_Malloc(size) \
+    C_MemMallocAt(__FILE__, __LINE__, (size))
+#define C_Calloc(count, size) \
+    C_MemCallocAt(__FILE__, __LINE__, (count), (size))
+#define C_Realloc(ptr, size) \
+    C_MemReallocAt(__FILE__, __LINE__, (ptr), (size))
+#define C_AlignedAlloc(align, size) \
+    C_MemAlignedAllocAt(__FILE__, __LINE__, (align), (size))
+
+/* Heap counters. */
+typedef struct {
+    /* Live allocations and bytes, and the most bytes ever live at once. */
+    Uint64 live_count;
+    Uint64 live_bytes;
+    Uint64 peak_bytes;
+
+    /* Calls that allocated or freed memory since tracking started. */
+    Uint64 allocs;
+    Uint64 frees;
+
+    /* Allocations and bytes allocated during the last complete frame. */
+    Uint64 frame_allocs;
+    Uint64 frame_bytes;
+
+    /* Frames completed, and how many of them went over budget. */
+    Uint64 frames;
+    Uint64 frames_over_budget;
+} mem_stats_t;
+
+/**
+ * Route every SDL allocation through the tracker and the heap selected by
+ * CGAME_MEM_HEAP. Must be called before any other SDL call, and the heap
+ * stays in place until the program exits.
+ * @returns Success or failure.
+ */
+int
+C_MemInstall(void);
+
+/**
+ * SDL_malloc, SDL_calloc and SDL_realloc that record the call site with the
+ * block. Used by the C_Malloc family of macros.
+ * @param file The source file.
+ * @param line The line.
+ */
+void*
+C_MemMallocAt(const char* file, int line, size_t size);
+
+void*
+C_MemCallocAt(const char* file, int line, size_t count, size_t size);
+
+void*
+C_MemReallocAt(const char* file, int line, void* ptr, size_t size);
+
+/**
+ * SDL_aligned_alloc that records the call site with the block. Used by
+ * C_AlignedAlloc.
+ * @param file The source file.
+ * @param line The line.
+ */
+void*
+C_MemAlignedAllocAt(const char* file, int line, size_t align, size_t size);
+
+/**
+ * Set the tag recorded with allocations from now on, on any thread.
+ * @param tag A string that outlives the allocations, or NULL.
+ * @returns The previous tag.
+ */
+const char*
+C_MemSetTag(const char* tag);
+
+/**
+ * Set how many allocations a steady state frame may make.
+ * @param max_allocs The budget, or a negative value for none.
+ */
+void
+C_MemSetFrameBudget(long max_allocs);
+
+/**
+ * Close the current frame of the per-frame counters and check it against
+ * the budget. Call once per frame.
+ * @returns 1 if the frame was within budget, 0 otherwise.
+ */
+int
+C_MemEndFrame(void);
+
+/**
+ * Get a copy of the counters.
+ * @param out The counters.
+ */
+void
+C_MemGetStats(mem_stats_t* out);
+
+/**
+ * Log the counters and every allocation that is still live, with its call
+ * site, size, tag and time.
+ */
+void
+C_MemReport(void);
+
+#endif
@@ -0,0 +1,299 @@
+#include "c_pool.h"
+#include "c_log.h"
+#include "c_memory.h"
+
+#include <stdint.h>
+
+/* Keeps the first block of a chunk 16 byte aligned. */
+#define POOL_CHUNK_HEADER_SIZE \
+    ((sizeof(pool_chunk_t) + 15u) & ~(size_t) 15u)
+
+/* Free blocks one thread holds back from a pool. */
+typedef struct pool_cache_t {
+    pool_t* pool;
+    struct pool_cache_t* prev;
+    struct pool_cache_t* next;
+
+    pool_free_t* list;
+    size_t count;
+
+    /* Counts not yet added to the pool stats. */
+    size_t allocs;
+    size_t frees;
+} pool_cache_t;
+
+/* Allocate a chunk and put its blocks on the free list. Lock held. */
+static int
+C_PoolGrow(pool_t* pool) {
+    if (pool->chunk_blocks
+        > (SIZE_MAX - POOL_CHUNK_HEADER_SIZE) / pool->block_size) {
+        G_Log("ERROR", "Pool chunk size overflows.");
+        return 0;
+    }
+
+    pool_chunk_t* chunk = C_Malloc(
+        POOL_CHUNK_HEADER_SIZE + pool->chunk_blocks * pool->block_size);
+    if (!chunk) {
+        G_Log("ERROR", "Failed to allocate memory for pool.");
+        return 0;
+    }
+    chunk->prev = pool->chunk;
+    pool->chunk = chunk;
+
+    // link back to front so blocks are handed out in address order
+    unsigned char* blocks = (unsigned char*) chunk + POOL_CHUNK_HEADER_SIZE;
+    for (size_t i = pool->chunk_blocks; i > 0; i--) {
+        pool_free_t* block
+            = (pool_free_t*) (blocks + (i - 1) * pool->block_size);
+        block->next = pool->free_list;
+        pool->free_list = block;
+    }
+
+    pool->stats.chunks++;
+    pool->stats.capacity += pool->chunk_blocks;
+    return 1;
+}
+
+/* Take a block off the free list, growing if it is empty. Lock held. */
+static void*
+C_PoolTake(pool_t* pool) {
+    if (!pool->free_list && !C_PoolGrow(pool)) {
+        pool->stats.failed++;
+        return NULL;
+    }
+
+    pool_free_t* block = pool->free_list;
+    pool->free_list = block->next;
+
+    pool->stats.in_use++;
+    if (pool->stats.in_use > pool->stats.peak) {
+        pool->stats.peak = pool->stats.in_use;
+    }
+    return block;
+}
+
+/* Put a block back on the free list. Lock held. */
+static void
+C_PoolGive(pool_t* pool, void* ptr) {
+    pool_free_t* block = ptr;
+    block->next = pool->free_list;
+    pool->free_list = block;
+    pool->stats.in_use--;
+}
+
+/* Return count blocks of a cache and its counts to the pool. Lock held. */
+static void
+C_PoolDrainCache(pool_cache_t* cache, size_t count) {
+    while (count > 0 && cache->list) {
+        pool_free_t* block = cache->list;
+        cache->list = block->next;
+        cache->count--;
+        C_PoolGive(cache->pool, block);
+        count--;
+    }
+
+    cache->pool->stats.allocs += cache->allocs;
+    cache->pool->stats.frees += cache->frees;
+    cache->allocs = 0;
+    cache->frees = 0;
+}
+
+/* Return everything a cache holds and free it. Lock held. */
+static void
+C_PoolReleaseCache(pool_cache_t* cache) {
+    pool_t* pool = cache->pool;
+    C_PoolDrainCache(cache, cache->count);
+
+    if (cache->prev) {
+        cache->prev->next = cache->next;
+    } else {
+        pool->caches = cache->next;
+    }
+    if (cache->next) {
+        cache->next->prev = cache->prev;
+    }
+    SDL_free(cache);
+}
+
+/* Runs when a thread with a cache exits. */
+static void SDLCALL
+C_PoolCacheDestructor(void* ptr) {
+    pool_cache_t* cache = ptr;
+    pool_t* pool = cache->pool;
+
+    SDL_LockSpinlock(&pool->lock);
+    C_PoolReleaseCache(cache);
+    SDL_UnlockSpinlock(&pool->lock);
+}
+
+/* Get the calling thread's cache, creating it on first use. */
+static pool_cache_t*
+C_PoolGetCache(pool_t* pool) {
+    pool_cache_t* cache = SDL_GetTLS(&pool->cache_id);
+    if (cache) {
+        return cache;
+    }
+
+    cache = C_Calloc(1, sizeof(*cache));
+    if (!cache) {
+        return NULL;
+    }
+    cache->pool = pool;
+
+    SDL_LockSpinlock(&pool->lock);
+    cache->next = pool->caches;
+    if (pool->caches) {
+        pool->caches->prev = cache;
+    }
+    pool->caches = cache;
+    SDL_UnlockSpinlock(&pool->lock);
+
+    if (!SDL_SetTLS(&pool->cache_id, cache, C_PoolCacheDestructor)) {
+        SDL_LockSpinlock(&pool->lock);
+        C_PoolReleaseCache(cache);
+        SDL_UnlockSpinlock(&pool->lock);
+        return NULL;
+    }
+    return cache;
+}
+
+int
+C_PoolCreate(
+    pool_t* pool,
+    size_t block_size,
+    size_t chunk_blocks,
+    unsigned int flags) {
+    SDL_memset(pool, 0, sizeof(*pool));
+
+    if (block_size == 0 || block_size > SIZE_MAX - sizeof(pool_free_t)) {
+        G_Log("ERROR", "Invalid pool block size.");
+        return 0;
+    }
+
+    // every block must be able to hold the free list link
+    block_size = (block_size + sizeof(pool_free_t) - 1)
+        & ~(sizeof(pool_free_t) - 1);
+
+    pool->block_size = block_size;
+    pool->chunk_blocks = chunk_blocks ? chunk_blocks : CGAME_POOL_CHUNK_BLOCKS;
+    pool->flags = flags;
+    SDL_SetAtomicInt(&pool->cache_id, 0);
+
+    return 1;
+}
+
+void
+C_PoolDestroy(pool_t* pool) {
+    if (pool->flags & CGAME_POOL_THREAD_CACHE) {
+        C_PoolFlushThreadCache(pool);
+    }
+    while (pool->caches) {
+        C_PoolReleaseCache(pool->caches);
+    }
+
+    pool_chunk_t* chunk = pool->chunk;
+    while (chunk) {
+        pool_chunk_t* prev = chunk->prev;
+        SDL_free(chunk);
+        chunk = prev;
+    }
+
+    SDL_memset(pool, 0, sizeof(*pool));
+}
+
+void*
+C_PoolAlloc(pool_t* pool) {
+    pool_cache_t* cache = NULL;
+    if (pool->flags & CGAME_POOL_THREAD_CACHE) {
+        cache = C_PoolGetCache(pool);
+    }
+
+    if (cache) {
+        if (!cache->list) {
+            // refill a batch at a time so the lock is rarely taken
+            SDL_LockSpinlock(&pool->lock);
+            for (size_t i = 0; i < CGAME_POOL_CACHE_BATCH; i++) {
+                pool_free_t* block = C_PoolTake(pool);
+                if (!block) {
+                    break;
+                }
+                block->next = cache->list;
+                cache->list = block;
+                cache->count++;
+            }
+            C_PoolDrainCache(cache, 0);
+            SDL_UnlockSpinlock(&pool->lock);
+
+            if (!cache->list) {
+                return NULL;
+            }
+        }
+
+        pool_free_t* block = cache->list;
+        cache->list = block->next;
+        cache->count--;
+        cache->allocs++;
+        return block;
+    }
+
+    SDL_LockSpinlock(&pool->lock);
+    void* block = C_PoolTake(pool);
+    pool->stats.allocs++;
+    SDL_UnlockSpinlock(&pool->lock);
+    return block;
+}
+
+void
+C_PoolFree(pool_t* pool, void* ptr) {
+    if (!ptr) {
+        return;
+    }
+
+    pool_cache_t* cache = NULL;
+    if (pool->flags & CGAME_POOL_THREAD_CACHE) {
+        cache = C_PoolGetCache(pool);
+    }
+
+    if (cache) {
+        pool_free_t* block = ptr;
+        block->next = cache->list;
+        cache->list = block;
+        cache->count++;
+        cache->frees++;
+
+        if (cache->count > CGAME_POOL_CACHE_SIZE) {
+            SDL_LockSpinlock(&pool->lock);
+            C_PoolDrainCache(cache, CGAME_POOL_CACHE_SIZE / 2);
+            SDL_UnlockSpinlock(&pool->lock);
+        }
+        return;
+    }
+
+    SDL_LockSpinlock(&pool->lock);
+    C_PoolGive(pool, ptr);
+    pool->stats.frees++;
+    SDL_UnlockSpinlock(&pool->lock);
+}
+
+void
+C_PoolFlushThreadCache(pool_t* pool) {
+    pool_cache_t* cache = SDL_GetTLS(&pool->cache_id);
+    if (!cache) {
+        return;
+    }
+
+    // clear the slot first so the destructor does not run on it
+    SDL_SetTLS(&pool->cache_id, NULL, NULL);
+
+    SDL_LockSpinlock(&pool->lock);
+    C_PoolReleaseCache(cache);
+    SDL_UnlockSpinlock(&pool->lock);
+}
+
+pool_stats_t
+C_PoolGetStats(pool_t* pool) {
+    SDL_LockSpinlock(&pool->lock);
+    pool_stats_t stats = pool->stats;
+    SDL_UnlockSpinlock(&pool->lock);
+    return stats;
+}
@@ -0,0 +1,134 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+#include <SDL3/SDL.h>
+
+/* Number of blocks per chunk when a pool is created with 0. */
+#define CGAME_POOL_CHUNK_BLOCKS 256u
+
+/* Most blocks a thread cache holds before it returns half to the pool. */
+#define CGAME_POOL_CACHE_SIZE 64u
+
+/* Number of blocks a thread cache takes from the pool at once. */
+#define CGAME_POOL_CACHE_BATCH 16u
+
+/* Pool options. */
+#define CGAME_POOL_THREAD_CACHE 0x1u
+
+/* Link stored in a free block. */
+typedef struct pool_free_t {
+    struct pool_free_t* next;
+} pool_free_t;
+
+/* Header in front of every chunk of blocks; chunks are chained newest first. */
+typedef struct pool_chunk_t {
+    struct pool_chunk_t* prev;
+} pool_chunk_t;
+
+/* Pool counters. */
+typedef struct {
+    /* Number of chunks and the blocks they hold. */
+    size_t chunks;
+    size_t capacity;
+
+    /* Blocks handed out (including those held by thread caches), and the
+     * most that were ever handed out at once. */
+    size_t in_use;
+    size_t peak;
+
+    /* Calls to C_PoolAlloc and C_PoolFree. With the thread cache enabled,
+     * each thread adds its counts when it next exchanges blocks with the
+     * pool. */
+    size_t allocs;
+    size_t frees;
+
+    /* Allocations that failed. */
+    size_t failed;
+} pool_stats_t;
+
+/**
+ * Fixed-size block allocator. Free blocks are kept on a list threaded
+ * through the blocks themselves, so allocating and freeing are O(1). The
+ * pool grows by whole chunks and only returns memory when destroyed.
+ * Thread safe; with CGAME_POOL_THREAD_CACHE each thread also keeps a few
+ * free blocks of its own and only takes the lock to exchange a batch.
+ */
+typedef struct {
+    /* Size of a block, rounded up to the pointer size. */
+    size_t block_size;
+    size_t chunk_blocks;
+    unsigned int flags;
+
+    pool_free_t* free_list;
+    pool_chunk_t* chunk;
+
+    /* Protects the free list, chunks, cache list and stats. */
+    SDL_SpinLock lock;
+
+    /* Slot of the calling thread's cache, and every cache created. Caches
+     * of threads not started by SDL are never cleaned up on thread exit, so
+     * the pool frees whatever is left when destroyed. */
+    SDL_TLSID cache_id;
+    struct pool_cache_t* caches;
+
+    pool_stats_t stats;
+} pool_t;
+
+/**
+ * Create a pool. No memory is allocated until the first block is requested.
+ * @param pool The pool.
+ * @param block_size The size of each block.
+ * @param chunk_blocks The number of blocks allocated at a time, 0 for
+ * CGAME_POOL_CHUNK_BLOCKS.
+ * @param flags CGAME_POOL_THREAD_CACHE or 0.
+ * @returns Success or failure.
+ */
+int
+C_PoolCreate(
+    pool_t* pool,
+    size_t block_size,
+    size_t chunk_blocks,
+    unsigned int flags);
+
+/**
+ * Free every chunk of the pool. Threads that used the thread cache must have
+ * exited or called C_PoolFlushThreadCache first.
+ * @param pool The pool.
+ */
+void
+C_PoolDestroy(pool_t* pool);
+
+/**
+ * Take a block from the pool.
+ * @param pool The pool.
+ * @returns The uninitialized block, or NULL if out of memory.
+ */
+void*
+C_PoolAlloc(pool_t* pool);
+
+/**
+ * Return a block to the pool.
+ * @param pool The pool the block came from.
+ * @param block The block, may be NULL.
+ */
+void
+C_PoolFree(pool_t* pool, void* block);
+
+/**
+ * Return the calling thread's cached blocks to the pool and add its counts
+ * to the stats. Runs on its own when a thread exits.
+ * @param pool The pool.
+ */
+void
+C_PoolFlushThreadCache(pool_t* pool);
+
+/**
+ * Get a copy of the pool counters.
+ * @param pool The pool.
+ * @returns The counters.
+ */
+pool_stats_t
+C_PoolGetStats(pool_t* pool);
+
+#endif
@@ -0,0 +1,221 @@
+#define VEC_IMPL_H_
+#include "c_quat.h"
+
+quat_t
+Quat_Identity(void) {
+    return (quat_t) {
+        .x = 0.0f,
+        .y = 0.0f,
+        .z = 0.0f,
+        .w = 1.0f
+    };
+}
+
+quat_t
+Quat_FromAxisAngle(vec_t axis, float theta) {
+    const float half = 0.5f * theta;
+    const float s = sinf(half);
+    return (quat_t) {
+        .x = axis.x * s,
+        .y = axis.y * s,
+        .z = axis.z * s,
+        .w = cosf(half)
+    };
+}
+
+void
+Quat_ToAxisAngle(const quat_t* q, vec_t* axis, float* theta) {
+    float w = q->w;
+    if (w > 1.0f) {
+        w = 1.0f;
+    } else if (w < -1.0f) {
+        w = -1.0f;
+    }
+
+    *theta = 2.0f * acosf(w);
+
+    // sin(theta / 2), zero for the identity rotation
+    const float s = sqrtf(1.0f - w * w);
+    if (s < 1e-6f) {
+        *axis = (vec_t) { .x = 1.0f, .y = 0.0f, .z = 0.0f };
+        return;
+    }
+
+    *axis = (vec_t) {
+        .x = q->x / s,
+        .y = q->y / s,
+        .z = q->z / s
+    };
+}
+
+quat_t
+Quat_Multiply(const quat_t* a, const quat_t* b) {
+    return (quat_t) {
+        .x = a->w * b->x + a->x * b->w + a->y * b->z - a->z * b->y,
+        .y = a->w * b->y - a->x * b->z + a->y * b->w + a->z * b->x,
+        .z = a->w * b->z + a->x * b->y - a->y * b->x + a->z * b->w,
+        .w = a->w * b->w - a->x * b->x - a->y * b->y - a->z * b->z
+    };
+}
+
+void
+Quat_Rotate(quat_t* q, vec_t axis, float theta) {
+    const quat_t rotation = Quat_FromAxisAngle(axis, theta);
+    *q = Quat_Multiply(q, &rotation);
+}
+
+quat_t
+Quat_Conjugate(const quat_t* q) {
+    return (quat_t) {
+        .x = -q->x,
+        .y = -q->y,
+        .z = -q->z,
+        .w = q->w
+    };
+}
+
+float
+Quat_Dot(const quat_t* a, const quat_t* b) {
+    return (a->x * b->x) + (a->y * b->y) + (a->z * b->z) + (a->w * b->w);
+}
+
+quat_t
+Quat_Normalize(const quat_t* q) {
+    const float len = sqrtf(Quat_Dot(q, q));
+    return (quat_t) {
+        .x = q->x / len,
+        .y = q->y / len,
+        .z = q->z / len,
+        .w = q->w / len
+    };
+}
+
+quat_t
+Quat_Nlerp(const quat_t* a, const quat_t* b, float t) {
+    // q and -q are the same rotation, pick the one on a's hemisphere
+    const float sign = Quat_Dot(a, b) < 0.0f ? -1.0f : 1.0f;
+    const float ta = 1.0f - t;
+    const float tb = t * sign;
+
+    const quat_t res = (quat_t) {
+        .x = a->x * ta + b->x * tb,
+        .y = a->y * ta + b->y * tb,
+        .z = a->z * ta + b->z * tb,
+        .w = a->w * ta + b->w * tb
+    };
+    return Quat_Normalize(&res);
+}
+
+quat_t
+Quat_Slerp(const quat_t* a, const quat_t* b, float t) {
+    float cosom = Quat_Dot(a, b);
+    float sign = 1.0f;
+    if (cosom < 0.0f) {
+        cosom = -cosom;
+        sign = -1.0f;
+    }
+
+    // sin(omega) goes to zero as the rotations converge
+    if (cosom > 0.9995f) {
+        return Quat_Nlerp(a, b, t);
+    }
+
+    const float omega = acosf(cosom);
+    const float sinom = sinf(omega);
+    const float ta = sinf((1.0f - t) * omega) / sinom;
+    const float tb = sign * sinf(t * omega) / sinom;
+
+    return (quat_t) {
+        .x = a->x * ta + b->x * tb,
+        .y = a->y * ta + b->y * tb,
+        .z = a->z * ta + b->z * tb,
+        .w = a->w * ta + b->w * tb
+    };
+}
+
+vec_t
+Quat_RotateVec(const quat_t* q, const vec_t* v) {
+    // v + 2w(u x v) + 2u x (u x v), with u the vector part
+    const vec_t u = { .x = q->x, .y = q->y, .z = q->z };
+    vec_t t = M_Cross(&u, v);
+    t = M_MultiplyVecByScalar(&t, 2.0f);
+
+    const vec_t wt = M_MultiplyVecByScalar(&t, q->w);
+    const vec_t ut = M_Cross(&u, &t);
+    const vec_t res = M_AddVec(v, &wt);
+    return M_AddVec(&res, &ut);
+}
+
+mat4_t
+Quat_ToMat4(const quat_t* q) {
+    mat4_t res = { 0 };
+    const float xx = q->x * q->x;
+    const float yy = q->y * q->y;
+    const float zz = q->z * q->z;
+    const float xy = q->x * q->y;
+    const float xz = q->x * q->z;
+    const float yz = q->y * q->z;
+    const float wx = q->w * q->x;
+    const float wy = q->w * q->y;
+    const float wz = q->w * q->z;
+
+    // Row 0
+    res.m[0][0] = 1.0f - 2.0f * (yy + zz);
+    res.m[0][1] = 2.0f * (xy - wz);
+    res.m[0][2] = 2.0f * (xz + wy);
+
+    // Row 1
+    res.m[1][0] = 2.0f * (xy + wz);
+    res.m[1][1] = 1.0f - 2.0f * (xx + zz);
+    res.m[1][2] = 2.0f * (yz - wx);
+
+    // Row 2
+    res.m[2][0] = 2.0f * (xz - wy);
+    res.m[2][1] = 2.0f * (yz + wx);
+    res.m[2][2] = 1.0f - 2.0f * (xx + yy);
+
+    // Row 3
+    res.m[3][3] = 1.0f;
+    return res;
+}
+
+transform_t
+Transform_Identity(void) {
+    return (transform_t) {
+        .translation = { .x = 0.0f, .y = 0.0f, .z = 0.0f },
+        .rotation = Quat_Identity(),
+        .scale = { .x = 1.0f, .y = 1.0f, .z = 1.0f }
+    };
+}
+
+vec_t
+Transform_Point(const transform_t* t, const vec_t* p) {
+    const vec_t scaled = M_MultiplyVec(p, &t->scale);
+    const vec_t rotated = Quat_RotateVec(&t->rotation, &scaled);
+    return M_AddVec(&rotated, &t->translation);
+}
+
+transform_t
+Transform_Compose(const transform_t* parent, const transform_t* child) {
+    return (transform_t) {
+        .translation = Transform_Point(parent, &child->translation),
+        .rotation = Quat_Multiply(&parent->rotation, &child->rotation),
+        .scale = M_MultiplyVec(&parent->scale, &child->scale)
+    };
+}
+
+mat4_t
+Transform_ToMat4(const transform_t* t) {
+    // R with column j scaled by scale[j], translation in the last column
+    mat4_t res = Quat_ToMat4(&t->rotation);
+    for (unsigned char i = 0; i < 3; i++) {
+        res.m[i][0] *= t->scale.x;
+        res.m[i][1] *= t->scale.y;
+        res.m[i][2] *= t->scale.z;
+    }
+
+    res.m[0][3] = t->translation.x;
+    res.m[1][3] = t->translation.y;
+    res.m[2][3] = t->translation.z;
+    return res;
+}
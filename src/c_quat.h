@@ -0,0 +1,199 @@
+#ifndef QUAT_H_
+#define QUAT_H_
+
+#include "c_math.h"
+
+/**
+ * @struct quat_t
+ * @brief Unit quaternion representing a rotation. (x, y, z) is the vector
+ * part and w the scalar part.
+ */
+typedef struct quat_t {
+    /**
+     * @brief X value of the vector part.
+     */
+    float x;
+
+    /**
+     * @brief Y value of the vector part.
+     */
+    float y;
+
+    /**
+     * @brief Z value of the vector part.
+     */
+    float z;
+
+    /**
+     * @brief Scalar part.
+     */
+    float w;
+} quat_t;
+
+/**
+ * @struct transform_t
+ * @brief Translation, rotation and scale kept separately so that composing
+ * and interpolating transforms stays cheap. Only turned into a mat4_t with
+ * Transform_ToMat4 once a matrix is actually needed (M = T * R * S).
+ */
+typedef struct transform_t {
+    /**
+     * @brief Translation.
+     */
+    vec_t translation;
+
+    /**
+     * @brief Rotation.
+     */
+    quat_t rotation;
+
+    /**
+     * @brief Per-axis scale.
+     */
+    vec_t scale;
+} transform_t;
+
+/**
+ * @brief Return the identity quaternion
+ * @return The identity quaternion
+ */
+quat_t
+Quat_Identity(void);
+
+/**
+ * @brief Build a rotation of theta radians around a normalized axis. Matches
+ * Mat4_RotationMatrix for the same arguments.
+ * @param axis The normalized rotation axis
+ * @param theta The angle in radians
+ * @return The quaternion
+ */
+quat_t
+Quat_FromAxisAngle(vec_t axis, float theta);
+
+/**
+ * @brief Get the axis and angle of a unit quaternion
+ * @param q The quaternion
+ * @param axis Output - the normalized axis, x axis for a null rotation
+ * @param theta Output - the angle in radians, in [0, 2pi]
+ */
+void
+Quat_ToAxisAngle(const quat_t* q, vec_t* axis, float* theta);
+
+/**
+ * @brief Compose two rotations. The result rotates by b first, then a, the
+ * same order as M_MultiplyMat4(a, b) on the equivalent matrices.
+ * @param a The first quaternion
+ * @param b The second quaternion
+ * @return The composed quaternion
+ */
+quat_t
+Quat_Multiply(const quat_t* a, const quat_t* b);
+
+/**
+ * @brief Rotate q in place around axis, the quaternion version of Mat4_Rotate
+ * @param q The quaternion
+ * @param axis The normalized rotation axis
+ * @param theta The angle in radians
+ */
+void
+Quat_Rotate(quat_t* q, vec_t axis, float theta);
+
+/**
+ * @brief Get the conjugate, which is the inverse of a unit quaternion
+ * @param q The quaternion
+ * @return The conjugate
+ */
+quat_t
+Quat_Conjugate(const quat_t* q);
+
+/**
+ * @brief Get the dot product of two quaternions
+ * @param a The first quaternion
+ * @param b The second quaternion
+ * @return The dot product
+ */
+float
+Quat_Dot(const quat_t* a, const quat_t* b);
+
+/**
+ * @brief Normalize a quaternion
+ * @param q The quaternion
+ * @return The unit quaternion
+ */
+quat_t
+Quat_Normalize(const quat_t* q);
+
+/**
+ * @brief Normalized linear interpolation along the shortest path. Cheap, but
+ * the angular speed is not constant across t.
+ * @param a The start rotation
+ * @param b The end rotation
+ * @param t The interpolation factor in [0, 1]
+ * @return The interpolated rotation
+ */
+quat_t
+Quat_Nlerp(const quat_t* a, const quat_t* b, float t);
+
+/**
+ * @brief Spherical linear interpolation along the shortest path with constant
+ * angular speed. Falls back to Quat_Nlerp for nearly equal rotations.
+ * @param a The start rotation
+ * @param b The end rotation
+ * @param t The interpolation factor in [0, 1]
+ * @return The interpolated rotation
+ */
+quat_t
+Quat_Slerp(const quat_t* a, const quat_t* b, float t);
+
+/**
+ * @brief Rotate a vector by a unit quaternion
+ * @param q The quaternion
+ * @param v The vector
+ * @return The rotated vector
+ */
+vec_t
+Quat_RotateVec(const quat_t* q, const vec_t* v);
+
+/**
+ * @brief Convert a unit quaternion to a rotation matrix
+ * @param q The quaternion
+ * @return The rotation matrix
+ */
+mat4_t
+Quat_ToMat4(const quat_t* q);
+
+/**
+ * @brief Return the identity transform
+ * @return The identity transform
+ */
+transform_t
+Transform_Identity(void);
+
+/**
+ * @brief Compose a child transform into its parent's space. Exact for uniform
+ * scale; with non-uniform scale any shear is dropped.
+ * @param parent The parent transform
+ * @param child The child transform
+ * @return The child transform expressed in the parent's space
+ */
+transform_t
+Transform_Compose(const transform_t* parent, const transform_t* child);
+
+/**
+ * @brief Transform a point by translation, rotation and scale
+ * @param t The transform
+ * @param p The point
+ * @return The transformed point
+ */
+vec_t
+Transform_Point(const transform_t* t, const vec_t* p);
+
+/**
+ * @brief Build the matrix T * R * S for the transform
+ * @param t The transform
+ * @return The matrix
+ */
+mat4_t
+Transform_ToMat4(const transform_t* t);
+
+#endif // QUAT_H_
@@ -0,0 +1,553 @@
+#include "c_tlsf.h"
+#include "c_log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#define TLSF_ROUND(x) \
+  (((x) + CGAME_TLSF_ALIGN - 1) & ~(size_t) (CGAME_TLSF_ALIGN - 1))
+
+/* Offset of the memory of a block behind its header. */
+#define TLSF_HEADER_SIZE TLSF_ROUND(sizeof(tlsf_block_t))
+
+/* Offset of the first block of a region. */
+#define TLSF_REGION_HEADER_SIZE TLSF_ROUND(sizeof(tlsf_region_t))
+
+/* Smallest block; a free block stores its list links in it. */
+#define TLSF_MIN_SIZE TLSF_ROUND(sizeof(tlsf_free_t))
+
+/* Blocks below this size are spread linearly over the first level. */
+#define TLSF_FL_SHIFT (CGAME_TLSF_SL_LOG2 + 4)
+#define TLSF_SMALL_SIZE ((size_t) 1 << TLSF_FL_SHIFT)
+
+/* Largest block size the classes cover. */
+#define TLSF_MAX_SIZE \
+  (((size_t) 1 << (CGAME_TLSF_FL_COUNT + TLSF_FL_SHIFT - 1)) - 1)
+
+#define TLSF_FREE_BIT ((size_t) 1)
+
+/* Free list links, stored in the memory of a free block. */
+typedef struct {
+  tlsf_block_t* next;
+  tlsf_block_t* prev;
+} tlsf_free_t;
+
+static tlsf_t main_heap;
+
+/* Index of the highest set bit; x must not be 0. */
+static int
+C_TlsfFls(size_t x) {
+#if defined(__GNUC__)
+  return (int) (sizeof(unsigned long long) * 8 - 1)
+    - __builtin_clzll((unsigned long long) x);
+#else
+  int bit = -1;
+  while (x) {
+    x >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+/* Index of the lowest set bit; x must not be 0. */
+static int
+C_TlsfFfs(Uint32 x) {
+#if defined(__GNUC__)
+  return __builtin_ctz(x);
+#else
+  int bit = 0;
+  while (!(x & 1u)) {
+    x >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+static size_t
+C_TlsfBlockSize(const tlsf_block_t* block) {
+  return block->size & ~TLSF_FREE_BIT;
+}
+
+static int
+C_TlsfIsFree(const tlsf_block_t* block) {
+  return (block->size & TLSF_FREE_BIT) != 0;
+}
+
+static void*
+C_TlsfPayload(const tlsf_block_t* block) {
+  return (char*) block + TLSF_HEADER_SIZE;
+}
+
+static tlsf_block_t*
+C_TlsfFromPayload(void* ptr) {
+  return (tlsf_block_t*) ((char*) ptr - TLSF_HEADER_SIZE);
+}
+
+static tlsf_free_t*
+C_TlsfLinks(tlsf_block_t* block) {
+  return C_TlsfPayload(block);
+}
+
+static tlsf_block_t*
+C_TlsfNextPhys(const tlsf_block_t* block) {
+  return (tlsf_block_t*) ((char*) C_TlsfPayload(block)
+    + C_TlsfBlockSize(block));
+}
+
+/* Size class of a block of the given size. */
+static void
+C_TlsfMapping(size_t size, int* fl, int* sl) {
+  if (size < TLSF_SMALL_SIZE) {
+    *fl = 0;
+    *sl = (int) (size / CGAME_TLSF_ALIGN);
+  } else {
+    const int bit = C_TlsfFls(size);
+    *sl = (int) (size >> (bit - CGAME_TLSF_SL_LOG2)) ^ CGAME_TLSF_SL_COUNT;
+    *fl = bit - TLSF_FL_SHIFT + 1;
+  }
+}
+
+/* Size class whose every block is at least size bytes. */
+static void
+C_TlsfMappingSearch(size_t size, int* fl, int* sl) {
+  if (size >= TLSF_SMALL_SIZE) {
+    size += ((size_t) 1 << (C_TlsfFls(size) - CGAME_TLSF_SL_LOG2)) - 1;
+  }
+  C_TlsfMapping(size, fl, sl);
+}
+
+static void
+C_TlsfInsert(tlsf_t* tlsf, tlsf_block_t* block) {
+  int fl, sl;
+  C_TlsfMapping(C_TlsfBlockSize(block), &fl, &sl);
+
+  tlsf_block_t* head = tlsf->free_lists[fl][sl];
+  tlsf_free_t* links = C_TlsfLinks(block);
+  links->next = head;
+  links->prev = NULL;
+  if (head) {
+    C_TlsfLinks(head)->prev = block;
+  }
+  tlsf->free_lists[fl][sl] = block;
+
+  tlsf->fl_bitmap |= 1u << fl;
+  tlsf->sl_bitmap[fl] |= 1u << sl;
+  block->size |= TLSF_FREE_BIT;
+  tlsf->stats.free_blocks++;
+}
+
+static void
+C_TlsfRemove(tlsf_t* tlsf, tlsf_block_t* block) {
+  int fl, sl;
+  C_TlsfMapping(C_TlsfBlockSize(block), &fl, &sl);
+
+  tlsf_free_t* links = C_TlsfLinks(block);
+  if (links->next) {
+    C_TlsfLinks(links->next)->prev = links->prev;
+  }
+  if (links->prev) {
+    C_TlsfLinks(links->prev)->next = links->next;
+  } else {
+    tlsf->free_lists[fl][sl] = links->next;
+    if (!links->next) {
+      tlsf->sl_bitmap[fl] &= ~(1u << sl);
+      if (!tlsf->sl_bitmap[fl]) {
+        tlsf->fl_bitmap &= ~(1u << fl);
+      }
+    }
+  }
+
+  block->size &= ~TLSF_FREE_BIT;
+  tlsf->stats.free_blocks--;
+}
+
+/* First free block of the class or any larger one. */
+static tlsf_block_t*
+C_TlsfFind(tlsf_t* tlsf, int fl, int sl) {
+  Uint32 sl_map = tlsf->sl_bitmap[fl] & (~0u << sl);
+  if (!sl_map) {
+    const Uint32 fl_map = fl + 1 < CGAME_TLSF_FL_COUNT
+      ? tlsf->fl_bitmap & (~0u << (fl + 1)) : 0;
+    if (!fl_map) {
+      return NULL;
+    }
+    fl = C_TlsfFfs(fl_map);
+    sl_map = tlsf->sl_bitmap[fl];
+  }
+  return tlsf->free_lists[fl][C_TlsfFfs(sl_map)];
+}
+
+/* Cut a used block down to size, freeing the tail if it is big enough. */
+static void
+C_TlsfTrim(tlsf_t* tlsf, tlsf_block_t* block, size_t size) {
+  const size_t block_size = C_TlsfBlockSize(block);
+  if (block_size < size + TLSF_HEADER_SIZE + TLSF_MIN_SIZE) {
+    return;
+  }
+
+  block->size = size;
+  tlsf_block_t* tail = C_TlsfNextPhys(block);
+  tail->prev_phys = block;
+  tail->size = block_size - size - TLSF_HEADER_SIZE;
+
+  // keep free neighbours merged
+  tlsf_block_t* next = C_TlsfNextPhys(tail);
+  if (C_TlsfIsFree(next)) {
+    C_TlsfRemove(tlsf, next);
+    tail->size += TLSF_HEADER_SIZE + C_TlsfBlockSize(next);
+    next = C_TlsfNextPhys(tail);
+  }
+  next->prev_phys = tail;
+
+  C_TlsfInsert(tlsf, tail);
+}
+
+/* Add a region of at least size bytes. Lock held. */
+static int
+C_TlsfAddRegion(tlsf_t* tlsf, size_t size) {
+  const size_t overhead = TLSF_REGION_HEADER_SIZE + 2 * TLSF_HEADER_SIZE
+    + CGAME_TLSF_ALIGN;
+  if (size > TLSF_MAX_SIZE - overhead) {
+    return 0;
+  }
+  if (size < overhead + TLSF_MIN_SIZE) {
+    size = overhead + TLSF_MIN_SIZE;
+  }
+
+  // regions come straight from the C library, as this heap may itself be
+  // what SDL_malloc allocates from
+  void* memory = malloc(size);
+  if (!memory) {
+    return 0;
+  }
+
+  tlsf_region_t* region = (tlsf_region_t*) TLSF_ROUND((uintptr_t) memory);
+  region->memory = memory;
+  region->size = size - (size_t) ((char*) region - (char*) memory);
+  region->prev = tlsf->region;
+  tlsf->region = region;
+
+  // one free block over the whole region, then a zero size used block so
+  // the last real block always has a neighbour
+  tlsf_block_t* block
+    = (tlsf_block_t*) ((char*) region + TLSF_REGION_HEADER_SIZE);
+  block->prev_phys = NULL;
+  block->size = (region->size - TLSF_REGION_HEADER_SIZE
+    - 2 * TLSF_HEADER_SIZE) & ~(size_t) (CGAME_TLSF_ALIGN - 1);
+
+  tlsf_block_t* sentinel = C_TlsfNextPhys(block);
+  sentinel->prev_phys = block;
+  sentinel->size = 0;
+
+  C_TlsfInsert(tlsf, block);
+
+  tlsf->stats.regions++;
+  tlsf->stats.capacity += region->size;
+  return 1;
+}
+
+/* Size of a block for a request, 0 if it is too large. */
+static size_t
+C_TlsfAdjust(size_t size) {
+  // half the largest class, so rounding a search up stays within the classes
+  if (size > TLSF_MAX_SIZE / 2) {
+    return 0;
+  }
+  size = TLSF_ROUND(size);
+  return size < TLSF_MIN_SIZE ? TLSF_MIN_SIZE : size;
+}
+
+/* Lock held. */
+static void*
+C_TlsfAllocLocked(tlsf_t* tlsf, size_t size, size_t align) {
+  const size_t adjusted = C_TlsfAdjust(size);
+  if (!adjusted || align > TLSF_MAX_SIZE / 4) {
+    tlsf->stats.failed++;
+    return NULL;
+  }
+
+  // over-aligned requests need room to split off a free block in front
+  size_t request = adjusted;
+  if (align > CGAME_TLSF_ALIGN) {
+    request = C_TlsfAdjust(adjusted + align + TLSF_HEADER_SIZE + TLSF_MIN_SIZE);
+    if (!request) {
+      tlsf->stats.failed++;
+      return NULL;
+    }
+  }
+
+  int fl, sl;
+  C_TlsfMappingSearch(request, &fl, &sl);
+  tlsf_block_t* block = C_TlsfFind(tlsf, fl, sl);
+
+  if (!block && tlsf->grow_size) {
+    // room for the request rounded up to its size class, plus headers
+    const size_t needed = request + (request >> CGAME_TLSF_SL_LOG2)
+      + TLSF_REGION_HEADER_SIZE + 3 * TLSF_HEADER_SIZE + CGAME_TLSF_ALIGN;
+    if (C_TlsfAddRegion(
+      tlsf, needed > tlsf->grow_size ? needed : tlsf->grow_size)) {
+      block = C_TlsfFind(tlsf, fl, sl);
+    }
+  }
+  if (!block) {
+    tlsf->stats.failed++;
+    return NULL;
+  }
+
+  C_TlsfRemove(tlsf, block);
+
+  if (align > CGAME_TLSF_ALIGN) {
+    const uintptr_t start = (uintptr_t) C_TlsfPayload(block);
+    uintptr_t aligned = (start + align - 1) & ~(uintptr_t) (align - 1);
+    if (aligned != start
+      && aligned - start < TLSF_HEADER_SIZE + TLSF_MIN_SIZE) {
+      aligned += align;
+    }
+
+    // give the gap in front back as a free block of its own
+    const size_t gap = (size_t) (aligned - start);
+    if (gap) {
+      const size_t block_size = C_TlsfBlockSize(block);
+      tlsf_block_t* moved = C_TlsfFromPayload((void*) aligned);
+      moved->prev_phys = block;
+      moved->size = block_size - gap;
+      C_TlsfNextPhys(moved)->prev_phys = moved;
+
+      block->size = gap - TLSF_HEADER_SIZE;
+      C_TlsfInsert(tlsf, block);
+      block = moved;
+    }
+  }
+
+  C_TlsfTrim(tlsf, block, adjusted);
+
+  tlsf->stats.used += C_TlsfBlockSize(block);
+  if (tlsf->stats.used > tlsf->stats.peak) {
+    tlsf->stats.peak = tlsf->stats.used;
+  }
+  tlsf->stats.used_blocks++;
+  tlsf->stats.allocs++;
+
+  return C_TlsfPayload(block);
+}
+
+/* Lock held. */
+static void
+C_TlsfFreeLocked(tlsf_t* tlsf, void* ptr) {
+  tlsf_block_t* block = C_TlsfFromPayload(ptr);
+
+  tlsf->stats.used -= C_TlsfBlockSize(block);
+  tlsf->stats.used_blocks--;
+  tlsf->stats.frees++;
+
+  // merge with free neighbours on both sides
+  tlsf_block_t* prev = block->prev_phys;
+  if (prev && C_TlsfIsFree(prev)) {
+    C_TlsfRemove(tlsf, prev);
+    prev->size += TLSF_HEADER_SIZE + C_TlsfBlockSize(block);
+    block = prev;
+  }
+
+  tlsf_block_t* next = C_TlsfNextPhys(block);
+  if (C_TlsfIsFree(next)) {
+    C_TlsfRemove(tlsf, next);
+    block->size += TLSF_HEADER_SIZE + C_TlsfBlockSize(next);
+    next = C_TlsfNextPhys(block);
+  }
+  next->prev_phys = block;
+
+  C_TlsfInsert(tlsf, block);
+}
+
+int
+C_TlsfCreate(tlsf_t* tlsf, size_t size, size_t grow_size) {
+  SDL_memset(tlsf, 0, sizeof(*tlsf));
+
+  if (!C_TlsfAddRegion(tlsf, size)) {
+    G_Log("ERROR", "Failed to allocate memory for heap.");
+    return 0;
+  }
+
+  tlsf->grow_size = grow_size;
+  return 1;
+}
+
+void
+C_TlsfDestroy(tlsf_t* tlsf) {
+  tlsf_region_t* region = tlsf->region;
+  while (region) {
+    tlsf_region_t* prev = region->prev;
+    free(region->memory);
+    region = prev;
+  }
+
+  SDL_memset(tlsf, 0, sizeof(*tlsf));
+}
+
+void*
+C_TlsfAlloc(tlsf_t* tlsf, size_t size, size_t align) {
+  if (align == 0) {
+    align = CGAME_TLSF_ALIGN;
+  }
+  if (align & (align - 1)) {
+    G_Log("ERROR", "Heap alignment must be a power of two.");
+    return NULL;
+  }
+
+  SDL_LockSpinlock(&tlsf->lock);
+  void* ptr = C_TlsfAllocLocked(tlsf, size, align);
+  SDL_UnlockSpinlock(&tlsf->lock);
+  return ptr;
+}
+
+void*
+C_TlsfAllocArray(tlsf_t* tlsf, size_t count, size_t size) {
+  if (size && count > SIZE_MAX / size) {
+    G_Log("ERROR", "Heap array size overflows.");
+    return NULL;
+  }
+
+  void* ptr = C_TlsfAlloc(tlsf, count * size, 0);
+  if (ptr) {
+    SDL_memset(ptr, 0, count * size);
+  }
+  return ptr;
+}
+
+void*
+C_TlsfRealloc(tlsf_t* tlsf, void* ptr, size_t size) {
+  if (!ptr) {
+    return C_TlsfAlloc(tlsf, size, 0);
+  }
+
+  const size_t adjusted = C_TlsfAdjust(size);
+  if (!adjusted) {
+    return NULL;
+  }
+
+  SDL_LockSpinlock(&tlsf->lock);
+  tlsf_block_t* block = C_TlsfFromPayload(ptr);
+  const size_t old_size = C_TlsfBlockSize(block);
+
+  // grow into the next block when it is free and large enough
+  tlsf_block_t* next = C_TlsfNextPhys(block);
+  if (adjusted > old_size && C_TlsfIsFree(next)
+    && old_size + TLSF_HEADER_SIZE + C_TlsfBlockSize(next) >= adjusted) {
+    C_TlsfRemove(tlsf, next);
+    block->size += TLSF_HEADER_SIZE + C_TlsfBlockSize(next);
+    C_TlsfNextPhys(block)->prev_phys = block;
+  }
+
+  if (C_TlsfBlockSize(block) >= adjusted) {
+    C_TlsfTrim(tlsf, block, adjusted);
+    tlsf->stats.used += C_TlsfBlockSize(block);
+    tlsf->stats.used -= old_size;
+    if (tlsf->stats.used > tlsf->stats.peak) {
+      tlsf->stats.peak = tlsf->stats.used;
+    }
+    SDL_UnlockSpinlock(&tlsf->lock);
+    return ptr;
+  }
+
+  void* moved = C_TlsfAllocLocked(tlsf, size, CGAME_TLSF_ALIGN);
+  if (moved) {
+    SDL_memcpy(moved, ptr, old_size);
+    C_TlsfFreeLocked(tlsf, ptr);
+  }
+  SDL_UnlockSpinlock(&tlsf->lock);
+  return moved;
+}
+
+void
+C_TlsfFree(tlsf_t* tlsf, void* ptr) {
+  if (!ptr) {
+    return;
+  }
+
+  SDL_LockSpinlock(&tlsf->lock);
+  C_TlsfFreeLocked(tlsf, ptr);
+  SDL_UnlockSpinlock(&tlsf->lock);
+}
+
+/* Check that a free block is on the list of its class. */
+static int
+C_TlsfIsListed(const tlsf_t* tlsf, tlsf_block_t* block) {
+  int fl, sl;
+  C_TlsfMapping(C_TlsfBlockSize(block), &fl, &sl);
+
+  for (tlsf_block_t* it = tlsf->free_lists[fl][sl]; it;
+    it = C_TlsfLinks(it)->next) {
+    if (it == block) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int
+C_TlsfWalk(tlsf_t* tlsf, tlsf_walker walker, void* user) {
+  char msg[128];
+  int ok = 1;
+  size_t free_blocks = 0;
+  size_t used_blocks = 0;
+
+  SDL_LockSpinlock(&tlsf->lock);
+  for (tlsf_region_t* region = tlsf->region; region; region = region->prev) {
+    tlsf_block_t* prev = NULL;
+    tlsf_block_t* block
+      = (tlsf_block_t*) ((char*) region + TLSF_REGION_HEADER_SIZE);
+    const char* end = (char*) region + region->size;
+
+    // the zero size used block ends the region
+    while (ok && block->size != 0) {
+      const int is_free = C_TlsfIsFree(block);
+      if (block->prev_phys != prev
+        || (char*) C_TlsfNextPhys(block) + TLSF_HEADER_SIZE > end
+        || (is_free && prev && C_TlsfIsFree(prev))
+        || (is_free && !C_TlsfIsListed(tlsf, block))) {
+        snprintf(msg, sizeof(msg), "Heap block %p is corrupt.",
+          (void*) block);
+        G_Log("ERROR", msg);
+        ok = 0;
+        break;
+      }
+
+      if (walker) {
+        walker(C_TlsfPayload(block), C_TlsfBlockSize(block), !is_free, user);
+      }
+      if (is_free) {
+        free_blocks++;
+      } else {
+        used_blocks++;
+      }
+
+      prev = block;
+      block = C_TlsfNextPhys(block);
+    }
+  }
+
+  if (ok && (free_blocks != tlsf->stats.free_blocks
+    || used_blocks != tlsf->stats.used_blocks)) {
+    G_Log("ERROR", "Heap block counts do not match its free lists.");
+    ok = 0;
+  }
+  SDL_UnlockSpinlock(&tlsf->lock);
+
+  return ok;
+}
+
+tlsf_stats_t
+C_TlsfGetStats(tlsf_t* tlsf) {
+  SDL_LockSpinlock(&tlsf->lock);
+  tlsf_stats_t stats = tlsf->stats;
+  SDL_UnlockSpinlock(&tlsf->lock);
+  return stats;
+}
+
+tlsf_t*
+C_MainHeap(void) {
+  return &main_heap;
+}
@@ -0,0 +1,183 @@
+#ifndef TLSF_H_
+#define TLSF_H_
+
+#include <stddef.h>
+#include <SDL3/SDL.h>
+
+/* Size of the main heap's first region. */
+#define CGAME_HEAP_INIT_SIZE 64000000u
+
+/* Size of regions added when a heap runs out, 0 to never grow. */
+#define CGAME_HEAP_GROW_SIZE 16000000u
+
+/* Alignment of every block, and the one used when an allocation passes 0. */
+#define CGAME_TLSF_ALIGN 16u
+
+/* log2 of the number of second level lists per power of two. */
+#define CGAME_TLSF_SL_LOG2 4
+
+/* Number of first level size classes; blocks up to 2^39 bytes. */
+#define CGAME_TLSF_FL_COUNT 32
+
+#define CGAME_TLSF_SL_COUNT (1 << CGAME_TLSF_SL_LOG2)
+
+/* Header in front of every block. Free blocks also keep their free list
+ * links in the first bytes of the block. */
+typedef struct tlsf_block_t {
+  /* Block just before this one in memory, NULL for the first of a region. */
+  struct tlsf_block_t* prev_phys;
+
+  /* Usable bytes behind the header; the low bit is set while free. */
+  size_t size;
+} tlsf_block_t;
+
+/* Header of each memory region; regions are chained newest first. */
+typedef struct tlsf_region_t {
+  struct tlsf_region_t* prev;
+  size_t size;
+
+  /* Start of the allocation the region was aligned within. */
+  void* memory;
+} tlsf_region_t;
+
+/* Heap counters. */
+typedef struct {
+  /* Regions and the bytes they span. */
+  size_t regions;
+  size_t capacity;
+
+  /* Bytes in used blocks, and the most that were ever in use at once. */
+  size_t used;
+  size_t peak;
+
+  /* Blocks of each kind. */
+  size_t used_blocks;
+  size_t free_blocks;
+
+  size_t allocs;
+  size_t frees;
+  size_t failed;
+} tlsf_stats_t;
+
+/**
+ * Two level segregated fit allocator. Free blocks are kept in lists by size
+ * class, found through two levels of bitmaps, so allocating and freeing take
+ * constant time and a block is always within one size class of the request.
+ * Neighbouring free blocks are merged immediately. Thread safe.
+ */
+typedef struct {
+  /* Bit i is set if first level i has a non-empty list. */
+  Uint32 fl_bitmap;
+
+  /* Bit j of entry i is set if the list [i][j] is non-empty. */
+  Uint32 sl_bitmap[CGAME_TLSF_FL_COUNT];
+
+  tlsf_block_t* free_lists[CGAME_TLSF_FL_COUNT][CGAME_TLSF_SL_COUNT];
+
+  /* Regions, NULL until the heap is created. */
+  tlsf_region_t* region;
+
+  /* Size of regions added when full, 0 to never grow. */
+  size_t grow_size;
+
+  SDL_SpinLock lock;
+
+  tlsf_stats_t stats;
+} tlsf_t;
+
+/**
+ * Called for every block of a heap, in address order within each region.
+ * @param ptr The memory of the block.
+ * @param size The usable size of the block.
+ * @param used 1 if the block is allocated, 0 if free.
+ * @param user Passed through from C_TlsfWalk.
+ */
+typedef void (*tlsf_walker)(void* ptr, size_t size, int used, void* user);
+
+/**
+ * Allocate the first region of a heap.
+ * @param tlsf The heap.
+ * @param size The size of the first region.
+ * @param grow_size The size of regions added when full, 0 to fail instead.
+ * @returns Success or failure.
+ */
+int
+C_TlsfCreate(tlsf_t* tlsf, size_t size, size_t grow_size);
+
+/**
+ * Free every region of the heap.
+ * @param tlsf The heap.
+ */
+void
+C_TlsfDestroy(tlsf_t* tlsf);
+
+/**
+ * Allocate uninitialized memory from the heap.
+ * @param tlsf The heap.
+ * @param size The number of bytes.
+ * @param align The alignment, a power of two, or 0 for CGAME_TLSF_ALIGN.
+ * @returns The memory, or NULL if the heap is full and cannot grow.
+ */
+void*
+C_TlsfAlloc(tlsf_t* tlsf, size_t size, size_t align);
+
+/**
+ * Allocate a zeroed array from the heap, checking count * size for overflow.
+ * @param tlsf The heap.
+ * @param count The number of elements.
+ * @param size The size of one element.
+ * @returns The memory, or NULL on overflow or if the heap is full.
+ */
+void*
+C_TlsfAllocArray(tlsf_t* tlsf, size_t count, size_t size);
+
+/* Allocate a zeroed array of count elements of type. */
+#define C_TlsfNew(tlsf, type, count) \
+  ((type*) C_TlsfAllocArray((tlsf), (count), sizeof(type)))
+
+/**
+ * Resize an allocation, in place when the following block is free.
+ * @param tlsf The heap.
+ * @param ptr The memory, or NULL to allocate.
+ * @param size The new size.
+ * @returns The memory, or NULL on failure, in which case ptr is untouched.
+ */
+void*
+C_TlsfRealloc(tlsf_t* tlsf, void* ptr, size_t size);
+
+/**
+ * Return memory to the heap.
+ * @param tlsf The heap the memory came from.
+ * @param ptr The memory, may be NULL.
+ */
+void
+C_TlsfFree(tlsf_t* tlsf, void* ptr);
+
+/**
+ * Visit every block of the heap and check that the blocks and free lists
+ * agree. The heap is locked during the walk, so the walker must not use it.
+ * @param tlsf The heap.
+ * @param walker Called for each block, may be NULL to only check.
+ * @param user Passed to walker.
+ * @returns 1 if the heap is consistent, 0 if it is corrupt.
+ */
+int
+C_TlsfWalk(tlsf_t* tlsf, tlsf_walker walker, void* user);
+
+/**
+ * Get a copy of the heap counters.
+ * @param tlsf The heap.
+ * @returns The counters.
+ */
+tlsf_stats_t
+C_TlsfGetStats(tlsf_t* tlsf);
+
+/**
+ * The main heap, behind SDL_malloc when CGAME_MEM_HEAP selects it. Created
+ * by C_MemInstall.
+ * @returns The main heap.
+ */
+tlsf_t*
+C_MainHeap(void);
+
+#endif
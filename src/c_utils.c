@@ -1,5 +1,6 @@
 #include "c_utils.h"
 #include "c_log.h"
+#include "c_memory.h"
 
 #include <stdio.h>
 
@@ -20,7 +21,7 @@ C_ReadBinaryFile(const char* filename, buffer* buf) {
 
     // allocate buffer. no need to null terminate as its binary data.
 
-    char* buffer = SDL_malloc(size);
+    char* buffer = C_Malloc(size);
     if (!buffer) {
         G_Log("ERROR", "Failed to allocate memory for file.");
         fclose(shaderfile);
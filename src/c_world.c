@@ -0,0 +1,83 @@
+#define VEC_IMPL_H_
+#include "c_world.h"
+
+dvec_t
+DVec_FromVec(const vec_t* v) {
+    dvec_t res = { .x = v->x, .y = v->y, .z = v->z };
+    return res;
+}
+
+dvec_t
+DVec_Add(const dvec_t* a, const dvec_t* b) {
+    dvec_t res = { .x = a->x + b->x, .y = a->y + b->y, .z = a->z + b->z };
+    return res;
+}
+
+dvec_t
+DVec_Subtract(const dvec_t* a, const dvec_t* b) {
+    dvec_t res = { .x = a->x - b->x, .y = a->y - b->y, .z = a->z - b->z };
+    return res;
+}
+
+dvec_t
+DVec_AddVec(const dvec_t* a, const vec_t* offset) {
+    dvec_t res = {
+        .x = a->x + offset->x,
+        .y = a->y + offset->y,
+        .z = a->z + offset->z
+    };
+    return res;
+}
+
+vec_t
+DVec_Relative(const dvec_t* p, const dvec_t* origin) {
+    vec_t res = {
+        .x = (float) (p->x - origin->x),
+        .y = (float) (p->y - origin->y),
+        .z = (float) (p->z - origin->z)
+    };
+    return res;
+}
+
+world_transform_t
+WorldTransform_Identity(void) {
+    world_transform_t res = {
+        .translation = { 0.0, 0.0, 0.0 },
+        .rotation = Quat_Identity(),
+        .scale = { 1.0f, 1.0f, 1.0f }
+    };
+    return res;
+}
+
+transform_t
+WorldTransform_Relative(const world_transform_t* t, const dvec_t* origin) {
+    transform_t res = {
+        .translation = DVec_Relative(&t->translation, origin),
+        .rotation = t->rotation,
+        .scale = t->scale
+    };
+    return res;
+}
+
+mat4_t
+WorldTransform_ToMat4(const world_transform_t* t, const dvec_t* origin) {
+    const transform_t rel = WorldTransform_Relative(t, origin);
+    return Transform_ToMat4(&rel);
+}
+
+mat4_t
+World_ViewMatrix(const dvec_t* eye, const dvec_t* target, vec_t up) {
+    const vec_t zero = { 0.0f, 0.0f, 0.0f };
+    return Mat4_LookAt(zero, DVec_Relative(target, eye), up);
+}
+
+mat4_t
+World_ModelViewMatrix(
+    const world_transform_t* t,
+    const dvec_t* eye,
+    const dvec_t* target,
+    vec_t up) {
+    const mat4_t model = WorldTransform_ToMat4(t, eye);
+    const mat4_t view = World_ViewMatrix(eye, target, up);
+    return M_MultiplyMat4Affine(&view, &model);
+}
@@ -0,0 +1,162 @@
+/**
+ * File: c_world.h
+ * Description: Double precision world positions and the camera-relative
+ * rebasing step that turns them into float matrices for the GPU.
+ *
+ * Float positions only keep about 7 significant digits, so a few kilometres
+ * from the origin vertices snap to a visibly coarse grid and the camera
+ * jitters. Positions are kept in double on the CPU instead, and everything is
+ * rebased on the camera position before converting to float, so the values
+ * reaching the GPU stay small no matter where in the world the camera is.
+ */
+#ifndef WORLD_H_
+#define WORLD_H_
+
+#include "c_math.h"
+#include "c_quat.h"
+
+/**
+ * @struct dvec_t
+ * @brief World position in double precision.
+ */
+typedef struct dvec_t {
+    /**
+     * @brief X value of the position.
+     */
+    double x;
+
+    /**
+     * @brief Y value of the position.
+     */
+    double y;
+
+    /**
+     * @brief Z value of the position.
+     */
+    double z;
+} dvec_t;
+
+/**
+ * @struct world_transform_t
+ * @brief transform_t with a double precision translation. Rotation and scale
+ * do not depend on the distance from the origin so they stay float.
+ */
+typedef struct world_transform_t {
+    /**
+     * @brief World position.
+     */
+    dvec_t translation;
+
+    /**
+     * @brief Rotation.
+     */
+    quat_t rotation;
+
+    /**
+     * @brief Per-axis scale.
+     */
+    vec_t scale;
+} world_transform_t;
+
+/**
+ * @brief Widen a float vector to a world position
+ * @param v The vector
+ * @return The world position
+ */
+dvec_t
+DVec_FromVec(const vec_t* v);
+
+/**
+ * @brief Add two world positions
+ * @param a The first position
+ * @param b The second position
+ * @return a + b
+ */
+dvec_t
+DVec_Add(const dvec_t* a, const dvec_t* b);
+
+/**
+ * @brief Subtract two world positions
+ * @param a The first position
+ * @param b The second position
+ * @return a - b
+ */
+dvec_t
+DVec_Subtract(const dvec_t* a, const dvec_t* b);
+
+/**
+ * @brief Offset a world position by a float vector, e.g. a velocity step
+ * @param a The position
+ * @param offset The offset
+ * @return a + offset
+ */
+dvec_t
+DVec_AddVec(const dvec_t* a, const vec_t* offset);
+
+/**
+ * @brief Get a position relative to an origin as float. The subtraction is
+ * done in double, so the result is exact to float precision as long as the
+ * position is near the origin.
+ * @param p The world position
+ * @param origin The origin, usually the camera position
+ * @return p - origin as float
+ */
+vec_t
+DVec_Relative(const dvec_t* p, const dvec_t* origin);
+
+/**
+ * @brief Return the identity world transform
+ * @return The identity transform at the world origin
+ */
+world_transform_t
+WorldTransform_Identity(void);
+
+/**
+ * @brief Get the float transform relative to an origin
+ * @param t The world transform
+ * @param origin The origin, usually the camera position
+ * @return The transform with its translation rebased on the origin
+ */
+transform_t
+WorldTransform_Relative(const world_transform_t* t, const dvec_t* origin);
+
+/**
+ * @brief Build the model matrix relative to an origin, for use with a view
+ * matrix from World_ViewMatrix with the same origin
+ * @param t The world transform
+ * @param origin The origin, usually the camera position
+ * @return The camera-relative model matrix
+ */
+mat4_t
+WorldTransform_ToMat4(const world_transform_t* t, const dvec_t* origin);
+
+/**
+ * @brief Build a look-at view matrix for a camera placed at the rebasing
+ * origin. The result only rotates, since the camera translation is already
+ * folded into every camera-relative model matrix.
+ * @param eye The camera position, also the rebasing origin
+ * @param target The point to look at
+ * @param up The up direction
+ * @return The view matrix
+ */
+mat4_t
+World_ViewMatrix(const dvec_t* eye, const dvec_t* target, vec_t up);
+
+/**
+ * @brief Build the model-view matrix of an object seen from a camera. Both
+ * matrices are built camera-relative, so no large translations are formed
+ * in float.
+ * @param t The world transform of the object
+ * @param eye The camera position
+ * @param target The point the camera looks at
+ * @param up The up direction
+ * @return view * model
+ */
+mat4_t
+World_ModelViewMatrix(
+    const world_transform_t* t,
+    const dvec_t* eye,
+    const dvec_t* target,
+    vec_t up);
+
+#endif // WORLD_H_
@@ -1,27 +1,60 @@
 #include "g_clock.h"
 
+void
+G_ClockInit(Clock* clock, double physFreq, double renderFreq) {
+    *clock = (Clock) { 0 };
+    clock->physFreq = physFreq;
+    clock->renderFreq = renderFreq;
+    clock->fpsFreq = CGAME_FPS_FREQ;
+    clock->physMaxSteps = CGAME_CLOCK_MAX_STEPS;
+    G_ClockReset(clock);
+}
+
 void
 G_ClockUpdate(Clock* clock) {
+    const Uint64 now = SDL_GetTicksNS();
+    if (!clock->startNs) {
+        clock->startNs = now;
+        clock->lastNs = now;
+    }
+
+    // keep time in integer nanoseconds, and only convert for the fields
+    // read by the rest of the game
+    const Uint64 elapsed = now - clock->lastNs;
+    clock->lastNs = now;
+
     clock->prevTime = clock->currTime;
-    clock->currTime = SDL_GetTicks();
+    clock->currTime = (double) (now - clock->startNs) / SDL_NS_PER_SECOND;
     clock->deltaTime = clock->currTime - clock->prevTime;
 
-    clock->physTick = ((float)(clock->currTime - clock->physTime) > (1.0f / clock->physFreq));
-    clock->renderTick = ((float)(clock->currTime - clock->renderTime) > (1.0f / clock->renderFreq));
-    clock->fpsTick = ((float)(clock->currTime - clock->fpsTime) > (1.0f / 1000.0f));
+    // take whole steps out of the accumulator, keeping the remainder
+    clock->physSteps = 0;
+    if (clock->physStepNs) {
+        clock->physAccumulatorNs += elapsed;
+        Uint64 steps = clock->physAccumulatorNs / clock->physStepNs;
+        clock->physAccumulatorNs -= steps * clock->physStepNs;
 
-    // update physics tick
-    if (clock->physTick) {
-        clock->physDelta = clock->currTime - clock->physTime;
-        clock->physTime = clock->currTime;
+        if (steps > (Uint64) clock->physMaxSteps) {
+            clock->physDropped += steps - clock->physMaxSteps;
+            steps = clock->physMaxSteps;
+        }
+        clock->physSteps = (int) steps;
+        clock->physTime += steps * clock->physDelta;
+        clock->alpha = (double) clock->physAccumulatorNs / clock->physStepNs;
     }
-    
+    clock->physTick = clock->physSteps > 0;
+
+    clock->renderTick = clock->renderFreq <= 0.0
+        || clock->currTime - clock->renderTime >= 1.0 / clock->renderFreq;
+    clock->fpsTick = clock->fpsFreq > 0.0
+        && clock->currTime - clock->fpsTime >= 1.0 / clock->fpsFreq;
+
     // update render tick
     if (clock->renderTick) {
         clock->renderDelta = clock->currTime - clock->renderTime;
         clock->renderTime = clock->currTime;
     }
-    
+
     // update fps tick
     if (clock->fpsTick) {
         clock->fpsDelta = clock->currTime - clock->fpsTime;
@@ -29,19 +62,36 @@ G_ClockUpdate(Clock* clock) {
     }
 }
 
+double
+G_ClockRenderTime(const Clock* clock) {
+    return clock->physStepNs
+        ? clock->physTime - (1.0 - clock->alpha) * clock->physDelta
+        : clock->currTime;
+}
+
 void
 G_ClockReset(Clock* clock) {
     // reset all values in the clock
+    clock->startNs = 0;
+    clock->lastNs = 0;
     clock->currTime = 0.0;
     clock->prevTime = 0.0;
     clock->deltaTime = 0.0;
+    clock->physAccumulatorNs = 0;
+    clock->physTime = 0.0;
+    clock->physSteps = 0;
+    clock->physDropped = 0;
+    clock->alpha = 0.0;
     clock->physTick = 0;
     clock->renderTick = 0;
     clock->fpsTick = 0;
-    clock->physTime = 0.0;
     clock->renderTime = 0.0;
     clock->fpsTime = 0.0;
-    clock->physDelta = 0.0;
     clock->renderDelta = 0.0;
     clock->fpsDelta = 0.0;
-}
\ No newline at end of file
+
+    // steps are whole nanoseconds, which drifts by under a nanosecond each
+    clock->physStepNs = clock->physFreq > 0.0
+        ? (Uint64) (SDL_NS_PER_SECOND / clock->physFreq + 0.5) : 0;
+    clock->physDelta = (double) clock->physStepNs / SDL_NS_PER_SECOND;
+}
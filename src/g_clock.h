@@ -3,12 +3,35 @@
 
 #include "SDL3/SDL.h"
 
+/* Physics steps per second the game runs at. */
+#define CGAME_PHYS_FREQ 60.0
+
+/* Frames per second the game renders at. */
+#define CGAME_RENDER_FREQ 60.0
+
+/* FPS ticks per second. */
+#define CGAME_FPS_FREQ 1.0
+
+/* Most physics steps one update runs. Time owed beyond that is dropped, so
+ * a slow frame cannot make the next one slower still. */
+#define CGAME_CLOCK_MAX_STEPS 5
+
 /**
  * @struct clock
  * @brief Represents the game clock.
+ *
+ * Physics runs in fixed steps of physDelta seconds. Each update adds the
+ * elapsed time to an accumulator and takes as many whole steps out of it as
+ * fit, leaving the remainder for the next update.
  */
 typedef struct {
-    /* The current time. */
+    /* SDL_GetTicksNS when the clock started, 0 until the first update. */
+    Uint64 startNs;
+
+    /* SDL_GetTicksNS of the last update. */
+    Uint64 lastNs;
+
+    /* The current time, in seconds since the clock started. */
     double currTime;
 
     /* The previous time. */
@@ -17,25 +40,44 @@ typedef struct {
     /* The difference between the current time and the previous time. */
     double deltaTime;
 
-    /* The last time the physics tick was executed. */
+    /* Elapsed time not yet simulated, less than one step after an update. */
+    Uint64 physAccumulatorNs;
+
+    /* Length of one physics step, 0 if physics is off. */
+    Uint64 physStepNs;
+
+    /* Simulated time, the number of steps taken times their length. */
     double physTime;
 
+    /* Length of one physics step, in seconds. */
+    double physDelta;
+
+    /* Physics steps to run for this update. */
+    int physSteps;
+
+    /* Most physics steps one update may run. */
+    int physMaxSteps;
+
+    /* Steps dropped since the start because an update was owed too many. */
+    Uint64 physDropped;
+
+    /* How far the current time is past the last step, as a fraction of a
+     * step. The renderer blends the state of the last two steps with it. */
+    double alpha;
+
     /* The last time the render tick was executed. */
     double renderTime;
 
     /* The last time the FPS tick was executed. */
     double fpsTime;
 
-    /* The difference between the current time and the last physics tick time. */
-    double physDelta;
-
     /* The difference between the current time and the last render tick time. */
     double renderDelta;
 
     /* The difference between the current time and the last FPS tick time. */
     double fpsDelta;
 
-    /* If the current tick is a physics tick or not. */
+    /* If the current tick has physics steps to run or not. */
     int physTick;
 
     /* If the current tick is a render tick or not. */
@@ -54,6 +96,15 @@ typedef struct {
     double fpsFreq;
 } Clock;
 
+/**
+ * @brief Set up a clock. It starts on its first update.
+ * @param clock The clock object.
+ * @param physFreq Physics steps per second, or 0 for none.
+ * @param renderFreq Frames per second.
+ */
+void
+G_ClockInit(Clock* clock, double physFreq, double renderFreq);
+
 /**
  * @brief Update the provided clock object.
  * @param clock The clock object.
@@ -62,10 +113,19 @@ void
 G_ClockUpdate(Clock* clock);
 
 /**
- * Reset the clock object.
+ * @brief Get the simulated time to draw a frame at: between the last two
+ * physics steps, by alpha. Lags the current time by up to one step.
+ * @param clock The clock object.
+ * @returns The time in seconds.
+ */
+double
+G_ClockRenderTime(const Clock* clock);
+
+/**
+ * Reset the clock object, keeping its frequencies.
  */
 void
 G_ClockReset(Clock* clock);
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,64 @@
+#include "g_event.h"
+#include "c_log.h"
+
+int
+event_queue_create(event_queue* q) {
+    q->front = NULL;
+    q->back = NULL;
+    q->size = 0;
+
+    // events come and go every frame, so nodes are recycled through a pool
+    return C_PoolCreate(
+        &q->nodes, 
+        sizeof(event_node), 
+        EVENT_QUEUE_CHUNK_NODES, 
+        0);
+}
+
+void
+event_queue_destroy(event_queue* q) {
+    C_PoolDestroy(&q->nodes);
+    q->front = NULL;
+    q->back = NULL;
+    q->size = 0;
+}
+
+int
+event_queue_push(event_queue* q, event evt) {
+    event_node* node = C_PoolAlloc(&q->nodes);
+    if (!node) {
+        G_Log("ERROR", "Failed to allocate event node.");
+        return 0;
+    }
+    node->next = NULL;
+    node->event = evt;
+
+    if (q->back) {
+        q->back->next = node;
+    } else {
+        q->front = node;
+    }
+    q->back = node;
+    q->size++;
+
+    return 1;
+}
+
+event*
+event_queue_pop(event_queue* q) {
+    event_node* node = q->front;
+    if (!node) {
+        return NULL;
+    }
+
+    q->front = node->next;
+    if (!q->front) {
+        q->back = NULL;
+    }
+    q->size--;
+
+    q->popped = node->event;
+    C_PoolFree(&q->nodes, node);
+
+    return &q->popped;
+}
@@ -5,9 +5,14 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "c_pool.h"
+
 /** Maximum callbacks for an event type */
 #define EVENT_MAX_SUBSCRIBERS 16
 
+/** Number of event nodes the queue allocates at a time. */
+#define EVENT_QUEUE_CHUNK_NODES 512
+
 /**
  * @brief Event type is just a 64-bit value.
  */
@@ -135,16 +140,41 @@ typedef struct event_queue {
     event_node* back;
     /** Number of used event nodes containing event details. */
     size_t size;
+    /** Pool the event nodes are allocated from. */
+    pool_t nodes;
+    /** Copy of the last popped event, as its node goes back to the pool. */
+    event popped;
 } event_queue;
 
+/**
+ * @brief Initializes an empty event queue.
+ * @param q The event queue.
+ * @return 1 on success, 0 on failure.
+ */
+int
+event_queue_create(event_queue* q);
+
+/**
+ * @brief Releases the event queue and any events still in it.
+ * @param q The event queue.
+ */
+void
+event_queue_destroy(event_queue* q);
+
 /**
  * @brief Inserts an event to the event queue.
  * @param q The event queue.
  * @param evt The event.
+ * @return 1 on success, 0 if no node could be allocated.
  */
-void
+int
 event_queue_push(event_queue* q, event evt);
 
+/**
+ * @brief Removes the event at the front of the queue.
+ * @param q The event queue.
+ * @return The event, valid until the next pop, or NULL if the queue is empty.
+ */
 event*
 event_queue_pop(event_queue* q);
 
@@ -0,0 +1,227 @@
+#include "g_framestats.h"
+#include "c_log.h"
+
+#include <math.h>
+
+#define FRAME_STATS_SUB (1u << CGAME_FRAME_STATS_SUB_BITS)
+
+/* Histogram buckets covering every Uint32 number of nanoseconds. */
+#define FRAME_STATS_BUCKETS \
+    ((32 - CGAME_FRAME_STATS_SUB_BITS + 1) * FRAME_STATS_SUB)
+
+/* Timings of one frame, in nanoseconds. */
+typedef struct {
+    /* Frame number plus one once written, 0 while it is being written. */
+    SDL_AtomicU32 sequence;
+
+    SDL_AtomicU32 frame_ns;
+    SDL_AtomicU32 cpu_ns;
+    SDL_AtomicU32 present_ns;
+} frame_slot_t;
+
+/* One timing over a window being summed up. A window holds at most
+ * CGAME_FRAME_STATS_RING_SIZE frames, which the counts must fit. */
+typedef struct {
+    Uint16 counts[FRAME_STATS_BUCKETS];
+    Uint32 min;
+    Uint32 max;
+    double mean;
+    double m2;
+} frame_accumulator_t;
+
+/* Written by the recording thread only, read by any. */
+static frame_slot_t ring[CGAME_FRAME_STATS_RING_SIZE];
+static SDL_AtomicU32 recorded;
+
+/* Recording thread only. */
+static Uint64 last_record_ns;
+
+/* Frames recorded at the last G_FrameStatsLog, which is only called from
+ * one thread. */
+static Uint32 last_logged;
+
+static Uint32
+G_FrameStatsClamp(Uint64 ns) {
+    return ns > 0xffffffffu ? 0xffffffffu : (Uint32) ns;
+}
+
+/* Bucket of a value: exact below FRAME_STATS_SUB, then FRAME_STATS_SUB
+ * buckets for each power of two. */
+static Uint32
+G_FrameStatsBucket(Uint32 ns) {
+    if (ns < FRAME_STATS_SUB) {
+        return ns;
+    }
+    const int shift
+        = SDL_MostSignificantBitIndex32(ns) - CGAME_FRAME_STATS_SUB_BITS;
+    return (Uint32) (shift + 1) * FRAME_STATS_SUB
+        + ((ns >> shift) & (FRAME_STATS_SUB - 1));
+}
+
+/* Middle of the values that fall in a bucket. */
+static double
+G_FrameStatsBucketValue(Uint32 bucket) {
+    if (bucket < FRAME_STATS_SUB) {
+        return bucket;
+    }
+    const Uint32 shift = bucket / FRAME_STATS_SUB - 1;
+    const double lower
+        = (double) ((bucket % FRAME_STATS_SUB + FRAME_STATS_SUB) << shift);
+    return lower + (double) (1u << shift) / 2.0;
+}
+
+static void
+G_FrameStatsAdd(frame_accumulator_t* acc, Uint32 n, Uint32 ns) {
+    acc->counts[G_FrameStatsBucket(ns)]++;
+    if (n == 1 || ns < acc->min) {
+        acc->min = ns;
+    }
+    if (n == 1 || ns > acc->max) {
+        acc->max = ns;
+    }
+
+    // Welford, which stays accurate where summing squares would not
+    const double delta = ns - acc->mean;
+    acc->mean += delta / n;
+    acc->m2 += delta * (ns - acc->mean);
+}
+
+/* Value below which a fraction p of the window falls, in nanoseconds. */
+static double
+G_FrameStatsPercentile(const frame_accumulator_t* acc, Uint32 n, double p) {
+    const double exact = p * n;
+    Uint32 rank = (Uint32) exact;
+    if (rank < exact || rank == 0) {
+        rank++;
+    }
+
+    Uint32 seen = 0;
+    for (Uint32 i = 0; i < FRAME_STATS_BUCKETS; i++) {
+        seen += acc->counts[i];
+        if (seen >= rank) {
+            // the ends of the window are known exactly
+            const double value = G_FrameStatsBucketValue(i);
+            return value < acc->min ? acc->min
+                : value > acc->max ? acc->max : value;
+        }
+    }
+    return acc->max;
+}
+
+static void
+G_FrameStatsMetric(
+    const frame_accumulator_t* acc,
+    Uint32 n,
+    frame_metric_t* out
+) {
+    const double ms = 1.0 / SDL_NS_PER_MS;
+    out->min = acc->min * ms;
+    out->max = acc->max * ms;
+    out->mean = acc->mean * ms;
+    out->stddev = sqrt(acc->m2 / n) * ms;
+    out->p50 = G_FrameStatsPercentile(acc, n, 0.5) * ms;
+    out->p95 = G_FrameStatsPercentile(acc, n, 0.95) * ms;
+    out->p99 = G_FrameStatsPercentile(acc, n, 0.99) * ms;
+    out->p999 = G_FrameStatsPercentile(acc, n, 0.999) * ms;
+}
+
+void
+G_FrameStatsRecord(Uint64 work_ns, Uint64 present_ns) {
+    const Uint64 now = SDL_GetTicksNS();
+    const Uint64 frame_ns = last_record_ns ? now - last_record_ns : work_ns;
+    last_record_ns = now;
+
+    const Uint32 index = SDL_GetAtomicU32(&recorded);
+    frame_slot_t* slot = &ring[index & (CGAME_FRAME_STATS_RING_SIZE - 1)];
+
+    // readers drop the slot if its sequence changed while they read it
+    SDL_SetAtomicU32(&slot->sequence, 0);
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicU32(&slot->frame_ns, G_FrameStatsClamp(frame_ns));
+    SDL_SetAtomicU32(&slot->cpu_ns, G_FrameStatsClamp(
+        work_ns > present_ns ? work_ns - present_ns : 0));
+    SDL_SetAtomicU32(&slot->present_ns, G_FrameStatsClamp(present_ns));
+    SDL_MemoryBarrierRelease();
+    SDL_SetAtomicU32(&slot->sequence, index + 1);
+    SDL_SetAtomicU32(&recorded, index + 1);
+}
+
+Uint32
+G_FrameStatsWindow(Uint32 frames, frame_stats_t* out) {
+    *out = (frame_stats_t) { 0 };
+
+    const Uint32 count = SDL_GetAtomicU32(&recorded);
+    SDL_MemoryBarrierAcquire();
+    if (frames > count) {
+        frames = count;
+    }
+    if (frames > CGAME_FRAME_STATS_RING_SIZE) {
+        frames = CGAME_FRAME_STATS_RING_SIZE;
+    }
+
+    frame_accumulator_t frame = { { 0 } };
+    frame_accumulator_t cpu = { { 0 } };
+    frame_accumulator_t present = { { 0 } };
+    Uint32 n = 0;
+
+    for (Uint32 i = count - frames; i != count; i++) {
+        frame_slot_t* slot = &ring[i & (CGAME_FRAME_STATS_RING_SIZE - 1)];
+
+        if (SDL_GetAtomicU32(&slot->sequence) != i + 1) {
+            continue;
+        }
+        SDL_MemoryBarrierAcquire();
+        const Uint32 frame_ns = SDL_GetAtomicU32(&slot->frame_ns);
+        const Uint32 cpu_ns = SDL_GetAtomicU32(&slot->cpu_ns);
+        const Uint32 present_ns = SDL_GetAtomicU32(&slot->present_ns);
+        SDL_MemoryBarrierAcquire();
+        if (SDL_GetAtomicU32(&slot->sequence) != i + 1) {
+            continue;
+        }
+
+        n++;
+        G_FrameStatsAdd(&frame, n, frame_ns);
+        G_FrameStatsAdd(&cpu, n, cpu_ns);
+        G_FrameStatsAdd(&present, n, present_ns);
+    }
+
+    if (n) {
+        out->frames = n;
+        G_FrameStatsMetric(&frame, n, &out->frame);
+        G_FrameStatsMetric(&cpu, n, &out->cpu);
+        G_FrameStatsMetric(&present, n, &out->present);
+    }
+    return n;
+}
+
+void
+G_FrameStatsLog(Uint32 frames) {
+    const Uint32 count = SDL_GetAtomicU32(&recorded);
+    if (!frames) {
+        frames = count - last_logged;
+    }
+    last_logged = count;
+
+    frame_stats_t stats;
+    if (!G_FrameStatsWindow(frames, &stats)) {
+        return;
+    }
+
+    #define FRAME_STATS_FORMAT \
+        "%.2f ms (sd %.2f, min %.2f, p50 %.2f, p95 %.2f, p99 %.2f, " \
+        "p99.9 %.2f, max %.2f)"
+    #define FRAME_STATS_ARGS(m) \
+        (m).mean, (m).stddev, (m).min, (m).p50, (m).p95, (m).p99, \
+        (m).p999, (m).max
+
+    G_LogInfo("frame",
+        "%u frames. Frame " FRAME_STATS_FORMAT ", cpu " FRAME_STATS_FORMAT
+        ", present " FRAME_STATS_FORMAT ".",
+        (unsigned int) stats.frames,
+        FRAME_STATS_ARGS(stats.frame),
+        FRAME_STATS_ARGS(stats.cpu),
+        FRAME_STATS_ARGS(stats.present));
+
+    #undef FRAME_STATS_FORMAT
+    #undef FRAME_STATS_ARGS
+}
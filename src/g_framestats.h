@@ -0,0 +1,76 @@
+#ifndef FRAMESTATS_H_
+#define FRAMESTATS_H_
+
+#include "SDL3/SDL.h"
+
+/* Frames kept for the statistics, a power of two. Also the longest window
+ * they can be taken over. */
+#define CGAME_FRAME_STATS_RING_SIZE 4096
+
+/* Set to 1 to log the statistics of the frames since the last line on
+ * every FPS tick. A summary is logged when the game stops either way. */
+#define CGAME_FRAME_STATS_LOG 0
+
+/* Sub-buckets per power of two in the histograms, as a power of two. 5
+ * puts percentiles within about 3% of the true value. */
+#define CGAME_FRAME_STATS_SUB_BITS 5
+
+/* Statistics of one timing over a window, in milliseconds. Percentiles
+ * come from a log-linear histogram and are approximate; the rest are
+ * exact. */
+typedef struct {
+    double min;
+    double max;
+    double mean;
+    double stddev;
+
+    double p50;
+    double p95;
+    double p99;
+    double p999;
+} frame_metric_t;
+
+/* Statistics of the last frames. */
+typedef struct {
+    /* Frames the window covers. */
+    Uint32 frames;
+
+    /* Start of one frame to the start of the next, pacing included. */
+    frame_metric_t frame;
+
+    /* Time the frame kept the CPU busy, less the present wait. */
+    frame_metric_t cpu;
+
+    /* Time blocked on the GPU and the swapchain, in the fence wait, image
+     * acquire and present. */
+    frame_metric_t present;
+} frame_stats_t;
+
+/**
+ * Record the timings of a frame. Call once per frame, from one thread, at
+ * the same point of each frame. Never blocks; readers may be on other
+ * threads.
+ * @param work_ns Time from the start of the frame until now.
+ * @param present_ns The part of work_ns spent waiting to present.
+ */
+void
+G_FrameStatsRecord(Uint64 work_ns, Uint64 present_ns);
+
+/**
+ * Get the statistics of the last frames. Thread safe; frames overwritten
+ * while they are read are left out.
+ * @param frames Frames to cover, at most CGAME_FRAME_STATS_RING_SIZE.
+ * @param out The statistics.
+ * @returns Frames covered, 0 if none have been recorded.
+ */
+Uint32
+G_FrameStatsWindow(Uint32 frames, frame_stats_t* out);
+
+/**
+ * Log the statistics of the last frames in one line.
+ * @param frames Frames to cover, or 0 for those since the last call.
+ */
+void
+G_FrameStatsLog(Uint32 frames);
+
+#endif // FRAMESTATS_H_
@@ -2,6 +2,11 @@
 
 #include "g_game.h"
 #include "c_log.h"
+#include "c_arena.h"
+#include "c_memory.h"
+#include "r_vkalloc.h"
+#include "r_vkdebug.h"
+#include "g_framestats.h"
 
 #define VEC_IMPL_H_
 #include "r_render.h"
@@ -26,53 +31,6 @@ S_CreateDebugUtilsMessengerEXT(
     }
 }
 
-/* Debugging message callback for vulkan */
-VKAPI_ATTR VkBool32 VKAPI_CALL R_CoreVulkanDebugCallback(
-    VkDebugUtilsMessageSeverityFlagBitsEXT msg_severity,
-    VkDebugUtilsMessageTypeFlagsEXT msg_type,
-    const VkDebugUtilsMessengerCallbackDataEXT* callback,
-    void* user_data) {
-
-    #define MSG_MAX 4096
-
-    char msg[MSG_MAX] = { 0 };
-    
-    // Start with the main message
-    int offset = snprintf(
-        msg, 
-        MSG_MAX,
-        "%s\n", 
-        callback->pMessage);
-    
-    // Concatenate object information
-    if (callback->objectCount > 0) {
-        offset += snprintf(
-            msg + offset, 
-            MSG_MAX - offset,
-            "=== Vulkan Objects ===\n"
-        );
-        for (Uint32 i = 0; i < callback->objectCount && offset < MSG_MAX; i++) {
-            const VkDebugUtilsObjectNameInfoEXT* obj = &callback->pObjects[i];
-            
-            offset += snprintf(msg + offset, MSG_MAX - offset, 
-                "Object[%u]: Type=%d, Handle=0x%lx, Name=%s\n",
-                i,
-                obj->objectType,
-                (unsigned long)obj->objectHandle,
-                obj->pObjectName ? obj->pObjectName : "unnamed");
-        }
-    }
-    
-    // Log the complete message
-    if (msg_severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
-        G_Log("VULKAN_ERROR", msg);
-    } else {
-        G_Log("VULKAN", msg);
-    }
-    
-    return VK_FALSE;
-}
-
 void 
 S_DestroyDebugUtilsMessengerEXT(
     VkInstance instance, 
@@ -90,10 +48,33 @@ S_DestroyDebugUtilsMessengerEXT(
 int
 G_Init(game_t* game) {
 
-    G_Log("INFO", "Initializing game.");
+    // track every allocation; must happen before anything calls into SDL,
+    // logging included
+    if (!C_MemInstall()) {
+        return 0;
+    }
+    C_MemSetTag("init");
+
+    // from here on log messages are written by a thread of their own
+    G_LogStart(CGAME_LOG_OVERFLOW);
+
+    G_LogInfo("game", "Initializing game.");
 
     game->running = 0;
 
+    // scratch memory for short-lived allocations, used from here on. it is
+    // reserved up front and committed in huge pages as it fills
+    if (!C_ArenaReserve(
+        C_MainArena(), 
+        CGAME_ARENA_INIT_SIZE, 
+        CGAME_ARENA_GROW_SIZE,
+        CGAME_ARENA_HUGE_PAGES | CGAME_ARENA_DECOMMIT_ON_RESET)) {
+        return 0;
+    }
+
+    // select the math kernels for this cpu
+    M_InitSimd();
+
     // initialize sdl
     const SDL_InitFlags init_flags = SDL_INIT_VIDEO | SDL_INIT_EVENTS;
 
@@ -110,21 +91,24 @@ G_Init(game_t* game) {
         return 0;
     }
 
-    game->clock = (Clock) { 0 };
+    G_ClockInit(&game->clock, CGAME_PHYS_FREQ, CGAME_RENDER_FREQ);
+    G_PacerInit(&game->pacer, game->clock.renderFreq);
 
-    /* Setup debug message callback */
+    /* Setup debug message callback. It is subscribed to every severity,
+     * and drops those below VKH_SetDebugSeverity itself */
     VkDebugUtilsMessengerCreateInfoEXT debug_create_info = { 0 };
     debug_create_info.sType 
         = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
     debug_create_info.messageSeverity 
         = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT 
+        | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
         | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT 
         | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
     debug_create_info.messageType 
         = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT 
         | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT 
         | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
-    debug_create_info.pfnUserCallback = R_CoreVulkanDebugCallback;
+    debug_create_info.pfnUserCallback = VKH_DebugCallback;
     debug_create_info.pUserData = NULL; // Optional
 
     /* create render state */
@@ -136,7 +120,7 @@ G_Init(game_t* game) {
     if (S_CreateDebugUtilsMessengerEXT(
         game->render_state.vk.instance,
         &debug_create_info,
-        NULL,
+        VKH_Allocator(),
         &game->debug_messenger
     ) != VK_SUCCESS) {
         G_Log("ERROR", "Failed to create debug messenger.");
@@ -149,36 +133,108 @@ G_Init(game_t* game) {
     return 1;
 }
 
+/* Take the events of this frame off the queue. They are kept in the frame
+ * arena so anything in the frame can read them. */
+static void
+G_PollEvents(game_t* game) {
+    SDL_PumpEvents();
+    game->events = NULL;
+    game->event_count = SDL_PeepEvents(
+        NULL, 0, SDL_PEEKEVENT, SDL_EVENT_FIRST, SDL_EVENT_LAST);
+    if (game->event_count > 0) {
+        game->events = C_ArenaNew(
+            R_FrameArena(&game->render_state), 
+            SDL_Event, 
+            game->event_count);
+    }
+
+    if (game->events) {
+        game->event_count = SDL_PeepEvents(
+            game->events, 
+            game->event_count, 
+            SDL_GETEVENT, 
+            SDL_EVENT_FIRST, 
+            SDL_EVENT_LAST);
+    } else {
+        // out of scratch memory; still drain the queue so quitting works
+        game->event_count = 0;
+        SDL_Event evt;
+        while (SDL_PollEvent(&evt)) {
+            if (evt.type == SDL_EVENT_QUIT) {
+                game->running = 0;
+            }
+        }
+    }
+
+    for (int i = 0; i < game->event_count; i++) {
+        if (game->events[i].type == SDL_EVENT_QUIT) {
+            game->running = 0;
+        }
+    }
+}
+
 void
 G_Start(game_t* game) {
+    C_MemSetTag("frame");
+
     while (game->running) {
-        /* Update the game clock */
+        const Uint64 frame_start = SDL_GetTicksNS();
+
+        /* Wait for the frame's resources, which frees its scratch memory */
+        R_BeginFrame(&game->render_state);
+
+        /* Poll events */
+        G_PollEvents(game);
+
+        /* Update the game clock. The simulation, once there is one, runs
+         * clock.physSteps fixed steps here */
         G_ClockUpdate(&game->clock);
 
         /* Render frame */
         R_Draw(&game->render_state, &game->clock);
 
-        /** Poll events */
-        SDL_Event evt;
-        while (SDL_PollEvent(&evt)) {
-            if (evt.type == SDL_EVENT_QUIT) {
-                game->running = 0;
-            }
+        /* Check the frame against the allocation budget */
+        C_MemEndFrame();
+
+        /* Time the frame, less the pacing below */
+        G_FrameStatsRecord(
+            SDL_GetTicksNS() - frame_start,
+            game->render_state.wait_ns);
+        if (CGAME_FRAME_STATS_LOG && game->clock.fpsTick) {
+            G_FrameStatsLog(0);
         }
+
+        /* Sleep off the rest of the frame rather than spin a core */
+        G_PacerWait(&game->pacer);
     }
 }
 
 void 
 G_Stop(game_t* game) {
-    G_Log("INFO", "Stopping game.");
+    G_LogInfo("game", "Stopping game.");
+    C_MemSetTag("shutdown");
 
     vkDeviceWaitIdle(game->render_state.vk.device);
 
     if (enable_validation_layers) {
         S_DestroyDebugUtilsMessengerEXT(
-            game->render_state.vk.instance, game->debug_messenger, NULL);
+            game->render_state.vk.instance, 
+            game->debug_messenger, 
+            VKH_Allocator());
+        VKH_LogDebugSummary();
     }
 
+    G_PacerReport(&game->pacer);
+    G_FrameStatsLog(CGAME_FRAME_STATS_RING_SIZE);
+
     R_DestroyRenderState(&game->render_state);
     G_DestroyWindow(&game->window);
+
+    C_ArenaDestroy(C_MainArena());
+
+    // write out what is queued and join the writer before checking for leaks
+    G_LogStop();
+
+    // everything the game allocated should be gone by now
+    C_MemReport();
 }
\ No newline at end of file
@@ -13,6 +13,7 @@
 
 #include "g_window.h"
 #include "g_clock.h"
+#include "g_pacer.h"
 
 #define VEC_IMPL_H_
 #include "r_render.h"
@@ -26,10 +27,17 @@ typedef struct game_t {
 
     Clock clock;
 
+    pacer_t pacer;
+
     int running;
 
     R_RenderState render_state;
 
+    /* Events polled this frame, in the frame arena, and their count. Valid
+     * until the frame is drawn. */
+    SDL_Event* events;
+    int event_count;
+
     VkDebugUtilsMessengerEXT debug_messenger;
     
 } game_t;
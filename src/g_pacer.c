@@ -0,0 +1,138 @@
+/* clock_nanosleep is an extension to strict c99 headers */
+#define _DEFAULT_SOURCE
+
+#include "g_pacer.h"
+#include "c_log.h"
+
+#if defined(__unix__)
+  #include <errno.h>
+  #include <time.h>
+  #define PACER_NANOSLEEP 1
+#else
+  #define PACER_NANOSLEEP 0
+#endif
+
+/* Sleep for about ns nanoseconds. Spinning covers the last stretch, so this
+ * uses the plain sleep of the platform; SDL_DelayPrecise would spin the
+ * last millisecond itself. */
+static void
+G_PacerSleep(Uint64 ns) {
+#if PACER_NANOSLEEP
+    struct timespec t = {
+        (time_t) (ns / SDL_NS_PER_SECOND),
+        (long) (ns % SDL_NS_PER_SECOND)
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, 0, &t, &t) == EINTR) {
+    }
+#else
+    SDL_DelayNS(ns);
+#endif
+}
+
+/* Size the spin from how late a sleep woke up. */
+static void
+G_PacerCalibrate(pacer_t* pacer, Uint64 late_ns) {
+    const Uint64 decayed = pacer->oversleep_ns - pacer->oversleep_ns / 16;
+    pacer->oversleep_ns = late_ns > decayed ? late_ns : decayed;
+
+    Uint64 spin = pacer->oversleep_ns + CGAME_PACER_SPIN_SLACK_NS;
+    if (spin < CGAME_PACER_MIN_SPIN_NS) {
+        spin = CGAME_PACER_MIN_SPIN_NS;
+    }
+    if (spin > CGAME_PACER_MAX_SPIN_NS) {
+        spin = CGAME_PACER_MAX_SPIN_NS;
+    }
+    pacer->spin_ns = spin;
+}
+
+void
+G_PacerInit(pacer_t* pacer, double freq) {
+    *pacer = (pacer_t) { 0 };
+    pacer->spin_ns = CGAME_PACER_SPIN_NS;
+    G_PacerSetRate(pacer, freq);
+}
+
+void
+G_PacerSetRate(pacer_t* pacer, double freq) {
+    pacer->period_ns = freq > 0.0
+        ? (Uint64) (SDL_NS_PER_SECOND / freq + 0.5) : 0;
+    pacer->deadline_ns = 0;
+}
+
+void
+G_PacerWait(pacer_t* pacer) {
+    if (!pacer->period_ns) {
+        return;
+    }
+
+    Uint64 now = SDL_GetTicksNS();
+
+    // the first frame sets the phase
+    if (!pacer->deadline_ns) {
+        pacer->deadline_ns = now + pacer->period_ns;
+        return;
+    }
+
+    const Uint64 deadline = pacer->deadline_ns;
+    if (now >= deadline) {
+        // running behind, start over from here rather than rush frames
+        pacer->missed++;
+        pacer->deadline_ns = now + pacer->period_ns;
+        return;
+    }
+
+    // sleep for the bulk of the wait
+    if (deadline - now > pacer->spin_ns) {
+        const Uint64 wake = deadline - pacer->spin_ns;
+        G_PacerSleep(wake - now);
+
+        const Uint64 woke = SDL_GetTicksNS();
+        pacer->sleep_ns += woke - now;
+        G_PacerCalibrate(pacer, woke > wake ? woke - wake : 0);
+        now = woke;
+    }
+
+    // and spin the rest, which lands within a microsecond or so
+    const Uint64 spin_start = now;
+    while (now < deadline) {
+        SDL_CPUPauseInstruction();
+        now = SDL_GetTicksNS();
+    }
+    pacer->spin_total_ns += now - spin_start;
+
+    const Uint64 overshoot = now - deadline;
+    pacer->overshoot_ns = overshoot;
+    pacer->total_overshoot_ns += overshoot;
+    if (overshoot > pacer->max_overshoot_ns) {
+        pacer->max_overshoot_ns = overshoot;
+    }
+    pacer->frames++;
+
+    // a sleep that overslept by a whole frame moves the phase
+    pacer->deadline_ns = deadline + pacer->period_ns;
+    if (pacer->deadline_ns <= now) {
+        pacer->deadline_ns = now + pacer->period_ns;
+    }
+}
+
+void
+G_PacerReport(const pacer_t* pacer) {
+    if (!pacer->period_ns) {
+        return;
+    }
+
+    const double us = 1.0 / SDL_NS_PER_US;
+    G_LogInfo("pacer",
+        "%llu frames at %.2f Hz, %llu missed their deadline. Overshoot "
+        "%.1f us mean, %.1f us worst, %.1f us last. Slept %.1f ms, spun "
+        "%.1f ms, spinning %.1f us before each deadline.",
+        (unsigned long long) pacer->frames,
+        (double) SDL_NS_PER_SECOND / pacer->period_ns,
+        (unsigned long long) pacer->missed,
+        pacer->frames ? pacer->total_overshoot_ns * us / pacer->frames : 0.0,
+        pacer->max_overshoot_ns * us,
+        pacer->overshoot_ns * us,
+        pacer->sleep_ns * us / 1000.0,
+        pacer->spin_total_ns * us / 1000.0,
+        pacer->spin_ns * us);
+}
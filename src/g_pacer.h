@@ -0,0 +1,85 @@
+#ifndef PACER_H_
+#define PACER_H_
+
+#include "SDL3/SDL.h"
+
+/* Time spun before a frame deadline until the pacer has measured how late
+ * its sleeps wake up, in nanoseconds. */
+#define CGAME_PACER_SPIN_NS 1000000u
+
+/* Bounds of the calibrated spin, in nanoseconds. */
+#define CGAME_PACER_MIN_SPIN_NS 50000u
+#define CGAME_PACER_MAX_SPIN_NS 4000000u
+
+/* Spin added on top of the worst recent oversleep, in nanoseconds. */
+#define CGAME_PACER_SPIN_SLACK_NS 100000u
+
+/**
+ * Holds the frame rate to a target. Each wait sleeps until shortly before
+ * the deadline of the frame and spins the rest of the way, with the spin
+ * sized from how late recent sleeps woke up.
+ */
+typedef struct pacer_t {
+
+    /* Length of a frame, 0 to not pace. */
+    Uint64 period_ns;
+
+    /* SDL_GetTicksNS the current frame should end at, 0 before the first. */
+    Uint64 deadline_ns;
+
+    /* Time spun before each deadline. */
+    Uint64 spin_ns;
+
+    /* Worst recent oversleep, decaying by 1/16 each frame. */
+    Uint64 oversleep_ns;
+
+    /* Frames waited for, and frames that were already past their deadline
+     * and did not wait. */
+    Uint64 frames;
+    Uint64 missed;
+
+    /* How far past its deadline the last wait returned, and the worst and
+     * summed over every wait. */
+    Uint64 overshoot_ns;
+    Uint64 max_overshoot_ns;
+    Uint64 total_overshoot_ns;
+
+    /* Time spent sleeping and spinning. */
+    Uint64 sleep_ns;
+    Uint64 spin_total_ns;
+
+} pacer_t;
+
+/**
+ * Set up a pacer.
+ * @param pacer The pacer.
+ * @param freq Frames per second, or 0 to not pace.
+ */
+void
+G_PacerInit(pacer_t* pacer, double freq);
+
+/**
+ * Change the target rate. Takes effect from the next frame.
+ * @param pacer The pacer.
+ * @param freq Frames per second, or 0 to not pace.
+ */
+void
+G_PacerSetRate(pacer_t* pacer, double freq);
+
+/**
+ * Wait for the end of the current frame. Call once per frame. A frame that
+ * runs past its deadline does not wait, and the frames after it are paced
+ * from when it ended rather than made up for.
+ * @param pacer The pacer.
+ */
+void
+G_PacerWait(pacer_t* pacer);
+
+/**
+ * Log the overshoot and the time spent waiting.
+ * @param pacer The pacer.
+ */
+void
+G_PacerReport(const pacer_t* pacer);
+
+#endif // PACER_H_
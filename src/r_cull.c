@@ -0,0 +1,348 @@
+// r_cull.c
+
+#include <string.h>
+
+#define VEC_IMPL_H_
+#include "r_cull.h"
+
+void
+R_ExtractFrustum(const mat4_t* view_proj, R_Frustum* out) {
+    const float (*m)[4] = view_proj->m;
+
+    // Gribb/Hartmann: each clip plane is a combination of the matrix rows,
+    // e.g. x >= -w is (row3 + row0) . p >= 0
+    for (unsigned char j = 0; j < 4; j++) {
+        float* left = &out->planes[R_FRUSTUM_LEFT].x;
+        float* right = &out->planes[R_FRUSTUM_RIGHT].x;
+        float* bottom = &out->planes[R_FRUSTUM_BOTTOM].x;
+        float* top = &out->planes[R_FRUSTUM_TOP].x;
+        float* near = &out->planes[R_FRUSTUM_NEAR].x;
+        float* far = &out->planes[R_FRUSTUM_FAR].x;
+
+        left[j] = m[3][j] + m[0][j];
+        right[j] = m[3][j] - m[0][j];
+        bottom[j] = m[3][j] + m[1][j];
+        top[j] = m[3][j] - m[1][j];
+        near[j] = m[2][j];              // Vulkan: z >= 0
+        far[j] = m[3][j] - m[2][j];
+    }
+
+    for (unsigned char i = 0; i < R_FRUSTUM_PLANE_COUNT; i++) {
+        vec4_t* p = &out->planes[i];
+        const float len = sqrtf(p->x * p->x + p->y * p->y + p->z * p->z);
+        if (len > 0.0f) {
+            p->x /= len;
+            p->y /= len;
+            p->z /= len;
+            p->w /= len;
+        }
+    }
+}
+
+/* Record the visibility bits of the objects starting at `base`. */
+static size_t
+R_EmitVisible(
+    unsigned int bits,
+    size_t base,
+    uint32_t* out_mask,
+    uint32_t* out_indices,
+    size_t written) {
+    if (out_mask) {
+        out_mask[base / 32] |= (uint32_t) bits << (base % 32);
+    }
+
+    while (bits) {
+        unsigned int lane = 0;
+        while (!(bits & (1u << lane))) {
+            lane++;
+        }
+        bits &= bits - 1;
+
+        if (out_indices) {
+            out_indices[written] = (uint32_t) (base + lane);
+        }
+        written++;
+    }
+
+    return written;
+}
+
+static int
+R_AABBVisible(const R_Frustum* frustum, const R_AABBList* boxes, size_t i) {
+    for (unsigned char p = 0; p < R_FRUSTUM_PLANE_COUNT; p++) {
+        const vec4_t* pl = &frustum->planes[p];
+        const float d = pl->x * boxes->center_x[i] 
+            + pl->y * boxes->center_y[i]
+            + pl->z * boxes->center_z[i] 
+            + pl->w;
+        const float r = fabsf(pl->x) * boxes->extent_x[i]
+            + fabsf(pl->y) * boxes->extent_y[i]
+            + fabsf(pl->z) * boxes->extent_z[i];
+        if (d + r < 0.0f) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int
+R_SphereVisible(
+    const R_Frustum* frustum, 
+    const R_SphereList* spheres, 
+    size_t i) {
+    for (unsigned char p = 0; p < R_FRUSTUM_PLANE_COUNT; p++) {
+        const vec4_t* pl = &frustum->planes[p];
+        const float d = pl->x * spheres->center_x[i] 
+            + pl->y * spheres->center_y[i]
+            + pl->z * spheres->center_z[i] 
+            + pl->w;
+        if (d < -spheres->radius[i]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+#if M_SIMD_X86
+
+/*
+ * SIMD versions test one plane against 4 or 8 objects at a time and keep a
+ * running lane mask, so there is no per-object branch.
+ */
+
+__attribute__((target("sse2")))
+static size_t
+R_CullAABBsSSE2(
+    const R_Frustum* frustum,
+    const R_AABBList* boxes,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices,
+    size_t* written) {
+    const __m128 sign = _mm_set1_ps(-0.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 cx = _mm_loadu_ps(boxes->center_x + i);
+        const __m128 cy = _mm_loadu_ps(boxes->center_y + i);
+        const __m128 cz = _mm_loadu_ps(boxes->center_z + i);
+        const __m128 ex = _mm_loadu_ps(boxes->extent_x + i);
+        const __m128 ey = _mm_loadu_ps(boxes->extent_y + i);
+        const __m128 ez = _mm_loadu_ps(boxes->extent_z + i);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (unsigned char p = 0; p < R_FRUSTUM_PLANE_COUNT; p++) {
+            const vec4_t* pl = &frustum->planes[p];
+            const __m128 nx = _mm_set1_ps(pl->x);
+            const __m128 ny = _mm_set1_ps(pl->y);
+            const __m128 nz = _mm_set1_ps(pl->z);
+
+            __m128 d = _mm_add_ps(_mm_mul_ps(nx, cx), _mm_set1_ps(pl->w));
+            d = _mm_add_ps(d, _mm_mul_ps(ny, cy));
+            d = _mm_add_ps(d, _mm_mul_ps(nz, cz));
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign, nx), ex));
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign, ny), ey));
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_andnot_ps(sign, nz), ez));
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+        }
+
+        *written = R_EmitVisible(
+            _mm_movemask_ps(inside), i, out_mask, out_indices, *written);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+R_CullAABBsAVX(
+    const R_Frustum* frustum,
+    const R_AABBList* boxes,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices,
+    size_t* written) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(boxes->center_x + i);
+        const __m256 cy = _mm256_loadu_ps(boxes->center_y + i);
+        const __m256 cz = _mm256_loadu_ps(boxes->center_z + i);
+        const __m256 ex = _mm256_loadu_ps(boxes->extent_x + i);
+        const __m256 ey = _mm256_loadu_ps(boxes->extent_y + i);
+        const __m256 ez = _mm256_loadu_ps(boxes->extent_z + i);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (unsigned char p = 0; p < R_FRUSTUM_PLANE_COUNT; p++) {
+            const vec4_t* pl = &frustum->planes[p];
+            const __m256 nx = _mm256_set1_ps(pl->x);
+            const __m256 ny = _mm256_set1_ps(pl->y);
+            const __m256 nz = _mm256_set1_ps(pl->z);
+
+            __m256 d = _mm256_add_ps(
+                _mm256_mul_ps(nx, cx), _mm256_set1_ps(pl->w));
+            d = _mm256_add_ps(d, _mm256_mul_ps(ny, cy));
+            d = _mm256_add_ps(d, _mm256_mul_ps(nz, cz));
+            d = _mm256_add_ps(d, 
+                _mm256_mul_ps(_mm256_andnot_ps(sign, nx), ex));
+            d = _mm256_add_ps(d, 
+                _mm256_mul_ps(_mm256_andnot_ps(sign, ny), ey));
+            d = _mm256_add_ps(d, 
+                _mm256_mul_ps(_mm256_andnot_ps(sign, nz), ez));
+
+            inside = _mm256_and_ps(inside, 
+                _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        *written = R_EmitVisible(
+            _mm256_movemask_ps(inside), i, out_mask, out_indices, *written);
+    }
+
+    return i;
+}
+
+__attribute__((target("sse2")))
+static size_t
+R_CullSpheresSSE2(
+    const R_Frustum* frustum,
+    const R_SphereList* spheres,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices,
+    size_t* written) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 cx = _mm_loadu_ps(spheres->center_x + i);
+        const __m128 cy = _mm_loadu_ps(spheres->center_y + i);
+        const __m128 cz = _mm_loadu_ps(spheres->center_z + i);
+        const __m128 r = _mm_loadu_ps(spheres->radius + i);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (unsigned char p = 0; p < R_FRUSTUM_PLANE_COUNT; p++) {
+            const vec4_t* pl = &frustum->planes[p];
+            __m128 d = _mm_add_ps(
+                _mm_mul_ps(_mm_set1_ps(pl->x), cx), _mm_set1_ps(pl->w));
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(pl->y), cy));
+            d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(pl->z), cz));
+            d = _mm_add_ps(d, r);
+
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+        }
+
+        *written = R_EmitVisible(
+            _mm_movemask_ps(inside), i, out_mask, out_indices, *written);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx")))
+static size_t
+R_CullSpheresAVX(
+    const R_Frustum* frustum,
+    const R_SphereList* spheres,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices,
+    size_t* written) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 cx = _mm256_loadu_ps(spheres->center_x + i);
+        const __m256 cy = _mm256_loadu_ps(spheres->center_y + i);
+        const __m256 cz = _mm256_loadu_ps(spheres->center_z + i);
+        const __m256 r = _mm256_loadu_ps(spheres->radius + i);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (unsigned char p = 0; p < R_FRUSTUM_PLANE_COUNT; p++) {
+            const vec4_t* pl = &frustum->planes[p];
+            __m256 d = _mm256_add_ps(
+                _mm256_mul_ps(_mm256_set1_ps(pl->x), cx), 
+                _mm256_set1_ps(pl->w));
+            d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(pl->y), cy));
+            d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(pl->z), cz));
+            d = _mm256_add_ps(d, r);
+
+            inside = _mm256_and_ps(inside, 
+                _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+        }
+
+        *written = R_EmitVisible(
+            _mm256_movemask_ps(inside), i, out_mask, out_indices, *written);
+    }
+
+    return i;
+}
+
+#endif // M_SIMD_X86
+
+size_t
+R_CullAABBs(
+    const R_Frustum* frustum,
+    const R_AABBList* boxes,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices) {
+    size_t written = 0;
+    size_t i = 0;
+
+    if (out_mask) {
+        memset(out_mask, 0, ((count + 31) / 32) * sizeof(*out_mask));
+    }
+
+#if M_SIMD_X86
+    const MathSimdLevel level = M_GetSimdLevel();
+    if (level >= M_SIMD_AVX) {
+        i = R_CullAABBsAVX(
+            frustum, boxes, count, out_mask, out_indices, &written);
+    } else if (level >= M_SIMD_SSE2) {
+        i = R_CullAABBsSSE2(
+            frustum, boxes, count, out_mask, out_indices, &written);
+    }
+#endif
+
+    for (; i < count; i++) {
+        written = R_EmitVisible(
+            R_AABBVisible(frustum, boxes, i), i, 
+            out_mask, out_indices, written);
+    }
+
+    return written;
+}
+
+size_t
+R_CullSpheres(
+    const R_Frustum* frustum,
+    const R_SphereList* spheres,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices) {
+    size_t written = 0;
+    size_t i = 0;
+
+    if (out_mask) {
+        memset(out_mask, 0, ((count + 31) / 32) * sizeof(*out_mask));
+    }
+
+#if M_SIMD_X86
+    const MathSimdLevel level = M_GetSimdLevel();
+    if (level >= M_SIMD_AVX) {
+        i = R_CullSpheresAVX(
+            frustum, spheres, count, out_mask, out_indices, &written);
+    } else if (level >= M_SIMD_SSE2) {
+        i = R_CullSpheresSSE2(
+            frustum, spheres, count, out_mask, out_indices, &written);
+    }
+#endif
+
+    for (; i < count; i++) {
+        written = R_EmitVisible(
+            R_SphereVisible(frustum, spheres, i), i, 
+            out_mask, out_indices, written);
+    }
+
+    return written;
+}
@@ -0,0 +1,115 @@
+/**
+ * File: r_cull.h
+ * Description: Frustum extraction and batched visibility tests run on the CPU
+ * before draw submission.
+ */
+#ifndef CULL_H_
+#define CULL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c_math.h"
+
+/* Indices into R_Frustum.planes. */
+typedef enum {
+    R_FRUSTUM_LEFT,
+    R_FRUSTUM_RIGHT,
+    R_FRUSTUM_BOTTOM,
+    R_FRUSTUM_TOP,
+    R_FRUSTUM_NEAR,
+    R_FRUSTUM_FAR,
+    R_FRUSTUM_PLANE_COUNT
+} R_FrustumPlane;
+
+/**
+ * Six world-space planes (x, y, z) . p + w >= 0 for points inside. Plane 
+ * normals are normalized so the w distance is in world units.
+ */
+typedef struct R_Frustum {
+
+    vec4_t planes[R_FRUSTUM_PLANE_COUNT];
+
+} R_Frustum;
+
+/**
+ * Structure-of-arrays axis-aligned boxes given by center and half extents.
+ */
+typedef struct R_AABBList {
+
+    const float* center_x;
+    const float* center_y;
+    const float* center_z;
+
+    const float* extent_x;
+    const float* extent_y;
+    const float* extent_z;
+
+} R_AABBList;
+
+/**
+ * Structure-of-arrays bounding spheres.
+ */
+typedef struct R_SphereList {
+
+    const float* center_x;
+    const float* center_y;
+    const float* center_z;
+
+    const float* radius;
+
+} R_SphereList;
+
+/**
+ * Extract the frustum planes from a projection * view matrix for Vulkan 
+ * clip space, where 0 <= z <= w. m[i] must be row i of the matrix the 
+ * shader applies to column vectors, clip = view_proj * p.
+ * 
+ * @param view_proj The projection * view matrix as the shader uses it, e.g.
+ * the product of the transposed ubo.proj and ubo.view that are uploaded for
+ * the row_major shader.
+ * @param out The frustum.
+ */
+void
+R_ExtractFrustum(const mat4_t* view_proj, R_Frustum* out);
+
+/**
+ * Test a batch of boxes against the frustum. A box is visible unless it lies
+ * entirely behind one plane (conservative near the frustum corners).
+ * 
+ * @param frustum The frustum.
+ * @param boxes The boxes.
+ * @param count The number of boxes.
+ * @param out_mask Optional - bit i of word i / 32 is set if box i is visible.
+ * Must hold (count + 31) / 32 words.
+ * @param out_indices Optional - compacted indices of the visible boxes. Must
+ * hold count entries.
+ * @returns The number of visible boxes.
+ */
+size_t
+R_CullAABBs(
+    const R_Frustum* frustum,
+    const R_AABBList* boxes,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices);
+
+/**
+ * Test a batch of spheres against the frustum.
+ * 
+ * @param frustum The frustum.
+ * @param spheres The spheres.
+ * @param count The number of spheres.
+ * @param out_mask Optional - see R_CullAABBs.
+ * @param out_indices Optional - see R_CullAABBs.
+ * @returns The number of visible spheres.
+ */
+size_t
+R_CullSpheres(
+    const R_Frustum* frustum,
+    const R_SphereList* spheres,
+    size_t count,
+    uint32_t* out_mask,
+    uint32_t* out_indices);
+
+#endif // CULL_H_
@@ -10,9 +10,15 @@
 #include "r_render.h"
 
 #include "c_log.h"
+#include "c_memory.h"
 #include "c_utils.h"
+#include "c_arena.h"
+#include "r_vkalloc.h"
+#include "r_vkdebug.h"
 #include "g_clock.h"
 #include "r_matrix.h"
+#include "c_quat.h"
+#include "c_world.h"
 
 // defined in r_vulkan.c
 extern const int MAX_FRAMES_IN_FLIGHT;
@@ -26,7 +32,7 @@ R_CreateRenderState(R_RenderState* state) {
     /* get validation layers */
     int validation_layers_supported = VKH_CheckValidationLayerSupport();
     if (enable_validation_layers) {
-        G_Log("INFO", "Validation layers enabled.");
+        G_LogInfo("render", "Validation layers enabled.");
     }
     if (enable_validation_layers && !validation_layers_supported) {
         G_Log("ERROR", "Validation layers were enabled but not supported.");
@@ -109,11 +115,17 @@ R_CreateRenderState(R_RenderState* state) {
         state->vk.device, 
         &state->vk.pipeline.descriptorLayout);
 
+    // the vertex input descriptions are only read while creating the 
+    // pipeline, so they come from the main arena and are released after
+    arena_t* arena = C_MainArena();
+    const arena_mark_t mark = C_ArenaMark(arena);
+
     /* set binding description - allocated */
     state->vk.pipeline.vert_input_bind_desc_count = 1;
-    state->vk.pipeline.vert_input_bind_desc = SDL_malloc(
-        state->vk.pipeline.vert_input_bind_desc_count 
-            * sizeof(*state->vk.pipeline.vert_input_bind_desc)
+    state->vk.pipeline.vert_input_bind_desc = C_ArenaNew(
+        arena,
+        VkVertexInputBindingDescription,
+        state->vk.pipeline.vert_input_bind_desc_count
     );
     VKH_GetBindingDescription(
         (Uint32[]) { sizeof(Vertex) }, // stack allocated
@@ -123,10 +135,16 @@ R_CreateRenderState(R_RenderState* state) {
 
     /* set attribute description - allocated */
     state->vk.pipeline.vert_input_attrib_desc_count = 2;
-    state->vk.pipeline.vert_input_attrib_desc = SDL_malloc(
+    state->vk.pipeline.vert_input_attrib_desc = C_ArenaNew(
+        arena,
+        VkVertexInputAttributeDescription,
         state->vk.pipeline.vert_input_attrib_desc_count
-            * sizeof(*state->vk.pipeline.vert_input_attrib_desc)
     );
+    if (!state->vk.pipeline.vert_input_bind_desc 
+        || !state->vk.pipeline.vert_input_attrib_desc) {
+        G_Log("ERROR", "Failed to allocate vertex input descriptions.");
+        return 0;
+    }
     VKH_GetAttributeDescriptions(
         0,
         state->vk.pipeline.vert_input_attrib_desc_count,
@@ -141,6 +159,10 @@ R_CreateRenderState(R_RenderState* state) {
         state->vk.render_pass,
         &state->vk.pipeline);
 
+    C_ArenaRewind(arena, mark);
+    state->vk.pipeline.vert_input_bind_desc = NULL;
+    state->vk.pipeline.vert_input_attrib_desc = NULL;
+
     // NOTE: Framebuffers should always the same size as the Images array.
     state->vk.framebuffers.size = state->vk.images.size;
 
@@ -186,11 +208,11 @@ R_CreateRenderState(R_RenderState* state) {
     /* create uniform buffers */
     // create uniform buffers after creating the vertex and index buffers
     state->vk.ubo.size = MAX_FRAMES_IN_FLIGHT;
-    state->vk.ubo.buffer_list = SDL_calloc(
+    state->vk.ubo.buffer_list = C_Calloc(
         state->vk.ubo.size,
         sizeof(*state->vk.ubo.buffer_list));
-    state->vk.ubo.mapped = SDL_malloc(state->vk.ubo.size * sizeof(void*));
-    state->vk.ubo.memory_list = SDL_calloc(
+    state->vk.ubo.mapped = C_Malloc(state->vk.ubo.size * sizeof(void*));
+    state->vk.ubo.memory_list = C_Calloc(
         state->vk.ubo.size,
         sizeof(*state->vk.ubo.memory_list));
     VKH_CreateUniformBuffers(
@@ -203,7 +225,7 @@ R_CreateRenderState(R_RenderState* state) {
         &state->vk.pipeline.descriptorPool);
 
     state->vk.pipeline.descriptorSets.size = MAX_FRAMES_IN_FLIGHT;
-    state->vk.pipeline.descriptorSets.data = SDL_malloc(
+    state->vk.pipeline.descriptorSets.data = C_Malloc(
         MAX_FRAMES_IN_FLIGHT * sizeof(VkDescriptorSet));
     
     if (!state->vk.pipeline.descriptorSets.data) {
@@ -225,7 +247,7 @@ R_CreateRenderState(R_RenderState* state) {
 
     // Command buffer size must be equivalent to the MAX FRAMES IN FLIGHT.
     state->vk.command_buffers.size = MAX_FRAMES_IN_FLIGHT;
-    state->vk.command_buffers.data = SDL_calloc(state->vk.command_buffers.size,
+    state->vk.command_buffers.data = C_Calloc(state->vk.command_buffers.size,
         sizeof(*state->vk.command_buffers.data));
 
     /* Create command buffers */
@@ -261,6 +283,22 @@ R_CreateRenderState(R_RenderState* state) {
             &state->vk.inflight_fence.data[i]);
     }
 
+    /* per-frame scratch memory, recycled with the in flight fences */
+    state->frame_arenas = C_Calloc(
+        MAX_FRAMES_IN_FLIGHT, sizeof(*state->frame_arenas));
+    if (!state->frame_arenas) {
+        G_Log("ERROR", "Failed to allocate frame arenas.");
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+    for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        if (!C_ArenaCreate(
+            &state->frame_arenas[i], 
+            R_FRAME_ARENA_SIZE, 
+            CGAME_ARENA_GROW_SIZE)) {
+            return VK_ERROR_OUT_OF_HOST_MEMORY;
+        }
+    }
+
     if (res == VK_SUCCESS) {
         state->initialized = 1;
     }
@@ -270,7 +308,7 @@ R_CreateRenderState(R_RenderState* state) {
 
 int
 R_DestroyRenderState(R_RenderState* state) {
-    G_Log("RENDER INFO", "Destroying render state.");
+    G_LogInfo("render", "Destroying render state.");
 
     // cleanup swapchain stuff
     for (Uint32 i = 0; i < state->vk.framebuffers.size; i++) {
@@ -278,7 +316,7 @@ R_DestroyRenderState(R_RenderState* state) {
         vkDestroyFramebuffer(
             state->vk.device, 
             framebuffer, 
-            NULL);
+            VKH_Allocator());
     }
     
     // Clean up framebuffers array
@@ -288,7 +326,7 @@ R_DestroyRenderState(R_RenderState* state) {
     }
     for (Uint32 i = 0; i < state->vk.image_views.size; i++) {
         VkImageView view = state->vk.image_views.data[i];
-        vkDestroyImageView(state->vk.device, view, NULL);
+        vkDestroyImageView(state->vk.device, view, VKH_Allocator());
     }
     
     // Clean up image views array
@@ -296,7 +334,8 @@ R_DestroyRenderState(R_RenderState* state) {
         SDL_free(state->vk.image_views.data);
         state->vk.image_views.data = NULL;
     }
-    vkDestroySwapchainKHR(state->vk.device, state->vk.swapchain, NULL);
+    vkDestroySwapchainKHR(
+        state->vk.device, state->vk.swapchain, VKH_Allocator());
 
     // Clean up images array
     if (state->vk.images.data) {
@@ -304,31 +343,33 @@ R_DestroyRenderState(R_RenderState* state) {
         state->vk.images.data = NULL;
     }
 
-    vkDestroyPipeline(state->vk.device, state->vk.pipeline.pipeline, NULL);
+    vkDestroyPipeline(
+        state->vk.device, state->vk.pipeline.pipeline, VKH_Allocator());
     vkDestroyPipelineLayout(
-        state->vk.device, state->vk.pipeline.pipeline_layout, NULL);
-    vkDestroyRenderPass(state->vk.device, state->vk.render_pass, NULL);
-
-    // Clean up pipeline vertex input arrays
-    if (state->vk.pipeline.vert_input_bind_desc) {
-        SDL_free(state->vk.pipeline.vert_input_bind_desc);
-        state->vk.pipeline.vert_input_bind_desc = NULL;
-    }
-    if (state->vk.pipeline.vert_input_attrib_desc) {
-        SDL_free(state->vk.pipeline.vert_input_attrib_desc);
-        state->vk.pipeline.vert_input_attrib_desc = NULL;
-    }
+        state->vk.device, state->vk.pipeline.pipeline_layout, VKH_Allocator());
+    vkDestroyRenderPass(
+        state->vk.device, state->vk.render_pass, VKH_Allocator());
 
     // destroy uniform buffer list before the descriptor set layout
     for (Uint32 i = 0; i < state->vk.ubo.size; i++) {
-        vkDestroyBuffer(state->vk.device, state->vk.ubo.buffer_list[i], NULL);
-        vkFreeMemory(state->vk.device, state->vk.ubo.memory_list[i], NULL);
+        vkDestroyBuffer(
+            state->vk.device, state->vk.ubo.buffer_list[i], VKH_Allocator());
+        vkFreeMemory(
+            state->vk.device, state->vk.ubo.memory_list[i], VKH_Allocator());
     }
 
+    // Clean up uniform buffer arrays
+    SDL_free(state->vk.ubo.buffer_list);
+    SDL_free(state->vk.ubo.memory_list);
+    SDL_free(state->vk.ubo.mapped);
+    state->vk.ubo.buffer_list = NULL;
+    state->vk.ubo.memory_list = NULL;
+    state->vk.ubo.mapped = NULL;
+
     vkDestroyDescriptorPool(
         state->vk.device, 
         state->vk.pipeline.descriptorPool, 
-        NULL);
+        VKH_Allocator());
 
     // Clean up descriptor sets data array
     if (state->vk.pipeline.descriptorSets.data) {
@@ -340,32 +381,43 @@ R_DestroyRenderState(R_RenderState* state) {
     vkDestroyDescriptorSetLayout(
         state->vk.device,
         state->vk.pipeline.descriptorLayout,
-        NULL);
+        VKH_Allocator());
 
     // cleanup vertex buffer/index buffer after destroying the swapchain stuff
-    vkDestroyBuffer(state->vk.device, state->vk.index_buffer, NULL);
-    vkFreeMemory(state->vk.device, state->vk.index_buffer_memory, NULL);
+    vkDestroyBuffer(state->vk.device, state->vk.index_buffer, VKH_Allocator());
+    vkFreeMemory(
+        state->vk.device, state->vk.index_buffer_memory, VKH_Allocator());
 
-    vkDestroyBuffer(state->vk.device, state->vk.vertex_buffer, NULL);
-    vkFreeMemory(state->vk.device, state->vk.vertex_buffer_memory, NULL);
+    vkDestroyBuffer(state->vk.device, state->vk.vertex_buffer, VKH_Allocator());
+    vkFreeMemory(
+        state->vk.device, state->vk.vertex_buffer_memory, VKH_Allocator());
 
     /* destroy image available semaphores */
     for (Uint32 i = 0; i < state->vk.image_available.size; i++) {
         VkSemaphore semaphore = state->vk.image_available.data[i];
-        vkDestroySemaphore(state->vk.device, semaphore, NULL);
+        vkDestroySemaphore(state->vk.device, semaphore, VKH_Allocator());
     }
     /* destroy render finished semaphores */
     for (Uint32 i = 0; i < state->vk.render_finished.size; i++) {
         VkSemaphore semaphore = state->vk.render_finished.data[i];
-        vkDestroySemaphore(state->vk.device, semaphore, NULL);
+        vkDestroySemaphore(state->vk.device, semaphore, VKH_Allocator());
     }
     /* destroy fence semaphores */
     for (Uint32 i = 0; i < state->vk.inflight_fence.size; i++) {
         VkFence fence = state->vk.inflight_fence.data[i];
-        vkDestroyFence(state->vk.device, fence, NULL);
+        vkDestroyFence(state->vk.device, fence, VKH_Allocator());
+    }
+
+    /* destroy frame arenas */
+    if (state->frame_arenas) {
+        for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            C_ArenaDestroy(&state->frame_arenas[i]);
+        }
+        SDL_free(state->frame_arenas);
+        state->frame_arenas = NULL;
     }
     
-    vkDestroyCommandPool(state->vk.device, state->vk.pool, NULL);
+    vkDestroyCommandPool(state->vk.device, state->vk.pool, VKH_Allocator());
 
     // Clean up command buffers array
     if (state->vk.command_buffers.data) {
@@ -373,34 +425,45 @@ R_DestroyRenderState(R_RenderState* state) {
         state->vk.command_buffers.data = NULL;
     }
 
-    vkDestroyDevice(state->vk.device, NULL);
+    vkDestroyDevice(state->vk.device, VKH_Allocator());
     
-    vkDestroySurfaceKHR(state->vk.instance, state->vk.surface, NULL);
-    vkDestroyInstance(state->vk.instance, NULL);
+    vkDestroySurfaceKHR(state->vk.instance, state->vk.surface, VKH_Allocator());
+    vkDestroyInstance(state->vk.instance, VKH_Allocator());
+
+    // anything still live now was leaked by us or the driver
+    VKH_LogAllocStats();
+    VKH_DestroyAllocator();
 
     return 1;
 }
 
 void
 R_UpdateUniformBuffer(R_RenderState* state, const Clock* clockState) {
-    const double time = clockState->currTime;
+    // simulated time between the last two physics steps, so motion is
+    // smooth at any refresh rate
+    const double time = G_ClockRenderTime(clockState);
     R_UniformBufferObject ubo = { 0 };
 
-    ubo.model = M_Mat4Identity();
-    const float angle       = 0.0005f * time;
-    const float xTranslate  = 0.0005f * time;
-    // const mat4_t translate  = Mat4_TranslationMatrix(xTranslate, xTranslate, xTranslate);
-    // ubo.model               = M_MultiplyMat4(&ubo.model, &translate);
-    Mat4_Rotate(&ubo.model, (vec_t) { .x = 0.0f, .y = 0.0f, .z = 1.0f }, angle);
+    world_transform_t model = WorldTransform_Identity();
+    const float angle       = 0.5f * time;
+    const double drift      = 0.5 * time;
+    // model.translation    = (dvec_t) { drift, drift, drift };
+    Quat_Rotate(&model.rotation, (vec_t) { .x = 0.0f, .y = 0.0f, .z = 1.0f }, angle);
+
+    // the camera drifts away from the world origin over time, so rebase 
+    // everything on the camera before it is converted to float
+    const dvec_t eye    = { 2.0 - drift, 2.0 - drift, 2.0 - drift };
+    const dvec_t target = { -drift, -drift, -drift };
+    state->origin = eye;
+
+    ubo.model = WorldTransform_ToMat4(&model, &state->origin);
     ubo.model = Mat4_Transpose(ubo.model);
 
-    ubo.view = Mat4_LookAt(
-        (vec_t) { .x = 2.0f, .y = 2.0f, .z = 2.0f },    // eye position
-        (vec_t) { .x = 0.0f, .y = 0.0f, .z = 0.0f },    // target
+    ubo.view = World_ViewMatrix(
+        &eye,                                           // eye position
+        &target,                                        // target
         (vec_t) { .x = 0.0f, .y = 0.0f, .z = 1.0f }     // up direction
     );
-    const mat4_t viewT = Mat4_TranslationMatrix(xTranslate, xTranslate, xTranslate);
-    ubo.view = M_MultiplyMat4(&ubo.view, &viewT);
     ubo.view = Mat4_Transpose(ubo.view);
 
     static const float fov = M_PI / 3.0f;
@@ -416,11 +479,22 @@ R_UpdateUniformBuffer(R_RenderState* state, const Clock* clockState) {
     ubo.proj = Mat4_Transpose(ubo.proj);
     // ubo.proj = M_Mat4Identity();
 
+    // cull against the same proj * view product the vertex shader applies
+    const mat4_t view_proj = M_MultiplyMat4(&ubo.proj, &ubo.view);
+    R_ExtractFrustum(&view_proj, &state->frustum);
+
     SDL_memcpy(state->vk.ubo.mapped[state->current_frame], &ubo, sizeof(ubo));
 }
 
-int
-R_Draw(R_RenderState* state, const Clock* clockState) {
+arena_t*
+R_FrameArena(R_RenderState* state) {
+    return &state->frame_arenas[state->current_frame];
+}
+
+void
+R_BeginFrame(R_RenderState* state) {
+    const Uint64 wait_start = SDL_GetTicksNS();
+
     // wait for fences
     vkWaitForFences(
         state->vk.device, 
@@ -429,6 +503,16 @@ R_Draw(R_RenderState* state, const Clock* clockState) {
         VK_TRUE, 
         UINT64_MAX);
 
+    // the GPU is done with this frame, so its scratch memory is free again
+    C_ArenaReset(&state->frame_arenas[state->current_frame]);
+
+    state->wait_ns = SDL_GetTicksNS() - wait_start;
+}
+
+int
+R_Draw(R_RenderState* state, const Clock* clockState) {
+    const Uint64 acquire_start = SDL_GetTicksNS();
+
     Uint32 image_index = 0;
     VkResult result = vkAcquireNextImageKHR(
         state->vk.device,
@@ -437,6 +521,7 @@ R_Draw(R_RenderState* state, const Clock* clockState) {
         state->vk.image_available.data[state->current_frame],
         VK_NULL_HANDLE,
         &image_index);
+    state->wait_ns += SDL_GetTicksNS() - acquire_start;
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         // recreate the swapchain
@@ -525,7 +610,9 @@ R_Draw(R_RenderState* state, const Clock* clockState) {
     present_info.pImageIndices = &image_index;
     present_info.pResults = NULL; // Optional
 
+    const Uint64 present_start = SDL_GetTicksNS();
     result = vkQueuePresentKHR(state->vk.present_queue, &present_info);
+    state->wait_ns += SDL_GetTicksNS() - present_start;
 
     if (
         result == VK_ERROR_OUT_OF_DATE_KHR 
@@ -548,6 +635,8 @@ R_Draw(R_RenderState* state, const Clock* clockState) {
     }
 
     state->current_frame = (state->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+    VKH_AllocEndFrame();
+    VKH_DebugEndFrame();
 
     return 1;
 }
\ No newline at end of file
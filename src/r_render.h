@@ -16,9 +16,15 @@
 #include "c_math.h"
 #include "r_vulkan.h"
 #include "g_clock.h"
+#include "r_cull.h"
+#include "c_world.h"
+#include "c_arena.h"
 
 #define NDEBUG 1 // are we debug mode?
 
+/* Size of each per-frame scratch arena; they grow past it if needed. */
+#define R_FRAME_ARENA_SIZE 4000000u
+
 typedef enum {
     R_SUCCESS,
     R_FAILURE,
@@ -37,10 +43,34 @@ typedef struct R_RenderState {
 
     Uint32 current_frame;
 
+    /* World position the uniform matrices and frustum are relative to. */
+    dvec_t origin;
+
+    /* View frustum from the last uniform buffer update, relative to origin. */
+    R_Frustum frustum;
+
+    /* One scratch arena per frame in flight, indexed by current_frame. */
+    arena_t* frame_arenas;
+
+    /* Time the last frame was blocked on the fence, the swapchain image and
+     * the present, in nanoseconds. */
+    Uint64 wait_ns;
+
 } R_RenderState;
 
 /**
- * Draws to the screen.
+ * Start a frame. Waits until the GPU has finished the last frame that used
+ * the same resources, and releases that frame's scratch memory. Call before
+ * any work that uses R_FrameArena.
+ * 
+ * @param state The render state.
+ */
+void
+R_BeginFrame(R_RenderState* state);
+
+/**
+ * Draws the frame started by R_BeginFrame to the screen, and moves on to
+ * the next frame.
  * 
  * @param state
  * @returns code
@@ -48,6 +78,18 @@ typedef struct R_RenderState {
 int
 R_Draw(R_RenderState* state, const Clock* clockState);
 
+/**
+ * Get the scratch arena of the frame being recorded, for use between
+ * R_BeginFrame and R_Draw. Memory from it stays valid until the GPU has
+ * finished this frame, and is released by the R_BeginFrame that reuses the
+ * frame, MAX_FRAMES_IN_FLIGHT frames later.
+ * 
+ * @param state The render state.
+ * @returns The arena.
+ */
+arena_t*
+R_FrameArena(R_RenderState* state);
+
 /**
  * Create the object used to house rendering properties.
  * 
@@ -0,0 +1,334 @@
+#include "r_vkalloc.h"
+#include "c_log.h"
+#include "c_memory.h"
+#include "c_arena.h"
+#include "c_pool.h"
+
+#include <stdint.h>
+
+/* Room in front of every allocation for its header. */
+#define VKH_ALLOC_HEADER_SIZE 16u
+
+typedef enum {
+  VKH_ALLOC_SOURCE_ARENA,
+  VKH_ALLOC_SOURCE_POOL,
+  VKH_ALLOC_SOURCE_HEAP
+} VKH_AllocSource;
+
+/* Stored just in front of the pointer handed to the driver. */
+typedef struct {
+  size_t size;
+
+  /* Distance from the start of the underlying block. */
+  Uint32 offset;
+  Uint8 scope;
+  Uint8 source;
+} VKH_AllocHeader;
+
+/* Everything below is guarded by lock. */
+static SDL_SpinLock lock;
+
+static VKH_AllocStats stats;
+
+/* Calls and bytes of the frame in progress. */
+static Uint64 frame_calls[VKH_ALLOC_SCOPE_COUNT];
+static Uint64 frame_bytes[VKH_ALLOC_SCOPE_COUNT];
+
+/* Command scope memory only lives for the duration of a Vulkan call, so the
+ * arena is reset as soon as none of it is live. */
+static arena_t command_arena;
+static Uint64 command_live;
+
+static pool_t small_pool;
+
+static const char* scope_names[VKH_ALLOC_SCOPE_COUNT] = {
+  "command",
+  "object",
+  "cache",
+  "device",
+  "instance"
+};
+
+static VKH_AllocHeader*
+VKH_GetAllocHeader(void* ptr) {
+  return (VKH_AllocHeader*) ((unsigned char*) ptr - VKH_ALLOC_HEADER_SIZE);
+}
+
+/* Allocate from the allocator suited to the request. Lock held. */
+static void*
+VKH_AllocLocked(size_t size, size_t alignment, Uint8 scope) {
+  // the header sits in the alignment padding in front of the pointer
+  const size_t align = alignment > VKH_ALLOC_HEADER_SIZE
+    ? alignment : VKH_ALLOC_HEADER_SIZE;
+  if (size > SIZE_MAX - align || align > UINT32_MAX) {
+    return NULL;
+  }
+
+  unsigned char* block = NULL;
+  VKH_AllocSource source;
+
+  if (scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND) {
+    if (!command_arena.block && !C_ArenaCreate(
+      &command_arena,
+      VKH_ALLOC_COMMAND_ARENA_SIZE,
+      CGAME_ARENA_GROW_SIZE)) {
+      return NULL;
+    }
+    block = C_ArenaAlloc(&command_arena, align + size, align);
+    source = VKH_ALLOC_SOURCE_ARENA;
+  } else if (align == VKH_ALLOC_HEADER_SIZE && size <= VKH_ALLOC_SMALL_SIZE) {
+    if (!small_pool.block_size && !C_PoolCreate(
+      &small_pool,
+      VKH_ALLOC_HEADER_SIZE + VKH_ALLOC_SMALL_SIZE,
+      0,
+      0)) {
+      return NULL;
+    }
+    block = C_PoolAlloc(&small_pool);
+    source = VKH_ALLOC_SOURCE_POOL;
+  } else {
+    block = C_AlignedAlloc(align, align + size);
+    source = VKH_ALLOC_SOURCE_HEAP;
+  }
+
+  if (!block) {
+    return NULL;
+  }
+
+  void* ptr = block + align;
+  VKH_AllocHeader* header = VKH_GetAllocHeader(ptr);
+  header->size = size;
+  header->offset = (Uint32) align;
+  header->scope = scope;
+  header->source = (Uint8) source;
+
+  if (source == VKH_ALLOC_SOURCE_ARENA) {
+    command_live++;
+  }
+
+  VKH_AllocScopeStats* s = &stats.scopes[scope];
+  s->count++;
+  s->bytes += size;
+  if (s->bytes > s->peak_bytes) {
+    s->peak_bytes = s->bytes;
+  }
+  frame_bytes[scope] += size;
+
+  return ptr;
+}
+
+/* Return memory to the allocator it came from. Lock held. */
+static void
+VKH_FreeLocked(void* ptr) {
+  VKH_AllocHeader* header = VKH_GetAllocHeader(ptr);
+  unsigned char* block = (unsigned char*) ptr - header->offset;
+
+  VKH_AllocScopeStats* s = &stats.scopes[header->scope];
+  s->count--;
+  s->bytes -= header->size;
+
+  switch (header->source) {
+  case VKH_ALLOC_SOURCE_ARENA:
+    if (--command_live == 0) {
+      C_ArenaReset(&command_arena);
+    }
+    break;
+  case VKH_ALLOC_SOURCE_POOL:
+    C_PoolFree(&small_pool, block);
+    break;
+  default:
+    SDL_aligned_free(block);
+    break;
+  }
+}
+
+/* Scopes from a newer header than this file knows are counted as object. */
+static Uint8
+VKH_AllocScope(VkSystemAllocationScope scope) {
+  return (unsigned int) scope < VKH_ALLOC_SCOPE_COUNT
+    ? (Uint8) scope : VK_SYSTEM_ALLOCATION_SCOPE_OBJECT;
+}
+
+static void* VKAPI_CALL
+VKH_Allocation(
+  void* user,
+  size_t size,
+  size_t alignment,
+  VkSystemAllocationScope scope
+) {
+  (void) user;
+  const Uint8 index = VKH_AllocScope(scope);
+
+  SDL_LockSpinlock(&lock);
+  void* ptr = VKH_AllocLocked(size, alignment, index);
+  stats.scopes[index].allocs++;
+  frame_calls[index]++;
+  SDL_UnlockSpinlock(&lock);
+
+  return ptr;
+}
+
+static void* VKAPI_CALL
+VKH_Reallocation(
+  void* user,
+  void* original,
+  size_t size,
+  size_t alignment,
+  VkSystemAllocationScope scope
+) {
+  (void) user;
+  const Uint8 index = VKH_AllocScope(scope);
+  void* ptr = NULL;
+
+  SDL_LockSpinlock(&lock);
+  stats.scopes[index].reallocs++;
+  frame_calls[index]++;
+
+  if (!original) {
+    ptr = VKH_AllocLocked(size, alignment, index);
+  } else if (size == 0) {
+    VKH_FreeLocked(original);
+  } else {
+    // the memory keeps the scope it was first allocated with
+    const VKH_AllocHeader* header = VKH_GetAllocHeader(original);
+    ptr = VKH_AllocLocked(size, alignment, header->scope);
+    if (ptr) {
+      SDL_memcpy(ptr, original, size < header->size ? size : header->size);
+      VKH_FreeLocked(original);
+    }
+  }
+  SDL_UnlockSpinlock(&lock);
+
+  return ptr;
+}
+
+static void VKAPI_CALL
+VKH_Free(void* user, void* ptr) {
+  (void) user;
+  if (!ptr) {
+    return;
+  }
+
+  SDL_LockSpinlock(&lock);
+  const Uint8 index = VKH_GetAllocHeader(ptr)->scope;
+  stats.scopes[index].frees++;
+  frame_calls[index]++;
+  VKH_FreeLocked(ptr);
+  SDL_UnlockSpinlock(&lock);
+}
+
+static void VKAPI_CALL
+VKH_InternalAllocation(
+  void* user,
+  size_t size,
+  VkInternalAllocationType type,
+  VkSystemAllocationScope scope
+) {
+  (void) user;
+  (void) type;
+  VKH_AllocScopeStats* s = &stats.scopes[VKH_AllocScope(scope)];
+
+  SDL_LockSpinlock(&lock);
+  s->internal_bytes += size;
+  if (s->internal_bytes > s->internal_peak_bytes) {
+    s->internal_peak_bytes = s->internal_bytes;
+  }
+  SDL_UnlockSpinlock(&lock);
+}
+
+static void VKAPI_CALL
+VKH_InternalFree(
+  void* user,
+  size_t size,
+  VkInternalAllocationType type,
+  VkSystemAllocationScope scope
+) {
+  (void) user;
+  (void) type;
+  VKH_AllocScopeStats* s = &stats.scopes[VKH_AllocScope(scope)];
+
+  SDL_LockSpinlock(&lock);
+  s->internal_bytes -= size;
+  SDL_UnlockSpinlock(&lock);
+}
+
+static const VkAllocationCallbacks callbacks = {
+  .pUserData = NULL,
+  .pfnAllocation = VKH_Allocation,
+  .pfnReallocation = VKH_Reallocation,
+  .pfnFree = VKH_Free,
+  .pfnInternalAllocation = VKH_InternalAllocation,
+  .pfnInternalFree = VKH_InternalFree
+};
+
+const VkAllocationCallbacks*
+VKH_Allocator(void) {
+#if CGAME_VK_ALLOCATOR
+  return &callbacks;
+#else
+  return NULL;
+#endif
+}
+
+void
+VKH_AllocEndFrame(void) {
+  SDL_LockSpinlock(&lock);
+  for (int i = 0; i < VKH_ALLOC_SCOPE_COUNT; i++) {
+    stats.scopes[i].frame_calls = frame_calls[i];
+    stats.scopes[i].frame_bytes = frame_bytes[i];
+    frame_calls[i] = 0;
+    frame_bytes[i] = 0;
+  }
+  SDL_UnlockSpinlock(&lock);
+}
+
+void
+VKH_GetAllocStats(VKH_AllocStats* out) {
+  SDL_LockSpinlock(&lock);
+  *out = stats;
+  SDL_UnlockSpinlock(&lock);
+}
+
+void
+VKH_LogAllocStats(void) {
+  VKH_AllocStats copy;
+  VKH_GetAllocStats(&copy);
+
+  for (int i = 0; i < VKH_ALLOC_SCOPE_COUNT; i++) {
+    const VKH_AllocScopeStats* s = &copy.scopes[i];
+    G_LogInfo("vulkan",
+      "Driver %s memory: %llu live (%llu bytes, peak %llu), "
+      "%llu allocs, %llu reallocs, %llu frees, "
+      "%llu calls and %llu bytes last frame, "
+      "%llu internal bytes (peak %llu).",
+      scope_names[i],
+      (unsigned long long) s->count,
+      (unsigned long long) s->bytes,
+      (unsigned long long) s->peak_bytes,
+      (unsigned long long) s->allocs,
+      (unsigned long long) s->reallocs,
+      (unsigned long long) s->frees,
+      (unsigned long long) s->frame_calls,
+      (unsigned long long) s->frame_bytes,
+      (unsigned long long) s->internal_bytes,
+      (unsigned long long) s->internal_peak_bytes);
+  }
+}
+
+void
+VKH_DestroyAllocator(void) {
+  SDL_LockSpinlock(&lock);
+  if (command_live == 0) {
+    C_ArenaDestroy(&command_arena);
+  }
+  for (int i = 0; i < VKH_ALLOC_SCOPE_COUNT; i++) {
+    if (i != VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && stats.scopes[i].count) {
+      // blocks still handed out; keep the pool rather than free under them
+      SDL_UnlockSpinlock(&lock);
+      G_LogWarning("vulkan", "Driver memory still live, keeping its pool.");
+      return;
+    }
+  }
+  C_PoolDestroy(&small_pool);
+  SDL_UnlockSpinlock(&lock);
+}
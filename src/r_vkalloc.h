@@ -0,0 +1,88 @@
+/**
+ * File: r_vkalloc.h
+ * Description: Host memory callbacks handed to the Vulkan driver, so its
+ * allocations go through engine allocators and can be counted.
+ */
+#ifndef VKALLOC_H_
+#define VKALLOC_H_
+
+#include <vulkan/vulkan.h>
+#include <SDL3/SDL.h>
+
+/* Set to 0 to let the driver use its own allocator. */
+#define CGAME_VK_ALLOCATOR 1
+
+/* Number of VkSystemAllocationScope values. */
+#define VKH_ALLOC_SCOPE_COUNT 5
+
+/* Largest allocation served by the small block pool. */
+#define VKH_ALLOC_SMALL_SIZE 112u
+
+/* Size of the arena for command scope allocations. */
+#define VKH_ALLOC_COMMAND_ARENA_SIZE 1000000u
+
+/* Counters of one allocation scope. */
+typedef struct {
+  /* Live allocations and bytes, and the most bytes ever live at once. */
+  Uint64 count;
+  Uint64 bytes;
+  Uint64 peak_bytes;
+
+  /* Calls to the allocation, reallocation and free callbacks. */
+  Uint64 allocs;
+  Uint64 reallocs;
+  Uint64 frees;
+
+  /* Calls and bytes allocated during the last complete frame. */
+  Uint64 frame_calls;
+  Uint64 frame_bytes;
+
+  /* Memory the driver allocated itself and reported to us. */
+  Uint64 internal_bytes;
+  Uint64 internal_peak_bytes;
+} VKH_AllocScopeStats;
+
+/* Counters of every scope, indexed by VkSystemAllocationScope. */
+typedef struct {
+  VKH_AllocScopeStats scopes[VKH_ALLOC_SCOPE_COUNT];
+} VKH_AllocStats;
+
+/**
+ * Get the callbacks to pass as pAllocator to every vkCreate*, vkDestroy*,
+ * vkAllocateMemory and vkFreeMemory call. Objects must be destroyed with the
+ * same callbacks they were created with.
+ *
+ * Command scope memory comes from an arena that is reset whenever no command
+ * allocation is live, small blocks from a pool, and the rest from SDL_malloc.
+ * @returns The callbacks, or NULL when CGAME_VK_ALLOCATOR is 0.
+ */
+const VkAllocationCallbacks*
+VKH_Allocator(void);
+
+/**
+ * Close the current frame of the per-frame counters. Call once per frame.
+ */
+void
+VKH_AllocEndFrame(void);
+
+/**
+ * Get a copy of the counters.
+ * @param out The counters.
+ */
+void
+VKH_GetAllocStats(VKH_AllocStats* out);
+
+/**
+ * Log the counters of each scope, including allocations that are still live.
+ */
+void
+VKH_LogAllocStats(void);
+
+/**
+ * Free the memory the callbacks keep for themselves. Call after the instance
+ * is destroyed.
+ */
+void
+VKH_DestroyAllocator(void);
+
+#endif // VKALLOC_H_
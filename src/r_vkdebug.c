@@ -0,0 +1,363 @@
+#include "r_vkdebug.h"
+#include "c_log.h"
+
+#include <stdio.h>
+
+/* Longest message written, with the objects it names. */
+#define VKH_DEBUG_MESSAGE_LENGTH 4096
+
+/* Counters of one message id. */
+typedef struct {
+  /* 0 while the slot is free. */
+  Uint32 hash;
+  Sint32 number;
+  char name[VKH_DEBUG_NAME_LENGTH];
+
+  /* Every message, and those since the last summary. */
+  Uint64 count;
+  Uint64 period_count;
+
+  /* Messages held back since the id was last logged, and since the last
+   * summary. */
+  Uint64 pending;
+  Uint64 period_suppressed;
+
+  /* Ticks of the last time the id was logged. */
+  Uint64 last_logged;
+} VKH_DebugEntry;
+
+/* The ids named by one summary line. */
+typedef struct {
+  Uint64 seconds;
+  Uint64 count;
+  Uint64 suppressed;
+  Uint32 ids;
+  VKH_DebugEntry entries[VKH_DEBUG_SUMMARY_IDS];
+} VKH_DebugSummary;
+
+/* Used on every message, so they are kept out of the lock. */
+static SDL_AtomicInt threshold = { VKH_DEBUG_SEVERITY };
+static SDL_AtomicInt filtered;
+
+/* Everything below is guarded by lock. */
+static SDL_SpinLock lock;
+
+static VKH_DebugStats stats;
+
+/* Open addressing on the hash. The extra entry at the end counts the ids
+ * that did not fit. */
+static VKH_DebugEntry entries[VKH_DEBUG_MAX_IDS + 1];
+
+/* Ticks the current summary period started at, 0 before the first
+ * message. */
+static Uint64 period_start;
+
+/* Hash of the id of a message. Validation messages carry a number and a
+ * VUID name; other messages may have neither, and are told apart by their
+ * text instead. */
+static Uint32
+VKH_DebugHash(const VkDebugUtilsMessengerCallbackDataEXT* callback) {
+  const char* str = callback->pMessageIdName;
+  if (!str && callback->messageIdNumber == 0) {
+    str = callback->pMessage;
+  }
+
+  // FNV-1a over the number, then the name
+  Uint32 hash = 2166136261u;
+  Uint32 number = (Uint32) callback->messageIdNumber;
+  for (int i = 0; i < 4; i++) {
+    hash = (hash ^ (number & 0xffu)) * 16777619u;
+    number >>= 8;
+  }
+  for (; str && *str; str++) {
+    hash = (hash ^ (Uint8) *str) * 16777619u;
+  }
+  return hash ? hash : 1;
+}
+
+/* Find or add the entry of a message id. Lock held. */
+static VKH_DebugEntry*
+VKH_DebugFindLocked(
+  Uint32 hash,
+  const VkDebugUtilsMessengerCallbackDataEXT* callback
+) {
+  // messages without a name are summarized by the start of their text
+  const char* name = callback->pMessageIdName ? callback->pMessageIdName
+    : callback->pMessage ? callback->pMessage : "";
+
+  for (Uint32 i = 0; i < VKH_DEBUG_MAX_IDS; i++) {
+    VKH_DebugEntry* entry
+      = &entries[(hash + i) & (VKH_DEBUG_MAX_IDS - 1)];
+
+    if (entry->hash == 0) {
+      entry->hash = hash;
+      entry->number = callback->messageIdNumber;
+      SDL_strlcpy(entry->name, name, sizeof(entry->name));
+      stats.ids++;
+      return entry;
+    }
+
+    // names are truncated, so a hash match on the number is enough
+    if (entry->hash == hash && entry->number == callback->messageIdNumber) {
+      return entry;
+    }
+  }
+
+  VKH_DebugEntry* other = &entries[VKH_DEBUG_MAX_IDS];
+  if (other->hash == 0) {
+    other->hash = 1;
+    SDL_strlcpy(other->name, "other", sizeof(other->name));
+  }
+  return other;
+}
+
+/* Take the counts of the period that just ended, and start a new one.
+ * Returns 0 if nothing was held back, as everything was logged already.
+ * Lock held. */
+static int
+VKH_DebugCollectLocked(Uint64 now, VKH_DebugSummary* summary) {
+  *summary = (VKH_DebugSummary) { 0 };
+  summary->seconds = (now - period_start) / SDL_NS_PER_SECOND;
+  period_start = now;
+
+  for (int i = 0; i <= VKH_DEBUG_MAX_IDS; i++) {
+    VKH_DebugEntry* entry = &entries[i];
+    if (!entry->period_count) {
+      continue;
+    }
+
+    summary->count += entry->period_count;
+    summary->suppressed += entry->period_suppressed;
+
+    // keep the noisiest ids, in order
+    Uint32 at = summary->ids;
+    if (!entry->period_suppressed) {
+      at = VKH_DEBUG_SUMMARY_IDS;
+    } else if (at < VKH_DEBUG_SUMMARY_IDS) {
+      summary->ids++;
+    } else if (summary->entries[at - 1].period_suppressed
+      < entry->period_suppressed) {
+      at--;
+    }
+    if (at < VKH_DEBUG_SUMMARY_IDS) {
+      while (at > 0 && summary->entries[at - 1].period_suppressed
+        < entry->period_suppressed) {
+        summary->entries[at] = summary->entries[at - 1];
+        at--;
+      }
+      summary->entries[at] = *entry;
+    }
+
+    entry->period_count = 0;
+    entry->period_suppressed = 0;
+  }
+
+  return summary->suppressed != 0;
+}
+
+static void
+VKH_DebugWriteSummary(const VKH_DebugSummary* summary) {
+  G_LogWarning("vulkan",
+    "%llu debug messages in the last %llu s, %llu of them not logged.",
+    (unsigned long long) summary->count,
+    (unsigned long long) summary->seconds,
+    (unsigned long long) summary->suppressed);
+
+  for (Uint32 i = 0; i < summary->ids; i++) {
+    const VKH_DebugEntry* entry = &summary->entries[i];
+    G_LogWarning("vulkan",
+      "  %s (0x%08x): %llu times, %llu not logged, %llu in total.",
+      entry->name[0] ? entry->name : "unnamed",
+      (unsigned int) entry->number,
+      (unsigned long long) entry->period_count,
+      (unsigned long long) entry->period_suppressed,
+      (unsigned long long) entry->count);
+  }
+}
+
+static int
+VKH_DebugLevel(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+  return severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT
+      ? LOG_LEVEL_ERROR
+    : severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
+      ? LOG_LEVEL_WARNING
+    : severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT
+      ? LOG_LEVEL_INFO
+      : LOG_LEVEL_VERBOSE;
+}
+
+/* Format a message with the objects it names, and log it. */
+static void
+VKH_DebugWrite(
+  int level,
+  const VkDebugUtilsMessengerCallbackDataEXT* callback,
+  Uint64 pending
+) {
+  char msg[VKH_DEBUG_MESSAGE_LENGTH];
+  size_t offset = 0;
+
+  #define VKH_DEBUG_APPEND(...) \
+    do { \
+      if (offset < sizeof(msg)) { \
+        const int n = snprintf(msg + offset, sizeof(msg) - offset, \
+          __VA_ARGS__); \
+        offset += n > 0 ? (size_t) n : 0; \
+      } \
+    } while (0)
+
+  VKH_DEBUG_APPEND("%s", callback->pMessage ? callback->pMessage : "");
+  if (pending) {
+    VKH_DEBUG_APPEND(" (%llu repeats not logged)",
+      (unsigned long long) pending);
+  }
+
+  if (callback->objectCount > 0) {
+    VKH_DEBUG_APPEND("\n=== Vulkan Objects ===");
+  }
+  for (Uint32 i = 0; i < callback->objectCount; i++) {
+    const VkDebugUtilsObjectNameInfoEXT* obj = &callback->pObjects[i];
+    VKH_DEBUG_APPEND("\nObject[%u]: Type=%d, Handle=0x%llx, Name=%s",
+      i,
+      obj->objectType,
+      (unsigned long long) obj->objectHandle,
+      obj->pObjectName ? obj->pObjectName : "unnamed");
+  }
+
+  #undef VKH_DEBUG_APPEND
+
+  switch (level) {
+  case LOG_LEVEL_ERROR:
+    G_LogError("vulkan", "%s", msg);
+    break;
+  case LOG_LEVEL_WARNING:
+    G_LogWarning("vulkan", "%s", msg);
+    break;
+  case LOG_LEVEL_INFO:
+    G_LogInfo("vulkan", "%s", msg);
+    break;
+  default:
+    G_LogVerbose("vulkan", "%s", msg);
+    break;
+  }
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL
+VKH_DebugCallback(
+  VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+  VkDebugUtilsMessageTypeFlagsEXT type,
+  const VkDebugUtilsMessengerCallbackDataEXT* callback,
+  void* user_data
+) {
+  if ((int) severity < SDL_GetAtomicInt(&threshold)) {
+    SDL_AddAtomicInt(&filtered, 1);
+    return VK_FALSE;
+  }
+
+  const int level = VKH_DebugLevel(severity);
+  const Uint32 hash = VKH_DebugHash(callback);
+  const Uint64 now = SDL_GetTicksNS();
+
+  SDL_LockSpinlock(&lock);
+  if (!period_start) {
+    period_start = now;
+  }
+  stats.received++;
+
+  VKH_DebugEntry* entry = VKH_DebugFindLocked(hash, callback);
+  entry->count++;
+  entry->period_count++;
+
+  // a burst of each id goes through, then one per interval
+  const int write = entry->count <= VKH_DEBUG_BURST
+    || now - entry->last_logged
+      >= (Uint64) VKH_DEBUG_INTERVAL_MS * SDL_NS_PER_MS;
+  Uint64 pending = 0;
+  if (write) {
+    pending = entry->pending;
+    entry->pending = 0;
+    entry->last_logged = now;
+    stats.logged++;
+  } else {
+    entry->pending++;
+    entry->period_suppressed++;
+    stats.suppressed++;
+  }
+
+  VKH_DebugSummary summary;
+  const int summarize
+    = now - period_start >= (Uint64) VKH_DEBUG_SUMMARY_MS * SDL_NS_PER_MS
+    && VKH_DebugCollectLocked(now, &summary);
+  SDL_UnlockSpinlock(&lock);
+
+  // formatted outside the lock, and only when the tag would log it
+  if (write && G_LogEnabled(level, "vulkan")) {
+    VKH_DebugWrite(level, callback, pending);
+  }
+  if (summarize) {
+    VKH_DebugWriteSummary(&summary);
+  }
+
+  return VK_FALSE;
+}
+
+void
+VKH_SetDebugSeverity(VkDebugUtilsMessageSeverityFlagBitsEXT severity) {
+  SDL_SetAtomicInt(&threshold, (int) severity);
+}
+
+VkDebugUtilsMessageSeverityFlagBitsEXT
+VKH_GetDebugSeverity(void) {
+  return (VkDebugUtilsMessageSeverityFlagBitsEXT) SDL_GetAtomicInt(&threshold);
+}
+
+void
+VKH_DebugEndFrame(void) {
+  const Uint64 now = SDL_GetTicksNS();
+  VKH_DebugSummary summary;
+
+  SDL_LockSpinlock(&lock);
+  const int summarize = period_start
+    && now - period_start >= (Uint64) VKH_DEBUG_SUMMARY_MS * SDL_NS_PER_MS
+    && VKH_DebugCollectLocked(now, &summary);
+  SDL_UnlockSpinlock(&lock);
+
+  if (summarize) {
+    VKH_DebugWriteSummary(&summary);
+  }
+}
+
+void
+VKH_LogDebugSummary(void) {
+  const Uint64 now = SDL_GetTicksNS();
+  VKH_DebugSummary summary;
+
+  SDL_LockSpinlock(&lock);
+  const int summarize = period_start
+    && VKH_DebugCollectLocked(now, &summary);
+  SDL_UnlockSpinlock(&lock);
+
+  VKH_DebugStats copy;
+  VKH_GetDebugStats(&copy);
+
+  if (summarize) {
+    VKH_DebugWriteSummary(&summary);
+  }
+  if (copy.received || copy.filtered) {
+    G_LogInfo("vulkan",
+      "Debug messages: %llu received, %llu logged, %llu not logged, "
+      "%llu below the threshold, %u ids.",
+      (unsigned long long) copy.received,
+      (unsigned long long) copy.logged,
+      (unsigned long long) copy.suppressed,
+      (unsigned long long) copy.filtered,
+      (unsigned int) copy.ids);
+  }
+}
+
+void
+VKH_GetDebugStats(VKH_DebugStats* out) {
+  SDL_LockSpinlock(&lock);
+  *out = stats;
+  SDL_UnlockSpinlock(&lock);
+  out->filtered = (Uint32) SDL_GetAtomicInt(&filtered);
+}
@@ -0,0 +1,97 @@
+/**
+ * File: r_vkdebug.h
+ * Description: Debug messenger callback for the validation layers. Repeats
+ * of a message are counted by message id and rate limited, and the counts
+ * are written out as periodic summary lines.
+ */
+#ifndef VKDEBUG_H_
+#define VKDEBUG_H_
+
+#include <vulkan/vulkan.h>
+#include <SDL3/SDL.h>
+
+/* Distinct message ids counted on their own; later ids share one entry. */
+#define VKH_DEBUG_MAX_IDS 256
+
+/* Longest message id name kept for the summary lines. */
+#define VKH_DEBUG_NAME_LENGTH 64
+
+/* Times a message id is logged before it is rate limited. */
+#define VKH_DEBUG_BURST 5
+
+/* Once rate limited, the least time between two logs of an id, in ms. */
+#define VKH_DEBUG_INTERVAL_MS 1000
+
+/* Time between summary lines, in ms. */
+#define VKH_DEBUG_SUMMARY_MS 10000
+
+/* Most message ids named in one summary, the noisiest first. */
+#define VKH_DEBUG_SUMMARY_IDS 8
+
+/* Lowest severity handled until VKH_SetDebugSeverity is called. */
+#define VKH_DEBUG_SEVERITY VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT
+
+/* Counters of every message passed to the callback. */
+typedef struct {
+  /* Messages at or above the threshold, and those below it. */
+  Uint64 received;
+  Uint64 filtered;
+
+  /* Messages logged, and those held back by the rate limit. */
+  Uint64 logged;
+  Uint64 suppressed;
+
+  /* Distinct message ids seen. */
+  Uint32 ids;
+} VKH_DebugStats;
+
+/**
+ * The callback to set as pfnUserCallback of the debug messenger. Messages
+ * below the severity threshold are dropped after one atomic load; the rest
+ * are counted, and only formatted when the rate limit of their id lets
+ * them through. Thread safe.
+ */
+VKAPI_ATTR VkBool32 VKAPI_CALL
+VKH_DebugCallback(
+  VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+  VkDebugUtilsMessageTypeFlagsEXT type,
+  const VkDebugUtilsMessengerCallbackDataEXT* callback,
+  void* user_data);
+
+/**
+ * Set the lowest severity the callback handles. The messenger should be
+ * subscribed to every severity that may be wanted later.
+ * @param severity The lowest severity.
+ */
+void
+VKH_SetDebugSeverity(VkDebugUtilsMessageSeverityFlagBitsEXT severity);
+
+/**
+ * Get the lowest severity the callback handles.
+ * @returns The severity.
+ */
+VkDebugUtilsMessageSeverityFlagBitsEXT
+VKH_GetDebugSeverity(void);
+
+/**
+ * Write a summary line if one is due. Call once per frame, so the counts
+ * are reported even when the messages stop.
+ */
+void
+VKH_DebugEndFrame(void);
+
+/**
+ * Write a summary of the messages held back since the last one, whether or
+ * not it is due. Call after the messenger is destroyed.
+ */
+void
+VKH_LogDebugSummary(void);
+
+/**
+ * Get a copy of the counters.
+ * @param out The counters.
+ */
+void
+VKH_GetDebugStats(VKH_DebugStats* out);
+
+#endif // VKDEBUG_H_
@@ -2,6 +2,9 @@
 
 #include "r_vulkan.h"
 #include "c_log.h"
+#include "c_memory.h"
+#include "c_arena.h"
+#include "r_vkalloc.h"
 #include "r_matrix.h"
 
 const char* required_exts[CGAME_REQURIED_EXTENSIONS] = {
@@ -50,7 +53,9 @@ VKH_CreateInstance(VkInstance* vk) {
   }
   int exts_count = count_inst_exts + 1;
   
-  const char** exts = SDL_malloc(exts_count * sizeof(const char*));
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
+  const char** exts = C_ArenaNew(arena, const char*, exts_count);
   if (!exts) {
     G_Log("ERROR", "Failed to allocate memory for instance extensions.");
     return 0;
@@ -71,13 +76,12 @@ VKH_CreateInstance(VkInstance* vk) {
     vk_inst_create_info.enabledLayerCount = 0;
   }
 
-  if ((res = vkCreateInstance(&vk_inst_create_info, NULL, vk))
+  if ((res = vkCreateInstance(&vk_inst_create_info, VKH_Allocator(), vk))
     != VK_SUCCESS) {
     G_Log("ERROR", "Failed to create vulkan instance.");
-    SDL_free(exts);
-    return res;
   }
 
+  C_ArenaRewind(arena, mark);
   return res;
 }
 
@@ -165,7 +169,7 @@ VKH_QuerySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
     &details.formats_count, 
     NULL);
   details.formats 
-    = SDL_malloc(details.formats_count * sizeof(VkSurfaceFormatKHR));
+    = C_Malloc(details.formats_count * sizeof(VkSurfaceFormatKHR));
   vkGetPhysicalDeviceSurfaceFormatsKHR(
     device, 
     surface, 
@@ -181,7 +185,7 @@ VKH_QuerySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
     NULL);
   
   details.present_modes 
-    = SDL_malloc(details.present_modes_count * sizeof(VkPresentModeKHR));
+    = C_Malloc(details.present_modes_count * sizeof(VkPresentModeKHR));
 
   vkGetPhysicalDeviceSurfacePresentModesKHR(
     device, 
@@ -193,6 +197,16 @@ VKH_QuerySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface) {
   return details;
 }
 
+void
+VKH_FreeSwapChainSupport(VKH_SwapchainSupportDetails* details) {
+  SDL_free(details->formats);
+  SDL_free(details->present_modes);
+  details->formats = NULL;
+  details->present_modes = NULL;
+  details->formats_count = 0;
+  details->present_modes_count = 0;
+}
+
 int 
 VKH_CheckDeviceExtensionSupport(VkPhysicalDevice device) {
   Uint32 ext_count;
@@ -200,9 +214,14 @@ VKH_CheckDeviceExtensionSupport(VkPhysicalDevice device) {
 
   // get the available extensions for this device
 
-  VkExtensionProperties* available_exts = SDL_malloc(
-    ext_count * sizeof(VkExtensionProperties)
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
+  VkExtensionProperties* available_exts = C_ArenaNew(
+    arena, VkExtensionProperties, ext_count
   );
+  if (!available_exts) {
+    return 0;
+  }
   vkEnumerateDeviceExtensionProperties(
     device, 
     NULL, 
@@ -225,6 +244,8 @@ VKH_CheckDeviceExtensionSupport(VkPhysicalDevice device) {
     }
   }
 
+  C_ArenaRewind(arena, mark);
+
   // if all required extensions were met, then pass
   return fulfilled == 0;
 } 
@@ -249,7 +270,7 @@ VKH_IsPhysicalDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
   int swapchain_good = 0;
 
   if (exts_supported) {
-    G_Log("INFO", "Defined extensions supported.");
+    G_LogDebug("vulkan", "Defined extensions supported.");
     VKH_SwapchainSupportDetails swapchain_support = 
       VKH_QuerySwapChainSupport(device, surface);
 
@@ -259,6 +280,8 @@ VKH_IsPhysicalDeviceSuitable(VkPhysicalDevice device, VkSurfaceKHR surface) {
       && swapchain_support.present_modes_count != 0
       && swapchain_support.formats != NULL
       && swapchain_support.present_modes != NULL;
+
+    VKH_FreeSwapChainSupport(&swapchain_support);
   }
 
   return swapchain_good
@@ -282,8 +305,13 @@ VKH_FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface) {
 
   // graphics device can have multiple queue families
 
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
   VkQueueFamilyProperties* queue_families 
-    = SDL_malloc(family_count * sizeof(VkQueueFamilyProperties));
+    = C_ArenaNew(arena, VkQueueFamilyProperties, family_count);
+  if (!queue_families) {
+    return indices;
+  }
 
   vkGetPhysicalDeviceQueueFamilyProperties(
     device, 
@@ -308,6 +336,7 @@ VKH_FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface) {
     }
   }
 
+  C_ArenaRewind(arena, mark);
   return indices;
 }
 
@@ -480,7 +509,7 @@ VKH_CreateGraphicsPipeline(
   res = vkCreatePipelineLayout(
     device, 
     &pl_ci, 
-    NULL, 
+    VKH_Allocator(), 
     &pipeline->pipeline_layout);
 
   if (res != VK_SUCCESS) {
@@ -514,7 +543,7 @@ VKH_CreateGraphicsPipeline(
     VK_NULL_HANDLE,
     1,
     &p_ci,
-    NULL,
+    VKH_Allocator(),
     &pipeline->pipeline);
 
   if (res != VK_SUCCESS) {
@@ -527,8 +556,8 @@ VKH_CreateGraphicsPipeline(
   // C_FreeFileBuffer(&frag_shader);
 
   // safe to delete shader modules now
-  vkDestroyShaderModule(device, vert_shader_mod, NULL);
-  vkDestroyShaderModule(device, frag_shader_mod, NULL);
+  vkDestroyShaderModule(device, vert_shader_mod, VKH_Allocator());
+  vkDestroyShaderModule(device, frag_shader_mod, VKH_Allocator());
 
   return 1;
 }
@@ -550,7 +579,7 @@ VKH_CreateShaderModule(VkDevice device, const buffer* binary) {
   if (vkCreateShaderModule(
     device, 
     &create_info, 
-    NULL, 
+    VKH_Allocator(), 
     &module
   ) != VK_SUCCESS) {
     G_Log("ERROR", "Failed to create shader module.");
@@ -612,7 +641,7 @@ VKH_CreateRenderPass(
   if (vkCreateRenderPass(
     device, 
     &rp_ci, 
-    NULL, 
+    VKH_Allocator(), 
     render_pass
   ) != VK_SUCCESS) {
     return 0;
@@ -717,8 +746,13 @@ VKH_CheckValidationLayerSupport() {
   Uint32 layer_count = 0;
   vkEnumerateInstanceLayerProperties(&layer_count, NULL);
 
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
   VkLayerProperties* props 
-    = SDL_malloc(layer_count * sizeof(VkLayerProperties));
+    = C_ArenaNew(arena, VkLayerProperties, layer_count);
+  if (!props) {
+    return 0;
+  }
 
   vkEnumerateInstanceLayerProperties(&layer_count, props);
 
@@ -735,10 +769,12 @@ VKH_CheckValidationLayerSupport() {
     }
 
     if (!found) {
+      C_ArenaRewind(arena, mark);
       return 0;
     }
   }
 
+  C_ArenaRewind(arena, mark);
   return 1;
 }
 
@@ -798,7 +834,9 @@ VKH_CreatePhysicalDevice(
     return -1;
   }
 
-  phys_devices = SDL_malloc(device_count * sizeof(gpu));
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
+  phys_devices = C_ArenaNew(arena, VkPhysicalDevice, device_count);
   if (!phys_devices) {
     G_Log("ERROR", "Error allocating memory for physical devices array.");
     return res;
@@ -816,7 +854,7 @@ VKH_CreatePhysicalDevice(
   // select the first device based on suitability
   for (Uint32 i = 0; i < device_count; i++) {
     if (VKH_IsPhysicalDeviceSuitable(phys_devices[i], surface)) {
-      G_Log("INFO", "Found suitable physical device.");
+      G_LogInfo("vulkan", "Found suitable physical device.");
       phys_device = phys_devices[i];
       break;
     }
@@ -833,7 +871,7 @@ VKH_CreatePhysicalDevice(
 
 cleanup:
 
-  SDL_free(phys_devices);
+  C_ArenaRewind(arena, mark);
 
   return res;
 }
@@ -855,28 +893,36 @@ VKH_CreateDevice(
   Uint32* unique_queue_families = NULL;
   Uint32 unique_queue_families_count = 0;
 
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
+
   if (indices.graphics_family == indices.present_family) {
     unique_queue_families_count = 1;
     // families are the same and one can be used
-    unique_queue_families = SDL_malloc(
-      unique_queue_families_count * sizeof(Uint32)
+    unique_queue_families = C_ArenaNew(
+      arena, Uint32, unique_queue_families_count
     );
 
     unique_queue_families[0] = indices.graphics_family;
   } else {
     unique_queue_families_count = 2;
     // families are NOT the same and both must be added
-    unique_queue_families = SDL_malloc(
-      unique_queue_families_count * sizeof(Uint32)
+    unique_queue_families = C_ArenaNew(
+      arena, Uint32, unique_queue_families_count
     );
 
     unique_queue_families[0] = indices.graphics_family;
     unique_queue_families[1] = indices.present_family;
   }
 
-  q_cis = SDL_malloc(
-    unique_queue_families_count * sizeof(VkDeviceQueueCreateInfo)
+  q_cis = C_ArenaNew(
+    arena, VkDeviceQueueCreateInfo, unique_queue_families_count
   );
+  if (!unique_queue_families || !q_cis) {
+    G_Log("ERROR", "Failed to allocate memory for queue create infos.");
+    res = VK_ERROR_OUT_OF_HOST_MEMORY;
+    goto cleanup;
+  }
 
   float queue_prio2 = 1.0f;
   for (Uint32 i = 0; i < unique_queue_families_count; i++) {
@@ -900,7 +946,7 @@ VKH_CreateDevice(
   ci.enabledExtensionCount = CGAME_REQURIED_EXTENSIONS;
   ci.ppEnabledExtensionNames = required_exts;
 
-  res = vkCreateDevice(gpu, &ci, NULL, device);
+  res = vkCreateDevice(gpu, &ci, VKH_Allocator(), device);
 
   if (res != VK_SUCCESS) {      
     G_Log("ERROR", "Error creating logical device.");
@@ -909,8 +955,7 @@ VKH_CreateDevice(
 
 cleanup:
 
-  SDL_free(unique_queue_families);
-  SDL_free(q_cis);
+  C_ArenaRewind(arena, mark);
 
   return res;
 }
@@ -924,7 +969,7 @@ VKH_CreateSurface(
   if (!SDL_Vulkan_CreateSurface(
     handle, 
     instance, 
-    NULL, 
+    VKH_Allocator(), 
     surface
   )) {
     G_Log("ERROR", "Error creating SDL3 Vulkan surface.");
@@ -1030,7 +1075,7 @@ VKH_CreateSwapchain(
   res = vkCreateSwapchainKHR(
     device, 
     &ci, 
-    NULL, 
+    VKH_Allocator(), 
     out_swapchain
   );
   if (res != VK_SUCCESS) {
@@ -1049,14 +1094,17 @@ VKH_CreateSwapchain(
 
   if (res != VK_SUCCESS) {
     G_Log("ERROR", "Could not enumerate swapchain image size.");
-    return res;
+    goto cleanup;
   }
 
-  images->data = SDL_malloc(images->size * sizeof(*images->data));
+  // release the images array of the swapchain being replaced
+  SDL_free(images->data);
+  images->data = C_Malloc(images->size * sizeof(*images->data));
 
   if (!images->data) {
     G_Log("ERROR", "Failed to allocate memory for swapchain images.");
-    return res;
+    res = VK_ERROR_OUT_OF_HOST_MEMORY;
+    goto cleanup;
   }
 
   res = vkGetSwapchainImagesKHR(
@@ -1068,10 +1116,12 @@ VKH_CreateSwapchain(
   if (res != VK_SUCCESS) {
     G_Log("ERROR", "Could not fetch swapchain images.");
     SDL_free(images->data);
-    return res;
+    images->data = NULL;
+    goto cleanup;
   }
 
 cleanup: 
+  VKH_FreeSwapChainSupport(&ss);
 
   return res;
 }
@@ -1084,7 +1134,7 @@ VKH_CreateImageViews(
   VKH_ImageViewList* image_views
 ) {
   VkResult res = VK_SUCCESS;
-  image_views->data = SDL_malloc(image_views->size * sizeof(
+  image_views->data = C_Malloc(image_views->size * sizeof(
     image_views->data[0]
   ));
 
@@ -1112,7 +1162,7 @@ VKH_CreateImageViews(
     res = vkCreateImageView(
       device, 
       &ci, 
-      NULL, 
+      VKH_Allocator(), 
       &image_views->data[i]
     );
     if (res != VK_SUCCESS) {
@@ -1134,7 +1184,7 @@ VKH_CreateFramebuffers(
   VKH_FramebufferList* framebuffers
 ) {
   VkResult res = VK_SUCCESS;
-  framebuffers->data = SDL_malloc(framebuffers->size * sizeof(
+  framebuffers->data = C_Malloc(framebuffers->size * sizeof(
     framebuffers->data[0]
   ));
   if (!framebuffers->data) {
@@ -1159,7 +1209,7 @@ VKH_CreateFramebuffers(
     res = vkCreateFramebuffer(
       device,
       &ci,
-      NULL,
+      VKH_Allocator(),
       &framebuffers->data[i]
     );
 
@@ -1188,7 +1238,7 @@ VKH_CreateCommandPool(
   res = vkCreateCommandPool(
     device,
     &pool_ci,
-    NULL,
+    VKH_Allocator(),
     pool);
 
   if (res != VK_SUCCESS) {
@@ -1235,7 +1285,7 @@ VKH_CreateSemaphore(
   res = vkCreateSemaphore(
     device, 
     &semaphore_info, 
-    NULL, 
+    VKH_Allocator(), 
     semaphore);
 
   if (res != VK_SUCCESS) {
@@ -1258,7 +1308,7 @@ VKH_CreateFence(
   res = vkCreateFence(
     device, 
     &fence_create_info, 
-    NULL, 
+    VKH_Allocator(), 
     fence);
 
   if (res != VK_SUCCESS) {
@@ -1312,7 +1362,7 @@ VKH_CreateBuffer(
   res = vkCreateBuffer(
     device, 
     &buffer_info, 
-    NULL, 
+    VKH_Allocator(), 
     buffer);
     
   if (res != VK_SUCCESS) {
@@ -1337,7 +1387,7 @@ VKH_CreateBuffer(
     return VK_ERROR_UNKNOWN;
   }
 
-  res = vkAllocateMemory(device, &alloc_info, NULL, memory);
+  res = vkAllocateMemory(device, &alloc_info, VKH_Allocator(), memory);
   if (res != VK_SUCCESS) {
     G_Log("ERROR", "Failed to allocate buffer memory.");
   }
@@ -1414,8 +1464,8 @@ VKH_CreateVertexBuffer(
     return res;
   }
 
-  vkDestroyBuffer(device, staging_buffer, NULL);
-  vkFreeMemory(device, staging_memory, NULL);
+  vkDestroyBuffer(device, staging_buffer, VKH_Allocator());
+  vkFreeMemory(device, staging_memory, VKH_Allocator());
 
   return res;
 }
@@ -1487,8 +1537,8 @@ VKH_CreateIndexBuffer(
     return res;
   }
 
-  vkDestroyBuffer(device, staging_buffer, NULL);
-  vkFreeMemory(device, staging_memory, NULL);
+  vkDestroyBuffer(device, staging_buffer, VKH_Allocator());
+  vkFreeMemory(device, staging_memory, VKH_Allocator());
 
   return res;
 }
@@ -1578,7 +1628,7 @@ VKH_CreateDescriptorSetLayout(
 
   res = vkCreateDescriptorSetLayout(device,
     &ci,
-    NULL,
+    VKH_Allocator(),
     descriptor_layout);
 
   if (res != VK_SUCCESS) {
@@ -1639,7 +1689,7 @@ VKH_CreateDescriptorPool(
   poolInfo.pPoolSizes = &poolSize;
   poolInfo.maxSets = (Uint32) MAX_FRAMES_IN_FLIGHT;
 
-  res = vkCreateDescriptorPool(device, &poolInfo, NULL, pool);
+  res = vkCreateDescriptorPool(device, &poolInfo, VKH_Allocator(), pool);
   if (res != VK_SUCCESS) {
     G_Log("ERROR", "Failed to create descriptor pool.");
     return res;
@@ -1658,8 +1708,13 @@ VKH_CreateDescriptorSets(VkDevice device,
   VkResult res = VK_SUCCESS;
   
   // create list of layouts (we only use one descriptor set layout)
-  VkDescriptorSetLayout* layouts = SDL_malloc(
-    MAX_FRAMES_IN_FLIGHT * sizeof(VkDescriptorSetLayout));
+  arena_t* arena = C_MainArena();
+  const arena_mark_t mark = C_ArenaMark(arena);
+  VkDescriptorSetLayout* layouts = C_ArenaNew(
+    arena, VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT);
+  if (!layouts) {
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
   
   for (Uint32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
     layouts[i] = layout;
@@ -1673,6 +1728,7 @@ VKH_CreateDescriptorSets(VkDevice device,
   allocInfo.pSetLayouts = layouts;
 
   res = vkAllocateDescriptorSets(device, &allocInfo, sets->data);
+  C_ArenaRewind(arena, mark);
   if (res != VK_SUCCESS) {
     G_Log("ERROR", "Failed to allocate descriptor sets.");
     return res;
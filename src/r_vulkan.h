@@ -275,6 +275,13 @@ VKH_FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 VKH_SwapchainSupportDetails
 VKH_QuerySwapChainSupport(VkPhysicalDevice device, VkSurfaceKHR surface);
 
+/**
+ * Free the lists returned by VKH_QuerySwapChainSupport.
+ * @param details The swapchain support details.
+ */
+void
+VKH_FreeSwapChainSupport(VKH_SwapchainSupportDetails* details);
+
 /**
  * Choose the best surface format for the swap chain for the purposes of this
  * application.
@@ -0,0 +1,278 @@
+/**
+ * File: log_decode.c
+ * Description: Turns the binary log written by G_LogBinary back into text.
+ * Built with `make log-decode`; needs neither SDL nor Vulkan.
+ *
+ * Each event is printed like a line of log.out, with the seconds since the
+ * log was opened after the wall clock time:
+ *
+ *   Fri Oct 17 10:00:00 2026 +1.234567 [INFO]: 3 regions, 64 MB
+ *
+ * The file must have been written on a machine with the same byte order
+ * and type sizes.
+ *
+ * Usage: log_decode [FILE]    (defaults to log.bin)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "c_logbin.h"
+
+#define DECODE_MAX_FORMATS 4096
+#define DECODE_MAX_LINE 4096
+
+typedef struct {
+    char* tag;
+    char* format;
+    uint8_t count;
+    uint8_t kinds[LOG_BIN_MAX_ARGS];
+} decode_format_t;
+
+/* Formats by id; ids are handed out from 1 in the order they are used. */
+static decode_format_t formats[DECODE_MAX_FORMATS];
+
+static int
+Decode_Read(FILE* file, void* out, size_t size) {
+    return fread(out, 1, size, file) == size;
+}
+
+/* Read a length prefixed string into a new buffer. */
+static char*
+Decode_ReadString(FILE* file) {
+    uint16_t length;
+    if (!Decode_Read(file, &length, sizeof(length))) {
+        return NULL;
+    }
+
+    char* str = malloc((size_t) length + 1);
+    if (!str) {
+        return NULL;
+    }
+    if (!Decode_Read(file, str, length)) {
+        free(str);
+        return NULL;
+    }
+    str[length] = '\0';
+    return str;
+}
+
+static int
+Decode_ReadFormat(FILE* file) {
+    uint32_t id;
+    if (!Decode_Read(file, &id, sizeof(id))) {
+        return 0;
+    }
+    if (id == 0 || id >= DECODE_MAX_FORMATS) {
+        fprintf(stderr, "log_decode: format id %u out of range\n",
+            (unsigned int) id);
+        return 0;
+    }
+
+    decode_format_t* format = &formats[id];
+    free(format->tag);
+    free(format->format);
+    format->tag = Decode_ReadString(file);
+    format->format = Decode_ReadString(file);
+
+    return format->tag && format->format
+        && Decode_Read(file, &format->count, sizeof(format->count))
+        && format->count <= LOG_BIN_MAX_ARGS
+        && Decode_Read(file, format->kinds, format->count);
+}
+
+/* Append one converted argument, formatted with its own conversion spec. */
+static size_t
+Decode_FormatArg(
+    char* out,
+    size_t size,
+    const char* spec,
+    log_arg_t kind,
+    const uint8_t* payload,
+    size_t length,
+    size_t* used
+) {
+    if (kind == LOG_ARG_STRING) {
+        uint16_t len;
+        if (*used + sizeof(len) > length) {
+            return snprintf(out, size, "<missing>");
+        }
+        memcpy(&len, payload + *used, sizeof(len));
+        *used += sizeof(len);
+        if (*used + len > length) {
+            return snprintf(out, size, "<missing>");
+        }
+
+        char str[DECODE_MAX_LINE];
+        if (len >= sizeof(str)) {
+            len = sizeof(str) - 1;
+        }
+        memcpy(str, payload + *used, len);
+        str[len] = '\0';
+        *used += len;
+        return snprintf(out, size, spec, str);
+    }
+
+    uint64_t value;
+    if (*used + sizeof(value) > length) {
+        return snprintf(out, size, "<missing>");
+    }
+    memcpy(&value, payload + *used, sizeof(value));
+    *used += sizeof(value);
+
+    double real;
+    switch (kind) {
+    case LOG_ARG_INT:
+        return snprintf(out, size, spec, (int) (int64_t) value);
+    case LOG_ARG_UINT:
+        return snprintf(out, size, spec, (unsigned int) value);
+    case LOG_ARG_LONG:
+        return snprintf(out, size, spec, (long) (int64_t) value);
+    case LOG_ARG_ULONG:
+        return snprintf(out, size, spec, (unsigned long) value);
+    case LOG_ARG_LLONG:
+        return snprintf(out, size, spec, (long long) (int64_t) value);
+    case LOG_ARG_ULLONG:
+        return snprintf(out, size, spec, (unsigned long long) value);
+    case LOG_ARG_SIZE:
+        return snprintf(out, size, spec, (size_t) value);
+    case LOG_ARG_DOUBLE:
+        memcpy(&real, &value, sizeof(real));
+        return snprintf(out, size, spec, real);
+    case LOG_ARG_POINTER:
+        return snprintf(out, size, spec, (void*) (uintptr_t) value);
+    default:
+        return snprintf(out, size, "<bad argument>");
+    }
+}
+
+/* Rebuild the message of an event from its format and payload. */
+static void
+Decode_FormatEvent(
+    char* out,
+    size_t size,
+    const decode_format_t* format,
+    const uint8_t* payload,
+    size_t length
+) {
+    size_t pos = 0;
+    size_t used = 0;
+    int arg = 0;
+    const char* p = format->format;
+
+    while (*p && pos + 1 < size) {
+        if (*p != '%') {
+            out[pos++] = *p++;
+            continue;
+        }
+
+        const char* end;
+        const log_arg_t kind = C_LogBinConversion(p, &end);
+
+        if (kind == LOG_ARG_NONE) {
+            out[pos++] = '%';
+        } else if (arg < format->count) {
+            char spec[32];
+            const size_t spec_len = (size_t) (end - p) < sizeof(spec)
+                ? (size_t) (end - p) : sizeof(spec) - 1;
+            memcpy(spec, p, spec_len);
+            spec[spec_len] = '\0';
+
+            const size_t n = Decode_FormatArg(out + pos, size - pos, spec,
+                (log_arg_t) format->kinds[arg++], payload, length, &used);
+            pos = pos + n < size ? pos + n : size - 1;
+        }
+        p = end;
+    }
+    out[pos] = '\0';
+}
+
+static int
+Decode_ReadEvent(FILE* file, const log_bin_header_t* header) {
+    uint32_t id;
+    uint64_t ticks;
+    uint16_t length;
+    uint8_t payload[65536];
+
+    if (!Decode_Read(file, &id, sizeof(id))
+        || !Decode_Read(file, &ticks, sizeof(ticks))
+        || !Decode_Read(file, &length, sizeof(length))
+        || !Decode_Read(file, payload, length)) {
+        return 0;
+    }
+
+    const decode_format_t* format
+        = id < DECODE_MAX_FORMATS ? &formats[id] : NULL;
+    if (!format || !format->format) {
+        fprintf(stderr, "log_decode: event uses unknown format %u\n",
+            (unsigned int) id);
+        return 1;
+    }
+
+    // wall clock from the time the file was opened plus elapsed ticks
+    const double seconds = header->tick_frequency
+        ? (double) (int64_t) (ticks - header->start_ticks)
+            / (double) header->tick_frequency
+        : 0.0;
+    time_t now = (time_t) header->start_time + (time_t) seconds;
+    char time_str[64];
+    strftime(time_str, sizeof(time_str), "%a %b %d %H:%M:%S %Y",
+        localtime(&now));
+
+    char msg[DECODE_MAX_LINE];
+    Decode_FormatEvent(msg, sizeof(msg), format, payload, length);
+    printf("%s %+.6f [%s]: %s\n", time_str, seconds, format->tag, msg);
+    return 1;
+}
+
+int
+main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "log.bin";
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "log_decode: cannot open %s\n", path);
+        return 1;
+    }
+
+    log_bin_header_t header;
+    if (!Decode_Read(file, &header, sizeof(header))
+        || memcmp(header.magic, LOG_BIN_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "log_decode: %s is not a binary log\n", path);
+        fclose(file);
+        return 1;
+    }
+    if (header.byte_order != LOG_BIN_BYTE_ORDER) {
+        fprintf(stderr, "log_decode: %s has a different byte order\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    int ok = 1;
+    uint8_t type;
+    while (ok && Decode_Read(file, &type, sizeof(type))) {
+        switch (type) {
+        case LOG_BIN_RECORD_FORMAT:
+            ok = Decode_ReadFormat(file);
+            break;
+        case LOG_BIN_RECORD_EVENT:
+            ok = Decode_ReadEvent(file, &header);
+            break;
+        default:
+            ok = 0;
+            break;
+        }
+    }
+    if (!ok) {
+        // a crash can leave the last record cut short
+        fprintf(stderr, "log_decode: %s ends with a damaged record\n", path);
+    }
+
+    fclose(file);
+    for (int i = 0; i < DECODE_MAX_FORMATS; i++) {
+        free(formats[i].tag);
+        free(formats[i].format);
+    }
+    return ok ? 0 : 1;
+}
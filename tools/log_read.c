@@ -0,0 +1,80 @@
+/**
+ * File: log_read.c
+ * Description: Prints the ring file written when CGAME_LOG_FILE is
+ * CGAME_LOG_FILE_RING, oldest line first. Built with `make log-read`;
+ * needs neither SDL nor Vulkan.
+ *
+ * Once the ring has wrapped, the oldest line is partly overwritten and is
+ * left out. The file can be read while the game is still writing to it,
+ * though lines written meanwhile may be cut.
+ *
+ * Usage: log_read [FILE]    (defaults to log.ring)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_logring.h"
+
+static int
+Read_Bytes(FILE* file, void* out, size_t size) {
+    return fread(out, 1, size, file) == size;
+}
+
+int
+main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "log.ring";
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "log_read: cannot open %s\n", path);
+        return 1;
+    }
+
+    log_ring_header_t header;
+    if (!Read_Bytes(file, &header, sizeof(header))
+        || memcmp(header.magic, LOG_RING_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "log_read: %s is not a ring log\n", path);
+        fclose(file);
+        return 1;
+    }
+    if (header.byte_order != LOG_RING_BYTE_ORDER) {
+        fprintf(stderr, "log_read: %s has a different byte order\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    char* data = header.capacity && header.capacity <= SIZE_MAX
+        ? malloc((size_t) header.capacity) : NULL;
+    if (!data
+        || fseek(file, (long) header.data_offset, SEEK_SET) != 0
+        || !Read_Bytes(file, data, (size_t) header.capacity)) {
+        fprintf(stderr, "log_read: %s is cut short\n", path);
+        free(data);
+        fclose(file);
+        return 1;
+    }
+    fclose(file);
+
+    const size_t capacity = (size_t) header.capacity;
+    if (header.cursor <= header.capacity) {
+        fwrite(data, 1, (size_t) header.cursor, stdout);
+    } else {
+        // the oldest text starts at the cursor, and runs round to it
+        const size_t at = (size_t) (header.cursor % header.capacity);
+        const char* newline = memchr(data + at, '\n', capacity - at);
+        if (newline) {
+            const size_t start = (size_t) (newline + 1 - data);
+            fwrite(data + start, 1, capacity - start, stdout);
+            fwrite(data, 1, at, stdout);
+        } else {
+            // the oldest line wraps round, skip to its end
+            newline = memchr(data, '\n', at);
+            const size_t start = newline ? (size_t) (newline + 1 - data) : at;
+            fwrite(data + start, 1, at - start, stdout);
+        }
+    }
+
+    free(data);
+    return 0;
+}